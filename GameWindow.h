@@ -3,7 +3,10 @@
 #include "imgui.h"
 #include "sdq.h"
 #include "ImFunks.h"
-#include <future>
+#include "DirectoryScanner.h"
+#include "sdq_grading.h"
+#include "sdq_grids.h"
+#include "sdq_jobs.h"
 #include <thread>
 #include <filesystem>
 #include <ctime>
@@ -17,16 +20,41 @@ enum TileState_
 };
 using TileState = int;
 
+// Quads of the digits 1-9 of a font. They are looked up once, so the board draws a digit as a single textured quad
+// instead of formatting and measuring a label for every tile
+struct DigitGlyphs
+{
+	struct Quad
+	{
+		ImVec2 Min;           // Relative to the top left of the text
+		ImVec2 Max;
+		ImVec2 UvMin;
+		ImVec2 UvMax;
+		float  AdvanceX;
+	};
+
+	const ImFont*        Font;
+	const ImFontGlyph*   GlyphData;         // The glyphs move when the atlas is rebuilt
+	float                Height;
+	std::array<Quad, 10> Quads;
+
+	DigitGlyphs() : Font(nullptr), GlyphData(nullptr), Height(0.0f), Quads({}) {}
+	// Looks the digits up again only if the font or its glyphs changed
+	void Cache(const ImFont* font);
+	// Adds the digit aligned inside [min, max] the same way RenderTextClipped aligns a label
+	void AddDigit(ImDrawList* draw_list, int digit, const ImVec2& min, const ImVec2& max, const ImVec2& align, ImU32 col) const;
+};
+
 struct SudokuTile
 {
 private:
 	int  TileID;                        // Unique ID / number of the object
 	bool Initialized;                   // Initialized flag so the unique id number can't be changed
-	char ButtonLabel[32];
 	char ContextPopUpLabel[32];
 	char InputIntLabel[32];
 
 	int                   InputTileNumber;
+	int                   PopupPencilmark;  // Pencilmark the popup was opened on, 0 for the number input
 	const int*            TileNumber;
 	const int*            SolutionNumber;
 	const std::bitset<9>* Pencilmark;
@@ -38,7 +66,7 @@ private:
 
 public:
 	static constexpr size_t CharBufferSize = 32;
-	static constexpr ImVec2 ButtonSize = ImVec2(48.50f, 48.50f);
+	static constexpr float  TileSize       = 48.50f;
 
 public:
 	SudokuTile();
@@ -56,9 +84,18 @@ public:
 	bool IsTileFilled();
 	//
 	void RecheckError(sdq::Instance& sudoku_context, uint16_t row, uint16_t col);
-	// Renders the tile button and it's popup context
-	// Returns false if the input is not valid, otherwise true
-	bool RenderButton(sdq::Instance& sudoku_context, uint16_t row, uint16_t col, bool error_override);
+	// True if the player can open the tile's popup
+	bool IsInteractive() const;
+	// True if the tile shows its pencilmarks as a 3x3 grid instead of a number
+	bool IsShowingPencilmarks() const;
+	// Draws the tile into the board's draw list. hovered_cell is the 3x3 cell under the mouse, -1 if the mouse isn't on the tile
+	void DrawTile(ImDrawList* draw_list, const ImVec2& tile_min, int hovered_cell, bool held, bool error_override,
+	              const DigitGlyphs& number_glyphs, const DigitGlyphs& pencilmark_glyphs) const;
+	// Opens the popup context at popup_pos, pencilmark_num is the clicked pencilmark or 0 for the number input
+	void OpenPopup(int pencilmark_num, const ImVec2& popup_pos);
+	// Renders the popup context opened by OpenPopup
+	// Returns true if the tile number changed
+	bool RenderPopup(sdq::Instance& sudoku_context, uint16_t row, uint16_t col);
 };
 
 template<size_t S>
@@ -81,6 +118,14 @@ struct TimeObj
 		return *this;
 	}
 	constexpr void Clear() noexcept { Days = 0; Hours = 0; Minutes = 0; Seconds = 0.0f; }
+	constexpr void SetTotalSeconds(uint32_t total_seconds) noexcept
+	{
+		Days    = total_seconds / 86400;
+		Hours   = (total_seconds / 3600) % 24;
+		Minutes = (total_seconds / 60) % 60;
+		Seconds = static_cast<float>(total_seconds % 60);
+	}
+	constexpr uint32_t TotalSeconds() const noexcept { return static_cast<uint32_t>((((Days * 24) + Hours) * 60 + Minutes) * 60 + static_cast<size_t>(Seconds)); }
 };
 
 struct SaveFile
@@ -89,15 +134,35 @@ struct SaveFile
 	SudokuDifficulty  Difficulty;
 	std::string       Directory;
 	std::tm           DateTime;
+	int               Progress;
+	uint32_t          ElapsedSeconds;
 
-	SaveFile() : Difficulty(SudokuDifficulty_Random), Exists(false) { Directory.reserve(20); }
-	SaveFile(const std::string& filepath) : Directory(filepath), Difficulty(SudokuDifficulty_Random), Exists(false) {}
-	SaveFile(const std::filesystem::directory_entry& filedir) : Directory(std::move(filedir.path().string())), Difficulty(SudokuDifficulty_Random), Exists(false) {}
+	SaveFile() : Exists(false), Difficulty(SudokuDifficulty_Random), Progress(0), ElapsedSeconds(0) { Directory.reserve(20); }
+	SaveFile(const std::string& filepath) : Exists(false), Difficulty(SudokuDifficulty_Random), Directory(filepath), Progress(0), ElapsedSeconds(0) {}
+	SaveFile(const std::filesystem::directory_entry& filedir) : Exists(false), Difficulty(SudokuDifficulty_Random), Directory(std::move(filedir.path().string())), Progress(0), ElapsedSeconds(0) {}
 };
 
 class GameWindow
 {
+	friend class RenderBenchmark;    // Tools/RenderBenchmark.cpp drives the window headlessly
+
 private:
+	struct SaveSlotWrite
+	{
+		int                     SlotIdx;
+		bool                    Success;
+		sdq::save::SaveSlotInfo SlotInfo;
+	};
+
+	// A game built by a worker on its own Instance. The render thread swaps it in whole at the start of a frame
+	struct PreparedGame
+	{
+		sdq::Instance Context;
+		std::string   OpenFile;
+		bool          FileSaved;
+		bool          FromSaveFile;    // Puzzle tiles are the ones listed by the save, not the empty tiles
+	};
+
 	bool             Initialized;
 	bool             GameStart;
 	bool             GamePaused;
@@ -113,22 +178,41 @@ private:
 	bool             StartLoadingScreen;
 	bool             SudokuFileSaved;
 	bool             LoadAFile;
+	bool             ShowPerformanceOverlay;
 	TimeObj          TimeElapsed;
 	TimeObj          ShowSolutionTotalTime;
 	sdq::Instance    SudokuContext;
 	SudokuTiles<9>   SudokuGameTiles;
+	std::bitset<81>  ShownConflictTiles;    // Conflict state the tiles were last synced with
+	int              PopupTileIdx;          // Tile whose popup context was last opened, -1 if none
+	int              FocusedTileIdx;        // Tile the arrow keys move and Space/Enter open while the board has keyboard focus
+	DigitGlyphs      NumberGlyphs;
+	DigitGlyphs      PencilmarkGlyphs;
 	SudokuDifficulty GameDifficulty;
 	std::string      CurrentlyOpenFile;
+	DirectoryScanner SudokuFileScanner;
+	sdq::save::Journal AutosaveJournal;
+
+	bool                       NewGameRunning;        // A new game or load job is on the workers
+	sdq::jobs::Handoff<PreparedGame> PublishedGame;   // Written by the new game job, taken by RenderWindow
+	ImFunks::LoadingScreen     NewGameLoading;
+	std::optional<bool>        NewGameResult;
+	bool                       SaveWriteRunning;
+	std::vector<SaveSlotWrite> FinishedSaveWrites;    // Applied to the save slot list the next time it is drawn
+	sdq::grading::GradeCache   PuzzleGradeCache;      // Grades of the imported sudoku files
+	sdq::grids::GridFactory    PuzzleGrids;           // Complete boards of the new games. The pool fills in the first generation job
 
-	mutable std::mutex     NewGameMutex;
-	std::future<bool>      NewGameFuture;
-	ImFunks::LoadingScreen NewGameLoading;
-	std::optional<bool>    NewGameResult;
+	// Last member, so it is destroyed first and no job outlives the state it works on
+	sdq::jobs::JobSystem       Jobs;
 public:
 	GameWindow();
 
 	void RenderWindow();
 	bool IsWindowClosed();
+	// Seconds the main loop can sleep waiting for input before the next frame is due. Zero if frames are needed continuously
+	double GetIdleTimeout() const;
+	// Called from a worker thread when a job finished and a frame is needed to deliver its result
+	void SetWakeUpCallback(sdq::jobs::Task wake_up);
 
 private:
 	// Windows
@@ -138,12 +222,16 @@ private:
 	void LoadSaveFileWindow();
 	void GameOptions();
 	void MainMenuBar();
+	void PerformanceOverlay();
 
 	// Process Functions
 	bool CreateNewGame(const std::string& filepath);
 	bool CreateNewGame(SudokuDifficulty difficulty);
 	bool LoadSaveFile(const std::string& filepath);
-	bool SaveProgress(const std::string& filepath);
+	void SaveProgress(int slot_idx, const std::string& filepath);
+	bool RecoverLastSession();
+	void AdoptGame(PreparedGame& game);
+	void StartAutosaveSession();
 	void StopOngoingGame();
 	void SetSudokuTilesForNewGame();
 	void RenderSudokuBoard();
@@ -160,6 +248,7 @@ private:
 	void NewGameOption();
 
 	// Loading Screen Functions
+	void SubmitNewGame(std::function<bool()> new_game);
 	void RenderNewGameLoadingScreen();
 	void StartNewGameLoadingScreen();
 	void CheckNewGameProgress();
@@ -1,4 +1,11 @@
 #include "sdq.h"
+#include "sdq_grading.h"
+#include "sdq_grids.h"
+#include "sdq_jobs.h"
+#include "sdq_metrics.h"
+#include "sdq_trace.h"
+#include <atomic>
+#include <bit>
 #include <fstream>
 #include <filesystem>
 
@@ -73,6 +80,31 @@ constexpr std::tuple<int, int, int, int> GetMinMaxRowColumnFromCell(int const ce
     return { min_row, max_row, min_col, max_col };
 }
 
+static constexpr std::array<std::array<uint8_t, 20>, 81> CreatePeerTable() noexcept
+{
+    std::array<std::array<uint8_t, 20>, 81> peer_table = {};
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        const int row = tile_idx / 9, col = tile_idx % 9;
+        int peer_count = 0;
+        for (int peer_idx = 0; peer_idx < 81; ++peer_idx) {
+            const int peer_row = peer_idx / 9, peer_col = peer_idx % 9;
+            if (peer_idx == tile_idx)
+                continue;
+            if (peer_row == row || peer_col == col || GetCellBlock(peer_row, peer_col) == GetCellBlock(row, col))
+                peer_table[tile_idx][peer_count++] = static_cast<uint8_t>(peer_idx);
+        }
+    }
+
+    return peer_table;
+}
+
+static constexpr auto PeerTable = CreatePeerTable();
+
+const std::array<uint8_t, 20>& GetPeers(int row, int col) noexcept
+{
+    return PeerTable[(row * 9) + col];
+}
+
 }
 
 namespace sdq
@@ -149,6 +181,11 @@ std::bitset<9>& BoardOccurences::GetCellOccurences(int row, int col) noexcept
     return CellOccurences[cell];
 }
 
+bool BoardOccurences::operator == (const BoardOccurences& other) const noexcept
+{
+    return RowOccurences == other.RowOccurences && ColOccurences == other.ColOccurences && CellOccurences == other.CellOccurences;
+}
+
 
 //--------------------------------------------------------------------------------------------------------------------------------
 // BoardTile CLASS
@@ -274,6 +311,9 @@ GameBoard::GameBoard(const GameBoard& other) noexcept
 
 GameBoard& GameBoard::operator = (const GameBoard& other) noexcept
 {
+    if (this == &other)
+        return *this;
+
     this->BoardInitialized = other.BoardInitialized;
     this->BoardOccurences = other.BoardOccurences;
 
@@ -293,8 +333,11 @@ GameBoard& GameBoard::operator = (const GameBoard& other) noexcept
         return *this;
     }
 
-    // Create new puzzle tiles because the pointers will be pointing to different objects!
-    this->CreatePuzzleTiles();
+    // Same puzzle tiles as the former, pointing at our own tiles. Rebuilding them from the empty tiles would turn the
+    // tiles the player filled into givens
+    this->PuzzleTiles.clear();
+    for (const auto* puzzle_tile : other.PuzzleTiles)
+        this->PuzzleTiles.push_back(&this->BoardTiles[puzzle_tile->Row][puzzle_tile->Column]);
     return *this;
 }
 
@@ -454,6 +497,54 @@ void GameBoard::UpdateBoardOccurences(int row, int col) noexcept
     }
 }
 
+void GameBoard::UpdateTileNumber(int row, int col, int number) noexcept
+{
+    auto& input_tile = BoardTiles[row][col];
+    const int prev_num = input_tile.TileNumber;
+    if (prev_num == number)
+        return;
+
+    input_tile.SetTileNumber(number);
+
+    const auto& peers = sdq::helpers::GetPeers(row, col);
+    // SetTileNumber cleared the old number from the 3 units. A peer holding the same number keeps it set
+    if (prev_num != 0) {
+        for (const auto peer_idx : peers) {
+            const auto& peer_tile = BoardTiles[peer_idx / 9][peer_idx % 9];
+            if (peer_tile.TileNumber == prev_num)
+                BoardOccurences.SetCellNumber(peer_tile.Row, peer_tile.Column, prev_num - 1);
+        }
+    }
+
+    for (const auto peer_idx : peers) {
+        auto& peer_tile = BoardTiles[peer_idx / 9][peer_idx % 9];
+        if (peer_tile.IsTileFilled())
+            continue;
+
+        if (number != 0)
+            peer_tile.RemovePencilmarks();
+        else
+            peer_tile.ReapplyPencilmarks();
+    }
+
+    if (number == 0)
+        input_tile.ReapplyPencilmarks();
+
+    assert(this->IsBoardOccurencesConsistent());
+}
+
+bool GameBoard::IsBoardOccurencesConsistent() const noexcept
+{
+    sdq::BoardOccurences rebuilt_occurences;
+    rebuilt_occurences.ResetAll();
+    for (const auto& row_tiles : BoardTiles)
+        for (const auto& tile : row_tiles)
+            if (tile.IsTileFilled())
+                rebuilt_occurences.SetCellNumber(tile.Row, tile.Column, tile.TileNumber - 1);
+
+    return rebuilt_occurences == BoardOccurences;
+}
+
 //------------------------------------------------------
 // SudokuBoard Backtracking Sudoku Solver Queries
 //------------------------------------------------------
@@ -768,28 +859,172 @@ bool GameBoard::IsCandidatePresentInTheSameLine(int line_index, int bit_number,
     return false;
 }
 
+//-----------------------------------------------------------------------------------------------------------------------------------------------
+// Xoshiro256 CLASS
+//-----------------------------------------------------------------------------------------------------------------------------------------------
+
+static constexpr uint64_t RotateLeft(uint64_t value, int shift) noexcept
+{
+    return (value << shift) | (value >> (64 - shift));
+}
+
+static constexpr uint64_t SplitMix64(uint64_t& state) noexcept
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+Xoshiro256::Xoshiro256(uint64_t seed) noexcept
+{
+    Seed(seed);
+}
+
+void Xoshiro256::Seed(uint64_t seed) noexcept
+{
+    // SplitMix64 spreads the seed so that close seeds give unrelated states. It also never produces an all zero state
+    uint64_t splitmix_state = seed;
+    for (auto& state : State)
+        state = SplitMix64(splitmix_state);
+}
+
+Xoshiro256::result_type Xoshiro256::operator()() noexcept
+{
+    const uint64_t result = RotateLeft(State[1] * 5, 7) * 9;
+    const uint64_t t = State[1] << 17;
+
+    State[2] ^= State[0];
+    State[3] ^= State[1];
+    State[1] ^= State[2];
+    State[0] ^= State[3];
+    State[2] ^= t;
+    State[3] = RotateLeft(State[3], 45);
+
+    return result;
+}
+
+void Xoshiro256::Jump() noexcept
+{
+    constexpr std::array<uint64_t, 4> jump_table = { 0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull, 0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull };
+
+    std::array<uint64_t, 4> jumped_state = { 0, 0, 0, 0 };
+    for (const auto& jump_bits : jump_table) {
+        for (int bit = 0; bit < 64; ++bit) {
+            if (jump_bits & (1ull << bit))
+                for (size_t idx = 0; idx < 4; ++idx)
+                    jumped_state[idx] ^= State[idx];
+            (*this)();
+        }
+    }
+
+    State = jumped_state;
+}
+
+uint64_t Xoshiro256::NextBounded(uint64_t bound) noexcept
+{
+    // Rejection sampling on the top of the range so every value is equally likely
+    const uint64_t threshold = (0 - bound) % bound;
+    while (true) {
+        const uint64_t value = (*this)();
+        if (value >= threshold)
+            return value % bound;
+    }
+}
+
 //-----------------------------------------------------------------------------------------------------------------------------------------------
 // TurnLog CLASS
 //-----------------------------------------------------------------------------------------------------------------------------------------------
 
-TurnLog::TurnLog() noexcept :
-    UndoPosition(0)
+// Packed turn layout. Bits 0-6 are the tile index, bit 7 tells which kind of turn it is and bit 30 links it to the turn before
+// Number turn:     bits 8-11 previous number, 12-15 next number, 16-24 pencilmarks of the tile
+// Pencilmark turn: bits 8-11 number, 12-20 previous pencilmarks, 21-29 pencilmarks that were toggled
+static constexpr uint32_t PencilmarkTurnFlag = 1 << 7;
+static constexpr uint32_t LinkedTurnFlag     = 1 << 30;
+
+static constexpr uint32_t PackNumberTurn(int tile_idx, int prev_num, int next_num, uint32_t pencilmark) noexcept
+{
+    return static_cast<uint32_t>(tile_idx) | (static_cast<uint32_t>(prev_num) << 8) | (static_cast<uint32_t>(next_num) << 12) | (pencilmark << 16);
+}
+
+static constexpr uint32_t PackPencilmarkTurn(int tile_idx, int number, uint32_t prev_pm, uint32_t toggled_pm) noexcept
+{
+    return static_cast<uint32_t>(tile_idx) | PencilmarkTurnFlag | (static_cast<uint32_t>(number) << 8) | (prev_pm << 12) | (toggled_pm << 21);
+}
+
+TurnLog::TurnLog(size_t memory_cap) noexcept :
+    MaxChunks(std::max<size_t>(1, memory_cap / sizeof(TurnChunk))),
+    FirstTurn(0),
+    TurnCount(0),
+    UndoPosition(0),
+    GroupStart(0),
+    GroupOpen(false),
+    GroupHasTurns(false)
+{}
+
+TurnLog::TurnLog(const TurnLog& other) noexcept :
+    MaxChunks(other.MaxChunks),
+    FirstTurn(other.FirstTurn),
+    TurnCount(other.TurnCount),
+    UndoPosition(other.UndoPosition),
+    GroupStart(other.GroupStart),
+    GroupOpen(other.GroupOpen),
+    GroupHasTurns(other.GroupHasTurns)
+{
+    Chunks.reserve(other.Chunks.size());
+    for (const auto& chunk : other.Chunks)
+        Chunks.push_back(std::make_unique<TurnChunk>(*chunk));
+}
+
+TurnLog& TurnLog::operator = (const TurnLog& other) noexcept
 {
-    TilesUsed.reserve(100);
+    if (this == &other)
+        return *this;
+
+    Chunks.clear();
+    Chunks.reserve(other.Chunks.size());
+    for (const auto& chunk : other.Chunks)
+        Chunks.push_back(std::make_unique<TurnChunk>(*chunk));
+
+    MaxChunks     = other.MaxChunks;
+    FirstTurn     = other.FirstTurn;
+    TurnCount     = other.TurnCount;
+    UndoPosition  = other.UndoPosition;
+    GroupStart    = other.GroupStart;
+    GroupOpen     = other.GroupOpen;
+    GroupHasTurns = other.GroupHasTurns;
+    return *this;
 }
 
 void TurnLog::Add(int _row, int _col, int prev_num, int next_num, const std::bitset<9>& prev_pm, const std::bitset<9>& next_pm) noexcept
 {
-    if (UndoPosition < TilesUsed.size())
-        TilesUsed.resize(UndoPosition);
+    // A turn either changes the number or the pencilmarks of a tile, never both
+    assert(prev_num == next_num || prev_pm == next_pm);
+
+    // Adding a turn drops the redo tail
+    TurnCount     = UndoPosition;
+    GroupHasTurns = GroupOpen;
 
-    TilesUsed.push_back(TurnTile(_row, _col, prev_num, next_num, prev_pm, next_pm));
-    UndoPosition = TilesUsed.size();
+    const size_t capacity = Chunks.size() * ChunkTurns;
+    if (TurnCount == capacity) {
+        if (Chunks.size() < MaxChunks)
+            Chunks.push_back(std::make_unique<TurnChunk>());
+        else {
+            // Full. The oldest turn gives its slot to the new one
+            FirstTurn = (FirstTurn + 1) % capacity;
+            --TurnCount;
+            if (GroupOpen && GroupStart > 0)
+                --GroupStart;
+        }
+    }
+
+    GetPackedTurn(TurnCount) = PackTurn(TurnTile(_row, _col, prev_num, next_num, prev_pm, next_pm, GroupOpen && TurnCount > GroupStart));
+    UndoPosition = ++TurnCount;
 }
 
 void TurnLog::Undo() noexcept
 {
-    if (TilesUsed.empty() || UndoPosition == 0)
+    if (UndoPosition == 0)
         return;
 
     UndoPosition--;
@@ -797,7 +1032,7 @@ void TurnLog::Undo() noexcept
 
 void TurnLog::Redo() noexcept
 {
-    if (UndoPosition == TilesUsed.size())
+    if (UndoPosition == TurnCount)
         return;
 
     UndoPosition++;
@@ -805,28 +1040,162 @@ void TurnLog::Redo() noexcept
 
 void TurnLog::Reset() noexcept
 {
-    TilesUsed.clear();
-    UndoPosition = 0;
+    // Chunks are kept, the history is bounded anyway
+    FirstTurn     = 0;
+    TurnCount     = 0;
+    UndoPosition  = 0;
+    GroupStart    = 0;
+    GroupOpen     = false;
+    GroupHasTurns = false;
+}
+
+void TurnLog::BeginGroup() noexcept
+{
+    // The redo tail stays until the group adds its first turn, so an empty group changes nothing
+    assert(!GroupOpen);
+    GroupStart    = UndoPosition;
+    GroupOpen     = true;
+    GroupHasTurns = false;
 }
 
-const TurnLog::TurnTile* TurnLog::GetUndoTile() const noexcept
+void TurnLog::CommitGroup() noexcept
 {
-    return TilesUsed.empty() || UndoPosition == 0 ? nullptr : &TilesUsed[UndoPosition - 1];
+    GroupOpen = false;
 }
 
-const TurnLog::TurnTile* TurnLog::GetRedoTile() const noexcept
+void TurnLog::RollbackGroup() noexcept
 {
-    return UndoPosition == TilesUsed.size() ? nullptr : &TilesUsed[UndoPosition];
+    assert(UndoPosition <= GroupStart);
+    if (GroupHasTurns)
+        TurnCount = UndoPosition;
+    GroupOpen     = false;
+    GroupHasTurns = false;
+}
+
+bool TurnLog::IsGroupOpen() const noexcept
+{
+    return GroupOpen;
+}
+
+size_t TurnLog::GetGroupTurnCount() const noexcept
+{
+    return GroupOpen && UndoPosition > GroupStart ? UndoPosition - GroupStart : 0;
+}
+
+void TurnLog::SetMemoryCap(size_t memory_cap) noexcept
+{
+    Chunks.clear();
+    MaxChunks = std::max<size_t>(1, memory_cap / sizeof(TurnChunk));
+    this->Reset();
+}
+
+std::optional<TurnLog::TurnTile> TurnLog::GetUndoTile() const noexcept
+{
+    if (UndoPosition == 0)
+        return std::nullopt;
+
+    return UnpackTurn(GetPackedTurn(UndoPosition - 1));
+}
+
+std::optional<TurnLog::TurnTile> TurnLog::GetRedoTile() const noexcept
+{
+    if (UndoPosition == TurnCount)
+        return std::nullopt;
+
+    return UnpackTurn(GetPackedTurn(UndoPosition));
 }
 
 bool TurnLog::CanUndo() const noexcept
 {
-    return !TilesUsed.empty() && UndoPosition != 0;
+    return UndoPosition != 0;
 }
 
 bool TurnLog::CanRedo() const noexcept
 {
-    return UndoPosition != TilesUsed.size();
+    return UndoPosition != TurnCount;
+}
+
+void TurnLog::ExportHistory(save::TurnHistory& history) const noexcept
+{
+    history.Turns.resize(TurnCount);
+    for (size_t turn_idx = 0; turn_idx < TurnCount; ++turn_idx)
+        history.Turns[turn_idx] = GetPackedTurn(turn_idx);
+    history.UndoPosition = static_cast<uint32_t>(UndoPosition);
+}
+
+bool TurnLog::ImportHistory(const save::TurnHistory& history) noexcept
+{
+    this->Reset();
+    if (history.UndoPosition > history.Turns.size())
+        return false;
+
+    if (!std::all_of(history.Turns.begin(), history.Turns.end(), IsValidPackedTurn))
+        return false;
+
+    // A history saved with a bigger cap only keeps its newest turns
+    const size_t max_turns  = MaxChunks * ChunkTurns;
+    const size_t first_turn = history.Turns.size() > max_turns ? history.Turns.size() - max_turns : 0;
+    if (history.UndoPosition < first_turn)
+        return false;
+
+    while (Chunks.size() * ChunkTurns < history.Turns.size() - first_turn)
+        Chunks.push_back(std::make_unique<TurnChunk>());
+
+    for (size_t turn_idx = first_turn; turn_idx < history.Turns.size(); ++turn_idx)
+        GetPackedTurn(TurnCount++) = history.Turns[turn_idx];
+    UndoPosition = history.UndoPosition - first_turn;
+
+    return true;
+}
+
+uint32_t& TurnLog::GetPackedTurn(size_t turn_idx) noexcept
+{
+    const size_t ring_idx = (FirstTurn + turn_idx) % (Chunks.size() * ChunkTurns);
+    return (*Chunks[ring_idx / ChunkTurns])[ring_idx % ChunkTurns];
+}
+
+const uint32_t& TurnLog::GetPackedTurn(size_t turn_idx) const noexcept
+{
+    const size_t ring_idx = (FirstTurn + turn_idx) % (Chunks.size() * ChunkTurns);
+    return (*Chunks[ring_idx / ChunkTurns])[ring_idx % ChunkTurns];
+}
+
+uint32_t TurnLog::PackTurn(const TurnTile& turn_tile) noexcept
+{
+    const int tile_idx = (turn_tile.Row * 9) + turn_tile.Column;
+    uint32_t packed_turn = turn_tile.PreviousNumber != turn_tile.NextNumber
+        ? PackNumberTurn(tile_idx, turn_tile.PreviousNumber, turn_tile.NextNumber, turn_tile.PreviousPencilmark.to_ulong())
+        : PackPencilmarkTurn(tile_idx, turn_tile.PreviousNumber, turn_tile.PreviousPencilmark.to_ulong(), (turn_tile.PreviousPencilmark ^ turn_tile.NextPencilmark).to_ulong());
+    if (turn_tile.Linked)
+        packed_turn |= LinkedTurnFlag;
+
+    return packed_turn;
+}
+
+TurnLog::TurnTile TurnLog::UnpackTurn(uint32_t packed_turn) noexcept
+{
+    const int  tile_idx = packed_turn & 0x7F;
+    const bool linked   = (packed_turn & LinkedTurnFlag) != 0;
+    if (packed_turn & PencilmarkTurnFlag) {
+        const int            number  = (packed_turn >> 8) & 0xF;
+        const std::bitset<9> prev_pm = (packed_turn >> 12) & 0x1FF;
+        return TurnTile(tile_idx / 9, tile_idx % 9, number, number, prev_pm, prev_pm ^ std::bitset<9>((packed_turn >> 21) & 0x1FF), linked);
+    }
+
+    const std::bitset<9> pencilmark = (packed_turn >> 16) & 0x1FF;
+    return TurnTile(tile_idx / 9, tile_idx % 9, (packed_turn >> 8) & 0xF, (packed_turn >> 12) & 0xF, pencilmark, pencilmark, linked);
+}
+
+bool TurnLog::IsValidPackedTurn(uint32_t packed_turn) noexcept
+{
+    packed_turn &= ~LinkedTurnFlag;
+    if ((packed_turn & 0x7F) >= 81 || ((packed_turn >> 8) & 0xF) > 9)
+        return false;
+
+    if (packed_turn & PencilmarkTurnFlag)
+        return (packed_turn >> 30) == 0;
+
+    return ((packed_turn >> 12) & 0xF) <= 9 && (packed_turn >> 25) == 0;
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------------------------
@@ -838,14 +1207,22 @@ bool TurnLog::CanRedo() const noexcept
 // GameContext CLASS
 //--------------------------------------------------------------------------------------------------------------------------------
 
-Instance::Instance() : GameDifficulty(2), RandomDifficulty(0)
+Instance::Instance() : GameDifficulty(2), RandomDifficulty(0), PuzzleSeed(0), ElapsedSeconds(0), GameRNG(0), GameJournal(nullptr), GameGradeCache(nullptr), GeneratorJobs(nullptr), GeneratorGrids(nullptr), GeneratorSeeds(nullptr), LastGeneration({}),
+    UnitDigitCounts({}), ConflictTiles(0), FilledTileCount(0), SolutionMismatches(81)
+{}
+
+uint64_t Instance::NewPuzzleSeed() noexcept
 {
-    auto seed = std::chrono::steady_clock::now().time_since_epoch().count();
-    GameRNG.seed(seed);
+    // Two instances asking in the same clock tick still get different seeds
+    static std::atomic<uint64_t> seed_counter = 0;
+    uint64_t seed_state = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    seed_state ^= seed_counter.fetch_add(1, std::memory_order_relaxed) * 0xD1B54A32D192ED03ull;
+    return SplitMix64(seed_state);
 }
 
 bool Instance::CreateSudoku(const std::array<std::array<int, 9>, 9>& board) noexcept
 {
+    SDQ_TRACE_SCOPE("Instance::CreateSudoku(board)");
     if (!SolutionBoard.CreateSudokuBoard(board))
         return false;
 
@@ -854,21 +1231,107 @@ bool Instance::CreateSudoku(const std::array<std::array<int, 9>, 9>& board) noex
     if (!sdq::solvers::Solve(SolutionBoard, SolveMethod_MRV))
         return false;
 
+    // Imported boards are often ones that were graded before, the cache turns those into a lookup
     GameDifficulty   = SudokuDifficulty_Random;
-    RandomDifficulty = sdq::utils::CheckPuzzleDifficulty(PuzzleBoard);
+    RandomDifficulty = GameGradeCache != nullptr ? sdq::grading::GradePuzzle(PuzzleBoard, *GameGradeCache).Difficulty
+                                                 : sdq::utils::CheckPuzzleDifficulty(PuzzleBoard);
+    ElapsedSeconds   = 0;
     GameTurnLogs.Reset();
+    this->RebuildBoardCounters();
 
     return true;
 }
 
 bool Instance::LoadSudokuSave(const char* filepath) noexcept
+{
+    save::SaveRecord  record;
+    save::TurnHistory history;
+    switch (save::ReadSaveRecord(filepath, record, &history))
+    {
+    case SaveReadResult_Ok:
+        if (!this->LoadSaveRecord(record))
+            return false;
+        // A history that doesn't fit is dropped, the puzzle itself is still fine
+        GameTurnLogs.ImportHistory(history);
+        return true;
+    case SaveReadResult_Legacy:
+        return this->LoadLegacySudokuSave(filepath);
+    default:
+        return false;
+    }
+}
+
+bool Instance::LoadSaveRecord(const save::SaveRecord& record) noexcept
+{
+    std::array<std::array<int, 9>, 9> solutionboard_numbers;
+    std::array<std::array<int, 9>, 9> puzzleboard_numbers;
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        const int solution_number = save::GetPackedDigit(record.SolutionDigits, tile_idx);
+        const int puzzle_number   = save::GetPackedDigit(record.PuzzleDigits, tile_idx);
+        if (solution_number > 9 || puzzle_number > 9)
+            return false;
+
+        solutionboard_numbers[tile_idx / 9][tile_idx % 9] = solution_number;
+        puzzleboard_numbers[tile_idx / 9][tile_idx % 9]   = puzzle_number;
+    }
+
+    this->GameDifficulty   = SudokuDifficulty_Random;
+    this->RandomDifficulty = record.Header.Difficulty;
+    this->ElapsedSeconds   = record.ElapsedSeconds;
+    this->SolutionBoard.CreateSudokuBoard(solutionboard_numbers, false);
+    this->PuzzleBoard.CreateSudokuBoard(puzzleboard_numbers, false);
+
+    // Puzzle tiles are pushed in row major order, the same order CreatePuzzleTiles makes them
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        auto& tile = this->PuzzleBoard.GetTile(tile_idx / 9, tile_idx % 9);
+        tile.Pencilmarks = record.Pencilmarks[tile_idx];
+        if (save::IsBitmapSet(record.PuzzleTileBitmap, tile_idx))
+            this->PuzzleBoard.PuzzleTiles.push_back(&tile);
+    }
+
+    GameTurnLogs.Reset();
+    this->RebuildBoardCounters();
+
+    return true;
+}
+
+bool Instance::SaveCurrentProgress(const char* filepath) const noexcept
+{
+    save::SaveRecord  record;
+    save::TurnHistory history;
+    this->CreateSaveRecord(record);
+    GameTurnLogs.ExportHistory(history);
+    return save::WriteSaveRecord(filepath, record, &history);
+}
+
+void Instance::CreateSaveRecord(save::SaveRecord& record) const noexcept
+{
+    record.SolutionDigits.fill(0);
+    record.PuzzleDigits.fill(0);
+    record.PuzzleTileBitmap.fill(0);
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        const auto& puzzle_tile = this->PuzzleBoard.GetTile(tile_idx / 9, tile_idx % 9);
+        save::SetPackedDigit(record.SolutionDigits, tile_idx, this->SolutionBoard.GetTile(tile_idx / 9, tile_idx % 9).TileNumber);
+        save::SetPackedDigit(record.PuzzleDigits, tile_idx, puzzle_tile.TileNumber);
+        record.Pencilmarks[tile_idx] = static_cast<uint16_t>(puzzle_tile.Pencilmarks.to_ulong());
+    }
+
+    for (const auto& puzzle_tile : this->PuzzleBoard.PuzzleTiles)
+        save::SetBitmap(record.PuzzleTileBitmap, (puzzle_tile->Row * 9) + puzzle_tile->Column);
+
+    record.ElapsedSeconds = this->ElapsedSeconds;
+    save::SealRecord(record, this->GetBoardDifficulty());
+}
+
+bool Instance::LoadLegacySudokuSave(const char* filepath) noexcept
 {
     std::ifstream sudoku_save(filepath, std::ios::binary);
     if (!sudoku_save.good())
         return false;
 
-    boost::archive::binary_iarchive iarchive(sudoku_save);
     try {
+        // Files too short for a save header or without its magic end up here too, so the archive itself can throw
+        boost::archive::binary_iarchive iarchive(sudoku_save);
         this->GameDifficulty = SudokuDifficulty_Random;
         iarchive & this->RandomDifficulty;
 
@@ -877,7 +1340,7 @@ bool Instance::LoadSudokuSave(const char* filepath) noexcept
             for (size_t col = 0; col < 9; ++col) {
                 iarchive & solutionboard_numbers[row][col];
                 if (solutionboard_numbers[row][col] < 0 || solutionboard_numbers[row][col] > 9)
-                    throw;
+                    return false;
             }
         }
 
@@ -891,7 +1354,7 @@ bool Instance::LoadSudokuSave(const char* filepath) noexcept
                 iarchive & puzzleboard_pencilmarks[(row * 9) + col];
 
                 if (puzzleboard_numbers[row][col] < 0 || puzzleboard_numbers[row][col] > 9)
-                    throw;
+                    return false;
             }
         }
 
@@ -906,9 +1369,11 @@ bool Instance::LoadSudokuSave(const char* filepath) noexcept
             try {
                 iarchive & puzzle_row;
                 iarchive & puzzle_col;
+                if (puzzle_row < 0 || puzzle_row > 8 || puzzle_col < 0 || puzzle_col > 8)
+                    return false;
                 this->PuzzleBoard.PuzzleTiles.push_back(&this->PuzzleBoard.GetTile(puzzle_row, puzzle_col));
             }
-            catch (const std::exception& e) {
+            catch (const std::exception&) {
                 break;
             }
         }
@@ -917,51 +1382,34 @@ bool Instance::LoadSudokuSave(const char* filepath) noexcept
         return false;
     }
 
+    ElapsedSeconds = 0;
     GameTurnLogs.Reset();
+    this->RebuildBoardCounters();
 
     return true;
 }
 
-bool Instance::SaveCurrentProgress(const char* filepath) const noexcept
+SudokuDifficulty Instance::LoadDifficultyFromSaveFile(const char* filepath) noexcept
 {
-    std::ofstream ofile(filepath, std::ios::binary);
-    if (!ofile.good())
-        return false;
-
-    boost::archive::binary_oarchive archive(ofile);
-    // Archive the difficulty
-    archive& this->GetBoardDifficulty();
-
-    // Archive the solution board
-    for (auto& row_tile : this->SolutionBoard.BoardTiles)
-        for (auto& tile : row_tile)
-            archive& tile.TileNumber;
-
-    // Archive the puzzle board
-    for (auto& row_tile : this->PuzzleBoard.BoardTiles) {
-        for (auto& tile : row_tile) {
-            archive& tile.TileNumber;
-            archive& tile.Pencilmarks;
-        }
-    }
-
-    for (auto& puzzle_tile : this->PuzzleBoard.PuzzleTiles) {
-        archive& puzzle_tile->Row;
-        archive& puzzle_tile->Column;
+    save::SaveHeader header;
+    switch (save::ReadSaveHeader(filepath, header))
+    {
+    case SaveReadResult_Ok:
+        return header.Difficulty;
+    case SaveReadResult_Legacy:
+        break;
+    default:
+        return SudokuDifficulty_Random;
     }
 
-    return true;
-}
-
-SudokuDifficulty Instance::LoadDifficultyFromSaveFile(const char* filepath) noexcept
-{
+    // Old boost archive saves keep the difficulty as the first archived int
     std::ifstream ifile(filepath, std::ios::binary);
     if (!ifile.good())
         return SudokuDifficulty_Random;
 
-    boost::archive::binary_iarchive iarchive(ifile);
     SudokuDifficulty difficulty = SudokuDifficulty_Random;
     try {
+        boost::archive::binary_iarchive iarchive(ifile);
         iarchive & difficulty;
     }
     catch (const std::exception&) {
@@ -973,16 +1421,42 @@ SudokuDifficulty Instance::LoadDifficultyFromSaveFile(const char* filepath) noex
 
 bool Instance::CreateSudoku(SudokuDifficulty game_difficulty) noexcept
 {
+    return this->CreateSudoku(game_difficulty, NewPuzzleSeed());
+}
+
+bool Instance::CreateSudoku(SudokuDifficulty game_difficulty, uint64_t seed) noexcept
+{
+    SDQ_TRACE_SCOPE("Instance::CreateSudoku(difficulty)");
+    // Stream 0 of the seed picks the game parameters and every generation attempt after it gets the next stream.
+    // An attempt only ever draws from its own stream, so the result depends on the seed alone. A puzzle derived from the
+    // seed set draws from stream 0, so it depends on the seed and the seeds
+    PuzzleSeed     = seed;
+    ElapsedSeconds = 0;
+    Xoshiro256 attempt_streams(seed);
+    GameRNG = attempt_streams;
     this->InitializeGameParameters(game_difficulty);  // Initialize important game parameters for creating a sudoku puzzle
-    do {
-        if (!this->CreateCompleteBoard())
-            return false;
+    LastGeneration = {};
+    LastGeneration.MaxRemovedTiles = static_cast<uint32_t>(MaxRemovedTiles);
+    if (GeneratorSeeds == nullptr || !this->DerivePuzzle()) {
+        sdq::grading::GradeResult grade;
+        do {
+            sdq::metrics::IncrementCounter(MetricCounter_GenerationAttempts);
+            ++LastGeneration.Attempts;
+            attempt_streams.Jump();
+            GameRNG = attempt_streams;
+            if (!this->CreateCompleteBoard())
+                return false;
 
-        if (this->GeneratePuzzle())
-            break;
-    } while (true);
+            if (this->GeneratePuzzle(grade))
+                break;
+        } while (true);
+
+        if (GeneratorSeeds != nullptr)
+            GeneratorSeeds->Add(game_difficulty, sdq::grids::MakeSeedPuzzle(PuzzleBoard, SolutionBoard, grade));
+    }
 
     GameTurnLogs.Reset();
+    this->RebuildBoardCounters();
 
     return true;
 }
@@ -992,11 +1466,9 @@ void Instance::InitializeGameParameters(SudokuDifficulty game_difficulty) noexce
     this->GameDifficulty = game_difficulty;
     switch (game_difficulty)
     {
-    case SudokuDifficulty_Random: {
-        std::uniform_int_distribution<> int_distrib(48, 64);
-        MaxRemovedTiles = int_distrib(GameRNG);
+    case SudokuDifficulty_Random:
+        MaxRemovedTiles = 48 + GameRNG.NextBounded(17);
         break;
-    }
     case SudokuDifficulty_Easy:
         MaxRemovedTiles = 42;
         break;
@@ -1022,52 +1494,81 @@ void Instance::ClearAllBoards() noexcept
 
 bool Instance::CreateCompleteBoard() noexcept
 {
-    SolutionBoard.ClearSudokuBoard();
-
-    static std::array<int, 9> random_numbers = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
-    auto fill_diagonal_cells = [this](int start_row, int end_row, int start_col, int end_col) {
-        std::shuffle(random_numbers.begin(), random_numbers.end(), GameRNG);
-        int num_idx = 0;
-        for (int row = start_row; row < end_row; ++row) {
-            for (int col = start_col; col < end_col; ++col) {
-                SolutionBoard.BoardTiles[row][col].SetTileNumber(random_numbers[num_idx]);
-                num_idx++;
-            }
-        }
-    };
-
-    fill_diagonal_cells(0, 3, 0, 3); // We will fill the three      x o o
-    fill_diagonal_cells(3, 6, 3, 6); // non-connecting diagonal     o x o
-    fill_diagonal_cells(6, 9, 6, 9); // cells of the sudoku board   o o x
+    SDQ_TRACE_SCOPE("Instance::CreateCompleteBoard");
+    if (GeneratorGrids == nullptr)
+        return sdq::grids::FillRandomBoard(SolutionBoard, GameRNG);
 
-    std::shuffle(random_numbers.begin(), random_numbers.end(), GameRNG);
-    if (!sdq::utils::FillSudoku(SolutionBoard, random_numbers))
-        return false;
-
-    SolutionBoard.BoardInitialized = true;
+    sdq::grids::Grid complete_grid;
+    GeneratorGrids->CreateGrid(GameRNG, complete_grid);
+    sdq::grids::GridToBoard(complete_grid, SolutionBoard);
     return true;
 }
 
-bool Instance::GeneratePuzzle() noexcept
+bool Instance::GeneratePuzzle(grading::GradeResult& grade) noexcept
 {
+    SDQ_TRACE_SCOPE("Instance::GeneratePuzzle");
     PuzzleBoard = SolutionBoard;
 
     constexpr size_t max_number_of_tiles = 81;
-    static std::array<std::pair<int, int>, max_number_of_tiles> tiles_to_be_removed = { { {0, 0},{0, 1},{0, 2},{0, 3},{0, 4},{0, 5},{0, 6},{0, 7},{0, 8},{1, 0},{1, 1},{1, 2},{1, 3},{1, 4},{1, 5},{1, 6},{1, 7},{1, 8},{2, 0},{2, 1},{2, 2},{2, 3},{2, 4},{2, 5},{2, 6},{2, 7},{2, 8},{3, 0},{3, 1},{3, 2},{3, 3},{3, 4},{3, 5},{3, 6},{3, 7},{3, 8},{4, 0},{4, 1},{4, 2},{4, 3},{4, 4},{4, 5},{4, 6},{4, 7},{4, 8},{5, 0},{5, 1},{5, 2},{5, 3},{5, 4},{5, 5},{5, 6},{5, 7},{5, 8},{6, 0},{6, 1},{6, 2},{6, 3},{6, 4},{6, 5},{6, 6},{6, 7},{6, 8},{7, 0},{7, 1},{7, 2},{7, 3},{7, 4},{7, 5},{7, 6},{7, 7},{7, 8},{8, 0},{8, 1},{8, 2},{8, 3},{8, 4},{8, 5},{8, 6},{8, 7},{8, 8} } };
+    std::array<std::pair<int, int>, max_number_of_tiles> tiles_to_be_removed = { { {0, 0},{0, 1},{0, 2},{0, 3},{0, 4},{0, 5},{0, 6},{0, 7},{0, 8},{1, 0},{1, 1},{1, 2},{1, 3},{1, 4},{1, 5},{1, 6},{1, 7},{1, 8},{2, 0},{2, 1},{2, 2},{2, 3},{2, 4},{2, 5},{2, 6},{2, 7},{2, 8},{3, 0},{3, 1},{3, 2},{3, 3},{3, 4},{3, 5},{3, 6},{3, 7},{3, 8},{4, 0},{4, 1},{4, 2},{4, 3},{4, 4},{4, 5},{4, 6},{4, 7},{4, 8},{5, 0},{5, 1},{5, 2},{5, 3},{5, 4},{5, 5},{5, 6},{5, 7},{5, 8},{6, 0},{6, 1},{6, 2},{6, 3},{6, 4},{6, 5},{6, 6},{6, 7},{6, 8},{7, 0},{7, 1},{7, 2},{7, 3},{7, 4},{7, 5},{7, 6},{7, 7},{7, 8},{8, 0},{8, 1},{8, 2},{8, 3},{8, 4},{8, 5},{8, 6},{8, 7},{8, 8} } };
     // Shuffle the array so that it would not just remove tiles from the top left to bottom right
     // because there is also a stop flag when a certain number of removed tiles is reached
-    std::shuffle(tiles_to_be_removed.begin(), tiles_to_be_removed.end(), GameRNG);
+    sdq::helpers::Shuffle(tiles_to_be_removed, GameRNG);
+
+    const size_t removed_tiles = GeneratorJobs != nullptr ? this->RemoveCluesSpeculatively(tiles_to_be_removed) : this->RemoveClues(tiles_to_be_removed);
+
+    // Create the neccesary puzzle tiles. Needed for solving the puzzle if someone wanted to, although there is already a solution
+    PuzzleBoard.CreatePuzzleTiles();
+    // Create the neccesary pencil marks of each tiles. Needed especially for most sudoku players
+    PuzzleBoard.ResetAllPencilMarks();
+
+    grade = sdq::grading::GradePuzzle(PuzzleBoard);
+    LastGeneration.GraderScores.push_back(grade.Score);
+    LastGeneration.RemovedTiles = static_cast<uint32_t>(removed_tiles);
+    if (GameDifficulty == SudokuDifficulty_Random)
+        RandomDifficulty = grade.Difficulty;
+    else if (grade.Difficulty != GameDifficulty)
+        return false;
 
-    int removed_tiles = 0;
-    for (int i = 0; i < max_number_of_tiles && removed_tiles < MaxRemovedTiles; ++i) {
-        const auto& row = tiles_to_be_removed[i].first;
-        const auto& col = tiles_to_be_removed[i].second;
+    return true;
+}
+
+bool Instance::DerivePuzzle() noexcept
+{
+    SDQ_TRACE_SCOPE("Instance::DerivePuzzle");
+    sdq::grids::SeedPuzzle derived;
+    if (!GeneratorSeeds->Derive(GameDifficulty, GameRNG, derived))
+        return false;
+
+    sdq::metrics::IncrementCounter(MetricCounter_DerivedPuzzles);
+    sdq::grids::GridToBoard(derived.Solution, SolutionBoard);
+    sdq::grids::GridToBoard(derived.Puzzle, PuzzleBoard);
+    // The same puzzle tiles and pencil marks a generated puzzle gets
+    PuzzleBoard.CreatePuzzleTiles();
+    PuzzleBoard.ResetAllPencilMarks();
+
+    LastGeneration.DerivedFromSeed = true;
+    LastGeneration.GraderScores.push_back(derived.Grade.Score);
+    LastGeneration.RemovedTiles = static_cast<uint32_t>(PuzzleBoard.PuzzleTiles.size());
+    if (GameDifficulty == SudokuDifficulty_Random)
+        RandomDifficulty = derived.Grade.Difficulty;
+
+    return true;
+}
+
+size_t Instance::RemoveClues(const std::array<std::pair<int, int>, 81>& removal_order) noexcept
+{
+    size_t removed_tiles = 0;
+    for (int i = 0; i < 81 && removed_tiles < MaxRemovedTiles; ++i) {
+        const auto& row = removal_order[i].first;
+        const auto& col = removal_order[i].second;
         auto tile_num = PuzzleBoard.BoardTiles[row][col].TileNumber;
         if (tile_num != 0) {
             // Removes the tile
             PuzzleBoard.BoardTiles[row][col].ResetTileNumber();
 
             // Put back the removed tile if the board does not have a unique solution
+            ++LastGeneration.UniquenessChecks;
             if (!sdq::utils::IsUniqueBoard(PuzzleBoard)) {
                 PuzzleBoard.BoardTiles[row][col].SetTileNumber(tile_num);
                 continue;
@@ -1076,17 +1577,106 @@ bool Instance::GeneratePuzzle() noexcept
         }
     }
 
-    // Create the neccesary puzzle tiles. Needed for solving the puzzle if someone wanted to, although there is already a solution
-    PuzzleBoard.CreatePuzzleTiles();
-    // Create the neccesary pencil marks of each tiles. Needed especially for most sudoku players
-    PuzzleBoard.ResetAllPencilMarks();
+    return removed_tiles;
+}
 
-    if (GameDifficulty == SudokuDifficulty_Random)
-        RandomDifficulty = sdq::utils::CheckPuzzleDifficulty(PuzzleBoard);
-    else if (sdq::utils::CheckPuzzleDifficulty(PuzzleBoard) != GameDifficulty)
-        return false;
+size_t Instance::RemoveCluesSpeculatively(const std::array<std::pair<int, int>, 81>& removal_order) noexcept
+{
+    SDQ_TRACE_SCOPE("Instance::RemoveCluesSpeculatively");
+    // Every round tests the next clues of the order at once, each test guessing the outcome of the clues before it in
+    // the round. Uniqueness is monotonic both ways: a unique board stays unique when clues are put back, and a board
+    // with more solutions keeps them when more clues are removed. So a test that removed more clues than the order ends
+    // up removing is still right when it says unique, and one that removed fewer is still right when it says ambiguous.
+    // While removals keep succeeding the tests assume every clue before them is removed, once one fails they only
+    // remove their own clue. The results are used in order up to the first wrong guess that matters, and the round
+    // doesn't wait for the tests after it
+    constexpr uint8_t removal_untested  = 0;
+    constexpr uint8_t removal_testing   = 1;
+    constexpr uint8_t removal_unique    = 2;
+    constexpr uint8_t removal_ambiguous = 3;
+    constexpr uint8_t removal_skipped   = 4;    // The round was done before anyone started the test
 
-    return true;
+    struct RemovalRound
+    {
+        GameBoard                            Board;
+        std::array<std::pair<int, int>, 81>  Tiles;
+        size_t                               Count;
+        bool                                 AssumeRemoved;    // Each test also removes the clues before it in the round
+        std::array<std::atomic<uint8_t>, 81> Results;
+        std::atomic<size_t>                  NextIdx;
+
+        RemovalRound(const GameBoard& board, const std::array<std::pair<int, int>, 81>& tiles, size_t count, bool assume_removed) :
+            Board(board), Tiles(tiles), Count(count), AssumeRemoved(assume_removed), Results{}, NextIdx(0)
+        {}
+
+        // Runs the test unless someone else already took it
+        void TryTest(size_t idx) noexcept
+        {
+            uint8_t untested = removal_untested;
+            if (!Results[idx].compare_exchange_strong(untested, removal_testing, std::memory_order_acq_rel))
+                return;
+
+            GameBoard board = Board;
+            for (size_t removed_idx = AssumeRemoved ? 0 : idx; removed_idx <= idx; ++removed_idx)
+                board.BoardTiles[Tiles[removed_idx].first][Tiles[removed_idx].second].ResetTileNumber();
+            Results[idx].store(sdq::utils::IsUniqueBoard(board) ? removal_unique : removal_ambiguous, std::memory_order_release);
+            Results[idx].notify_all();
+        }
+    };
+
+    const size_t round_width    = GeneratorJobs->GetWorkerCount() + 1;
+    uint32_t     tests_run      = 0;
+    uint32_t     decisions      = 0;
+    bool         assume_removed = true;    // A full board almost always stays unique with a clue less
+    size_t       removed_tiles  = 0;
+    size_t       next_position  = 0;
+    while (next_position < 81 && removed_tiles < MaxRemovedTiles) {
+        std::array<std::pair<int, int>, 81> tiles;
+        const size_t tile_count = std::min(round_width, 81 - next_position);
+        std::copy_n(removal_order.begin() + next_position, tile_count, tiles.begin());
+
+        // A worker job keeps the round alive, so a test that is no longer needed can still finish on its own
+        auto round = std::make_shared<RemovalRound>(PuzzleBoard, tiles, tile_count, assume_removed);
+        for (size_t job_idx = 0; job_idx + 1 < tile_count; ++job_idx) {
+            GeneratorJobs->Submit(JobPriority_High, [round]() {
+                for (size_t idx = round->NextIdx.fetch_add(1, std::memory_order_relaxed); idx < round->Count;
+                     idx = round->NextIdx.fetch_add(1, std::memory_order_relaxed))
+                    round->TryTest(idx);
+            });
+        }
+
+        bool guess_missed = false;
+        for (size_t idx = 0; idx < tile_count && removed_tiles < MaxRemovedTiles; ++idx) {
+            // Tests the clue here if no worker has started it yet, otherwise waits for the worker
+            round->TryTest(idx);
+            uint8_t result = round->Results[idx].load(std::memory_order_acquire);
+            for (; result == removal_testing; result = round->Results[idx].load(std::memory_order_acquire))
+                round->Results[idx].wait(removal_testing, std::memory_order_acquire);
+
+            const bool unique = result == removal_unique;
+            if (guess_missed && unique != assume_removed)
+                break;
+
+            ++decisions;
+            ++next_position;
+            guess_missed |= unique != assume_removed;
+            if (unique) {
+                PuzzleBoard.BoardTiles[tiles[idx].first][tiles[idx].second].ResetTileNumber();
+                ++removed_tiles;
+            }
+        }
+
+        for (size_t idx = 0; idx < tile_count; ++idx) {
+            uint8_t untested = removal_untested;
+            tests_run += !round->Results[idx].compare_exchange_strong(untested, removal_skipped, std::memory_order_acq_rel);
+        }
+
+        assume_removed = PuzzleBoard.BoardTiles[removal_order[next_position - 1].first][removal_order[next_position - 1].second].TileNumber == 0;
+    }
+
+    LastGeneration.UniquenessChecks  += decisions;
+    LastGeneration.SpeculativeChecks += tests_run - decisions;
+    return removed_tiles;
 }
 
 //----------------------------------------------------------------------
@@ -1103,6 +1693,16 @@ SudokuDifficulty Instance::GetBoardDifficulty() const noexcept
     return GameDifficulty == SudokuDifficulty_Random ? RandomDifficulty : GameDifficulty;
 }
 
+uint64_t Instance::GetPuzzleSeed() const noexcept
+{
+    return PuzzleSeed;
+}
+
+const GenerationStats& Instance::GetGenerationStats() const noexcept
+{
+    return LastGeneration;
+}
+
 const GameBoard* Instance::GetSolutionBoard() const noexcept
 {
     return &SolutionBoard;
@@ -1113,6 +1713,21 @@ const TurnLog* Instance::GetTurnLogs() const noexcept
     return &GameTurnLogs;
 }
 
+const std::bitset<81>& Instance::GetConflictTiles() const noexcept
+{
+    return ConflictTiles;
+}
+
+int Instance::GetFilledTileCount() const noexcept
+{
+    return FilledTileCount;
+}
+
+uint32_t Instance::GetElapsedSeconds() const noexcept
+{
+    return ElapsedSeconds;
+}
+
 //----------------------------------------------------------------------
 // Sudoku SETTERS
 //----------------------------------------------------------------------
@@ -1127,16 +1742,8 @@ bool Instance::SetTile(int row, int col, int number) noexcept
 
     GameTurnLogs.Add(input_tile.Row, input_tile.Column, input_tile.TileNumber, number, input_tile.Pencilmarks, input_tile.Pencilmarks);
 
-    // Checks if the input number is valid. If not, still register but return false
-    const auto& occurences = input_tile.GetTileOccurences();
-    input_tile.SetTileNumber(number);
-    
-    PuzzleBoard.UpdateBoardOccurences();
-
-    if (number != 0)
-        PuzzleBoard.UpdateRemovePencilMarks(input_tile.Row, input_tile.Column);
-    else
-        PuzzleBoard.UpdateReapplyPencilMarks(input_tile.Row, input_tile.Column);
+    this->UpdateTileNumber(row, col, number);
+    this->JournalTile(row, col, true);
 
     return true;
 }
@@ -1158,6 +1765,7 @@ void Instance::RemovePencilmark(int row, int col, int number) noexcept
     auto previous_pm = tile.Pencilmarks;
     tile.Pencilmarks.set(number - 1);
     GameTurnLogs.Add(row, col, tile.TileNumber, tile.TileNumber, previous_pm, tile.Pencilmarks);
+    this->JournalTile(row, col, false);
 }
 
 void Instance::AddPencilmark(int row, int col, int number) noexcept
@@ -1167,109 +1775,268 @@ void Instance::AddPencilmark(int row, int col, int number) noexcept
     auto previous_pm = tile.Pencilmarks;
     tile.Pencilmarks.reset(number - 1);
     GameTurnLogs.Add(row, col, tile.TileNumber, tile.TileNumber, previous_pm, tile.Pencilmarks);
+    this->JournalTile(row, col, false);
 }
 
 void Instance::ResetAllPencilmarks() noexcept
 {
+    std::vector<std::bitset<9>> previous_pms;
+    previous_pms.reserve(PuzzleBoard.PuzzleTiles.size());
+    for (const auto& tile : PuzzleBoard.PuzzleTiles)
+        previous_pms.push_back(tile->Pencilmarks);
+
     PuzzleBoard.ResetAllPencilMarks();
+
+    // Only the tiles that changed go in the log, as one undo step
+    GameTurnLogs.BeginGroup();
+    for (size_t idx = 0; idx < PuzzleBoard.PuzzleTiles.size(); ++idx) {
+        const auto& tile = PuzzleBoard.PuzzleTiles[idx];
+        if (tile->Pencilmarks != previous_pms[idx])
+            GameTurnLogs.Add(tile->Row, tile->Column, tile->TileNumber, tile->TileNumber, previous_pms[idx], tile->Pencilmarks);
+    }
+    GameTurnLogs.CommitGroup();
+    this->JournalPuzzleBoard();
 }
 
 void Instance::ClearAllPencilmarks() noexcept
 {
+    GameTurnLogs.BeginGroup();
     for (auto& tile : PuzzleBoard.PuzzleTiles) {
-        tile->Pencilmarks.reset();
-        tile->Pencilmarks.flip();
+        const auto previous_pm = tile->Pencilmarks;
+        tile->Pencilmarks.set();
+        if (tile->Pencilmarks != previous_pm)
+            GameTurnLogs.Add(tile->Row, tile->Column, tile->TileNumber, tile->TileNumber, previous_pm, tile->Pencilmarks);
     }
+    GameTurnLogs.CommitGroup();
+    this->JournalPuzzleBoard();
 }
 
 bool Instance::CheckPuzzleState() const noexcept
 {
-    if (!SolutionBoard.IsBoardCompleted())
-        return false;
-
-    // Checks if the solution board is the same as the puzzle board
-    return SolutionBoard == PuzzleBoard;
+    // An empty solution tile always counts as a mismatch, so an unsolved solution board never passes
+    return SolutionMismatches == 0;
 }
 
-bool Instance::IsValidTile(int row, int col) noexcept
+bool Instance::IsValidTile(int row, int col) const noexcept
 {
-    if (!PuzzleBoard.GetTile(row, col).IsTileFilled())
-        return true;
+    return !ConflictTiles[(row * 9) + col];
+}
 
-    const auto [min_row, max_row, min_col, max_col] = sdq::helpers::GetMinMaxRowColumnFromCell(sdq::helpers::GetCellBlock(row, col));
+void Instance::UndoTurn() noexcept
+{
+    auto previous_turn_tile = GameTurnLogs.GetUndoTile();
+    if (!previous_turn_tile.has_value())
+        return;
 
-    for (int new_row = min_row; new_row < max_row; ++new_row) {
-        for (int new_col = min_col; new_col < max_col; ++new_col) {
-            if (new_row == row && new_col == col)
-                continue;
+    // A group is undone back to its first turn
+    const auto last_turn_tile = previous_turn_tile.value();
+    size_t turn_count = 0;
+    while (true) {
+        this->ApplyUndoTurn(previous_turn_tile.value());
+        GameTurnLogs.Undo();
+        ++turn_count;
+        if (!previous_turn_tile->Linked)
+            break;
 
-            if (PuzzleBoard.GetTile(new_row, new_col).TileNumber == PuzzleBoard.GetTile(row, col).TileNumber)
-                return false;
-        }
+        previous_turn_tile = GameTurnLogs.GetUndoTile();
+        if (!previous_turn_tile.has_value())
+            break;
     }
 
-    for (int new_row = 0; new_row < 9; ++new_row) {
-        if (new_row >= min_row && new_row < max_row)
-            continue;
+    if (turn_count == 1)
+        this->JournalTile(last_turn_tile.Row, last_turn_tile.Column, true);
+    else
+        this->JournalPuzzleBoard();
+}
 
-        if (PuzzleBoard.GetTile(new_row, col).TileNumber == PuzzleBoard.GetTile(row, col).TileNumber)
-            return false;
-    }
+void Instance::RedoTurn() noexcept
+{
+    auto next_turn_tile = GameTurnLogs.GetRedoTile();
+    if (!next_turn_tile.has_value())
+        return;
 
-    for (int new_col = 0; new_col < 9; ++new_col) {
-        if (new_col >= min_col && new_col < max_col)
-            continue;
+    // A group is redone up to its last turn
+    const auto first_turn_tile = next_turn_tile.value();
+    size_t turn_count = 0;
+    do {
+        this->ApplyRedoTurn(next_turn_tile.value());
+        GameTurnLogs.Redo();
+        ++turn_count;
+        next_turn_tile = GameTurnLogs.GetRedoTile();
+    } while (next_turn_tile.has_value() && next_turn_tile->Linked);
+
+    if (turn_count == 1)
+        this->JournalTile(first_turn_tile.Row, first_turn_tile.Column, true);
+    else
+        this->JournalPuzzleBoard();
+}
 
-        if (PuzzleBoard.GetTile(row, new_col).TileNumber == PuzzleBoard.GetTile(row, col).TileNumber)
-            return false;
+void Instance::BeginTransaction() noexcept
+{
+    GameTurnLogs.BeginGroup();
+}
+
+void Instance::CommitTransaction() noexcept
+{
+    GameTurnLogs.CommitGroup();
+}
+
+void Instance::RollbackTransaction() noexcept
+{
+    if (!GameTurnLogs.IsGroupOpen())
+        return;
+
+    for (size_t turn_count = GameTurnLogs.GetGroupTurnCount(); turn_count > 0; --turn_count) {
+        this->ApplyUndoTurn(GameTurnLogs.GetUndoTile().value());
+        GameTurnLogs.Undo();
     }
+    GameTurnLogs.RollbackGroup();
+    this->JournalPuzzleBoard();
+}
 
-    return true;
+void Instance::ApplyUndoTurn(const TurnLog::TurnTile& turn_tile) noexcept
+{
+    this->UpdateTileNumber(turn_tile.Row, turn_tile.Column, turn_tile.PreviousNumber);
+    PuzzleBoard.GetTile(turn_tile.Row, turn_tile.Column).Pencilmarks = turn_tile.PreviousPencilmark;
 }
 
-void Instance::UndoTurn() noexcept
+void Instance::ApplyRedoTurn(const TurnLog::TurnTile& turn_tile) noexcept
 {
-    auto previous_turn_tile = GameTurnLogs.GetUndoTile();
-    if (previous_turn_tile == nullptr)
+    auto& input_tile = PuzzleBoard.GetTile(turn_tile.Row, turn_tile.Column);
+
+    if (input_tile.TileNumber == turn_tile.NextNumber)
+        input_tile.Pencilmarks = turn_tile.NextPencilmark;
+    else
+        this->UpdateTileNumber(turn_tile.Row, turn_tile.Column, turn_tile.NextNumber);
+}
+
+void Instance::SetJournal(save::Journal* journal) noexcept
+{
+    GameJournal = journal;
+}
+
+void Instance::SetGradeCache(grading::GradeCache* grade_cache) noexcept
+{
+    GameGradeCache = grade_cache;
+}
+
+void Instance::SetJobSystem(jobs::JobSystem* job_system) noexcept
+{
+    GeneratorJobs = job_system;
+}
+
+void Instance::SetGridFactory(const grids::GridFactory* grid_factory) noexcept
+{
+    GeneratorGrids = grid_factory;
+}
+
+void Instance::SetPuzzleSeeds(grids::PuzzleSeedSet* puzzle_seeds) noexcept
+{
+    GeneratorSeeds = puzzle_seeds;
+}
+
+void Instance::SetElapsedSeconds(uint32_t elapsed_seconds) noexcept
+{
+    ElapsedSeconds = elapsed_seconds;
+}
+
+void Instance::UpdateTileNumber(int row, int col, int number) noexcept
+{
+    const int tile_idx = (row * 9) + col;
+    const int prev_num = PuzzleBoard.GetTile(row, col).TileNumber;
+    if (prev_num == number)
         return;
 
-    auto& input_tile = PuzzleBoard.GetTile(previous_turn_tile->Row, previous_turn_tile->Column);
-    if (input_tile.TileNumber != previous_turn_tile->PreviousNumber) {
-        input_tile.SetTileNumber(previous_turn_tile->PreviousNumber);
-        PuzzleBoard.UpdateBoardOccurences(input_tile.Row, input_tile.Column);
+    PuzzleBoard.UpdateTileNumber(row, col, number);
 
-        if (previous_turn_tile->PreviousNumber != 0)
-            PuzzleBoard.UpdateRemovePencilMarks(input_tile.Row, input_tile.Column);
-        else
-            PuzzleBoard.UpdateReapplyPencilMarks(input_tile.Row, input_tile.Column);
+    const std::array<int, 3> units = { row, 9 + col, 18 + sdq::helpers::GetCellBlock(row, col) };
+    for (const int unit : units) {
+        if (prev_num != 0)
+            --UnitDigitCounts[unit][prev_num - 1];
+        if (number != 0)
+            ++UnitDigitCounts[unit][number - 1];
     }
 
-    input_tile.Pencilmarks = previous_turn_tile->PreviousPencilmark;
+    FilledTileCount += (number != 0) - (prev_num != 0);
 
-    GameTurnLogs.Undo();
+    const int solution_number = SolutionBoard.GetTile(row, col).TileNumber;
+    SolutionMismatches += (solution_number == 0 || number != solution_number) - (solution_number == 0 || prev_num != solution_number);
+
+    // Only the tile and its peers share a unit whose counts changed
+    this->UpdateTileConflict(tile_idx);
+    for (const auto peer_idx : sdq::helpers::GetPeers(row, col))
+        this->UpdateTileConflict(peer_idx);
 }
 
-void Instance::RedoTurn() noexcept
+void Instance::RebuildBoardCounters() noexcept
 {
-    auto next_turn_tile = GameTurnLogs.GetRedoTile();
-    if (next_turn_tile == nullptr)
+    for (auto& unit_counts : UnitDigitCounts)
+        unit_counts.fill(0);
+    FilledTileCount    = 0;
+    SolutionMismatches = 0;
+
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        const int row = tile_idx / 9, col = tile_idx % 9;
+        const int number          = PuzzleBoard.GetTile(row, col).TileNumber;
+        const int solution_number = SolutionBoard.GetTile(row, col).TileNumber;
+        if (solution_number == 0 || number != solution_number)
+            ++SolutionMismatches;
+        if (number == 0)
+            continue;
+
+        ++FilledTileCount;
+        ++UnitDigitCounts[row][number - 1];
+        ++UnitDigitCounts[9 + col][number - 1];
+        ++UnitDigitCounts[18 + sdq::helpers::GetCellBlock(row, col)][number - 1];
+    }
+
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx)
+        this->UpdateTileConflict(tile_idx);
+}
+
+void Instance::UpdateTileConflict(int tile_idx) noexcept
+{
+    const int row = tile_idx / 9, col = tile_idx % 9;
+    const int number = PuzzleBoard.GetTile(row, col).TileNumber;
+    if (number == 0) {
+        ConflictTiles.reset(tile_idx);
         return;
+    }
 
-    auto& input_tile = PuzzleBoard.GetTile(next_turn_tile->Row, next_turn_tile->Column);
+    ConflictTiles[tile_idx] = UnitDigitCounts[row][number - 1] > 1 || UnitDigitCounts[9 + col][number - 1] > 1 ||
+                              UnitDigitCounts[18 + sdq::helpers::GetCellBlock(row, col)][number - 1] > 1;
+}
 
-    if (input_tile.TileNumber == next_turn_tile->NextNumber)
-        input_tile.Pencilmarks = next_turn_tile->NextPencilmark;
-    else {
-        input_tile.SetTileNumber(next_turn_tile->NextNumber);
-        PuzzleBoard.UpdateBoardOccurences(input_tile.Row, input_tile.Column);
+static save::JournalEntry MakeJournalEntry(const GameBoard& board, int tile_idx) noexcept
+{
+    const auto& tile = board.GetTile(tile_idx / 9, tile_idx % 9);
+    return { static_cast<uint8_t>(tile_idx), static_cast<uint8_t>(tile.TileNumber), static_cast<uint16_t>(tile.Pencilmarks.to_ulong()) };
+}
 
-        if (next_turn_tile->NextNumber != 0)
-            PuzzleBoard.UpdateRemovePencilMarks(input_tile.Row, input_tile.Column);
-        else
-            PuzzleBoard.UpdateReapplyPencilMarks(input_tile.Row, input_tile.Column);
+void Instance::JournalTile(int row, int col, bool with_peers) const noexcept
+{
+    if (GameJournal == nullptr)
+        return;
+
+    std::array<save::JournalEntry, 21> tiles;
+    tiles[0] = MakeJournalEntry(PuzzleBoard, (row * 9) + col);
+    if (with_peers) {
+        const auto& peers = helpers::GetPeers(row, col);
+        for (size_t idx = 0; idx < peers.size(); ++idx)
+            tiles[idx + 1] = MakeJournalEntry(PuzzleBoard, peers[idx]);
     }
+    GameJournal->Record(tiles.data(), with_peers ? tiles.size() : 1, ElapsedSeconds);
+}
+
+void Instance::JournalPuzzleBoard() const noexcept
+{
+    if (GameJournal == nullptr)
+        return;
 
-    GameTurnLogs.Redo();
+    std::array<save::JournalEntry, 81> tiles;
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx)
+        tiles[tile_idx] = MakeJournalEntry(PuzzleBoard, tile_idx);
+    GameJournal->Record(tiles.data(), tiles.size(), ElapsedSeconds);
 }
 
 }
@@ -1374,9 +2141,11 @@ bool SolveMRV(GameBoard& sudoku_board) noexcept
     return SolveMRVEX(sudoku_board);
 }
 
-bool SolveHumanelyEX(GameBoard& sudoku_board, size_t& difficulty_score) noexcept
+bool SolveHumanelyEX(GameBoard& sudoku_board, size_t& difficulty_score, UsedSudokuTechnique* techniques_out) noexcept
 {
-    int used_techniques = 0;
+    UsedSudokuTechnique  local_techniques = UsedSudokuTechnique_None;
+    UsedSudokuTechnique& used_techniques  = techniques_out != nullptr ? *techniques_out : local_techniques;
+    used_techniques = UsedSudokuTechnique_None;
     while (true) {
         if (size_t count = techs::FindSingleCandidates(sudoku_board)) {
             difficulty_score += count * 100;
@@ -1483,6 +2252,18 @@ bool SolveHumanelyEX(GameBoard& sudoku_board, size_t& difficulty_score) noexcept
                 continue;
         }
 
+        if (size_t count = techs::FindSimpleColorings(sudoku_board)) {
+            difficulty_score += (used_techniques & UsedSudokuTechnique_SimpleColoring) ? count * 3000 : 4500 + ((count - 1) * 3000);
+            used_techniques |= UsedSudokuTechnique_SimpleColoring;
+            continue;
+        }
+
+        if (size_t count = techs::FindXYChains(sudoku_board)) {
+            difficulty_score += (used_techniques & UsedSudokuTechnique_XYChain) ? count * 4500 : 6500 + ((count - 1) * 4500);
+            used_techniques |= UsedSudokuTechnique_XYChain;
+            continue;
+        }
+
         break;
     }
 
@@ -1570,6 +2351,8 @@ void CountSolutions(GameBoard& sudoku_board, size_t& number_of_solutions, int co
 
 bool IsUniqueBoard(GameBoard& sudoku_board) noexcept
 {
+    SDQ_TRACE_SCOPE("utils::IsUniqueBoard");
+    sdq::metrics::IncrementCounter(MetricCounter_UniquenessChecks);
     size_t number_of_solutions = 0;
     CountSolutions(sudoku_board, number_of_solutions, 0, 0);
     return number_of_solutions == 1;
@@ -1611,36 +2394,24 @@ void PrintBoard(const sdq::GameBoard& board) noexcept
 
 SudokuDifficulty CheckPuzzleDifficulty(const GameBoard& sudoku_board) noexcept
 {
+    SDQ_TRACE_SCOPE("utils::CheckPuzzleDifficulty");
+    sdq::metrics::IncrementCounter(MetricCounter_GraderRuns);
     size_t difficulty_score = 0;
     auto sudoku_board_copy = sudoku_board;
     sdq::solvers::SolveHumanelyEX(sudoku_board_copy, difficulty_score);
 
-    if (difficulty_score < 5000 && sudoku_board_copy.IsBoardCompleted()) {
-        return SudokuDifficulty_Easy;
-    }
-    if (difficulty_score > 5000 && difficulty_score < 12000 && sudoku_board_copy.IsBoardCompleted()) {
-        return SudokuDifficulty_Normal;
-    }
-    if (difficulty_score > 12000 && difficulty_score < 24000 && sudoku_board_copy.IsBoardCompleted()) {
-        return SudokuDifficulty_Insane;
-    }
-    if (!sudoku_board_copy.IsBoardCompleted()) {
-        size_t blank_count = std::count_if(sudoku_board_copy.PuzzleTiles.begin(), sudoku_board_copy.PuzzleTiles.end(), [&](const BoardTile* tile) { return !tile->IsTileFilled(); });
-        if (blank_count < 5 && difficulty_score < 5000) {
-            return SudokuDifficulty_Easy;
-        }
-        if (blank_count < 10 && difficulty_score < 12000) {
-            return SudokuDifficulty_Normal;
-        }
-        if (blank_count < 25 && difficulty_score < 24000) {
-            return SudokuDifficulty_Insane;
-        }
-    }
-    return SudokuDifficulty_Diabolical;
+    const bool puzzle_completed = sudoku_board_copy.IsBoardCompleted();
+    size_t blank_count = 0;
+    if (!puzzle_completed)
+        blank_count = std::count_if(sudoku_board_copy.PuzzleTiles.begin(), sudoku_board_copy.PuzzleTiles.end(), [&](const BoardTile* tile) { return !tile->IsTileFilled(); });
+
+    return GetDifficultyFromScore(difficulty_score, puzzle_completed, blank_count);
 }
 
 SudokuDifficulty CheckPuzzleDifficulty(GameBoard& sudoku_board) noexcept
 {
+    SDQ_TRACE_SCOPE("utils::CheckPuzzleDifficulty");
+    sdq::metrics::IncrementCounter(MetricCounter_GraderRuns);
     size_t difficulty_score = 0;
     size_t blank_count = 0;
     const bool puzzle_completed = sdq::solvers::SolveHumanelyEX(sudoku_board, difficulty_score);
@@ -1652,6 +2423,11 @@ SudokuDifficulty CheckPuzzleDifficulty(GameBoard& sudoku_board) noexcept
     for (auto& ptile : sudoku_board.PuzzleTiles)
         ptile->ResetPencilmarks();
 
+    return GetDifficultyFromScore(difficulty_score, puzzle_completed, blank_count);
+}
+
+SudokuDifficulty GetDifficultyFromScore(size_t difficulty_score, bool puzzle_completed, size_t blank_count) noexcept
+{
     if (difficulty_score < 5000 && puzzle_completed)
         return SudokuDifficulty_Easy;
     if (difficulty_score > 5000 && difficulty_score < 12000 && puzzle_completed)
@@ -1727,6 +2503,7 @@ namespace sdq::techs
 //
 size_t FindSinglePosition(GameBoard& sudoku_board) noexcept
 {
+    SDQ_TRACE_SCOPE("techs::FindSinglePosition");
     size_t count = 0;
 
     for (int cell = 0; cell < 9; ++cell) {
@@ -1758,6 +2535,7 @@ size_t FindSinglePosition(GameBoard& sudoku_board) noexcept
 //
 size_t FindSingleCandidates(GameBoard& sudoku_board) noexcept
 {
+    SDQ_TRACE_SCOPE("techs::FindSingleCandidates");
     size_t count = 0;
 
     for (auto& tile : sudoku_board.PuzzleTiles) {
@@ -1786,6 +2564,7 @@ size_t FindSingleCandidates(GameBoard& sudoku_board) noexcept
 //
 size_t FindCandidateLines(GameBoard& sudoku_board) noexcept
 {
+    SDQ_TRACE_SCOPE("techs::FindCandidateLines");
     size_t count = 0;
 
     auto candidate_lines_lambda = [&](std::array<std::bitset<9>, 3> total_line_bitset, int min_line_index, int cell_number, int row_or_column) {
@@ -1842,6 +2621,7 @@ size_t FindCandidateLines(GameBoard& sudoku_board) noexcept
 //
 size_t FindIntersections(GameBoard& sudoku_board) noexcept
 {
+    SDQ_TRACE_SCOPE("techs::FindIntersections");
     size_t count = 0;
 
     auto intersection_lambda = [&](int line_index, const int row_or_column, const std::array<std::bitset<9>, 3> line_bitsets) {
@@ -1897,6 +2677,7 @@ size_t FindIntersections(GameBoard& sudoku_board) noexcept
 //
 std::tuple<size_t, size_t, size_t> FindNakedTuples(GameBoard& sudoku_board) noexcept
 {
+    SDQ_TRACE_SCOPE("techs::FindNakedTuples");
     size_t pair_count   = 0;
     size_t triple_count = 0;
     size_t quad_count   = 0;
@@ -2128,6 +2909,7 @@ std::tuple<size_t, size_t, size_t> FindNakedTuples(GameBoard& sudoku_board) noex
 //
 std::tuple<size_t, size_t, size_t> FindHiddenTuples(GameBoard& sudoku_board) noexcept
 {
+    SDQ_TRACE_SCOPE("techs::FindHiddenTuples");
     size_t pair_count   = 0;
     size_t triple_count = 0;
     size_t quad_count   = 0;
@@ -2321,6 +3103,7 @@ std::tuple<size_t, size_t, size_t> FindHiddenTuples(GameBoard& sudoku_board) noe
 //
 size_t FindYWings(GameBoard& sudoku_board) noexcept
 {
+    SDQ_TRACE_SCOPE("techs::FindYWings");
     size_t count = 0;
 
     // We first get the first possible pivot tile
@@ -2480,6 +3263,7 @@ size_t FindYWings(GameBoard& sudoku_board) noexcept
 //
 std::tuple<size_t, size_t, size_t> FindFishes(GameBoard& sudoku_board) noexcept
 {
+    SDQ_TRACE_SCOPE("techs::FindFishes");
     size_t xwing_count     = 0;
     size_t swordfish_count = 0;
     size_t jellyfish_count = 0;
@@ -2703,6 +3487,237 @@ std::tuple<size_t, size_t, size_t> FindFishes(GameBoard& sudoku_board) noexcept
     return { xwing_count, swordfish_count, jellyfish_count };
 }
 
+//----------------------------------------------------------------------------------------------------------------------------------------------
+// Chain Techniques
+//----------------------------------------------------------------------------------------------------------------------------------------------
+
+// Set of tiles as a bitmap, bit N is tile N (row * 9 + col). A whole unit or every peer of a tile is one AND or OR,
+// and only the set bits are visited when walking the tiles of a mask
+struct TileMask
+{
+    uint64_t Low  = 0;    // Tiles 0-63
+    uint64_t High = 0;    // Tiles 64-80
+
+    static constexpr uint64_t HighTiles = (uint64_t(1) << 17) - 1;
+
+    constexpr void Set(int tile_idx) noexcept             { tile_idx < 64 ? Low |= uint64_t(1) << tile_idx : High |= uint64_t(1) << (tile_idx - 64); }
+    constexpr bool Test(int tile_idx) const noexcept      { return ((tile_idx < 64 ? Low >> tile_idx : High >> (tile_idx - 64)) & 1) != 0; }
+    constexpr bool Any() const noexcept                   { return (Low | High) != 0; }
+    int            Count() const noexcept                 { return std::popcount(Low) + std::popcount(High); }
+
+    constexpr TileMask  operator ~ () const noexcept                  { return { ~Low, ~High & HighTiles }; }
+    constexpr TileMask  operator & (const TileMask& other) const noexcept { return { Low & other.Low, High & other.High }; }
+    constexpr TileMask  operator | (const TileMask& other) const noexcept { return { Low | other.Low, High | other.High }; }
+    constexpr TileMask& operator |= (const TileMask& other) noexcept      { Low |= other.Low; High |= other.High; return *this; }
+
+    template<typename Func>
+    void ForEach(Func func) const noexcept
+    {
+        for (uint64_t bits = Low; bits != 0; bits &= bits - 1)
+            func(std::countr_zero(bits));
+        for (uint64_t bits = High; bits != 0; bits &= bits - 1)
+            func(64 + std::countr_zero(bits));
+    }
+};
+
+// Longest XY-chain followed, in tiles. Longer chains are rare in puzzles the grader is meant to rate and cost the most
+constexpr int MaxXYChainLength = 12;
+
+struct ChainMasks
+{
+    std::array<TileMask, 81> Peers;
+    std::array<TileMask, 27> Units;    // Rows 0-8, columns 9-17, cells 18-26
+};
+
+static constexpr ChainMasks CreateChainMasks() noexcept
+{
+    ChainMasks masks = {};
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        const int row = tile_idx / 9, col = tile_idx % 9;
+        for (const auto peer_idx : helpers::PeerTable[tile_idx])
+            masks.Peers[tile_idx].Set(peer_idx);
+
+        masks.Units[row].Set(tile_idx);
+        masks.Units[9 + col].Set(tile_idx);
+        masks.Units[18 + helpers::GetCellBlock(row, col)].Set(tile_idx);
+    }
+
+    return masks;
+}
+
+static constexpr ChainMasks TileMasks = CreateChainMasks();
+
+// Every tile that sees at least one tile of the mask
+static TileMask GetPeersOfMask(const TileMask& tiles) noexcept
+{
+    TileMask peers;
+    tiles.ForEach([&peers](int tile_idx) { peers |= TileMasks.Peers[tile_idx]; });
+    return peers;
+}
+
+// Removes the candidate from every tile of the mask. Returns true if the mask had any tile
+static bool EliminateCandidate(GameBoard& sudoku_board, const TileMask& tiles, int bit_number) noexcept
+{
+    tiles.ForEach([&sudoku_board, bit_number](int tile_idx) { sudoku_board.BoardTiles[tile_idx / 9][tile_idx % 9].Pencilmarks.set(bit_number); });
+    return tiles.Any();
+}
+
+// Candidate bitmaps of the board. An entry has every empty tile that can still hold the number
+static std::array<TileMask, 9> GetCandidateTiles(const GameBoard& sudoku_board) noexcept
+{
+    std::array<TileMask, 9> candidate_tiles = {};
+    for (const auto* puzzle_tile : sudoku_board.PuzzleTiles) {
+        if (puzzle_tile->IsTileFilled())
+            continue;
+
+        const int tile_idx = (puzzle_tile->Row * 9) + puzzle_tile->Column;
+        for (int bit_num = 0; bit_num < 9; ++bit_num)
+            if (!puzzle_tile->Pencilmarks[bit_num])
+                candidate_tiles[bit_num].Set(tile_idx);
+    }
+
+    return candidate_tiles;
+}
+
+size_t FindSimpleColorings(GameBoard& sudoku_board) noexcept
+{
+    SDQ_TRACE_SCOPE("techs::FindSimpleColorings");
+    size_t count = 0;
+
+    // Eliminations of a number never change the candidates of the other numbers
+    const auto candidate_tiles = GetCandidateTiles(sudoku_board);
+    for (int bit_num = 0; bit_num < 9; ++bit_num) {
+        const TileMask& candidates = candidate_tiles[bit_num];
+
+        // A conjugate pair is a unit where the number has exactly two places left, one of them has to be the number
+        std::array<TileMask, 81> conjugates;
+        TileMask paired_tiles;
+        for (const auto& unit : TileMasks.Units) {
+            const TileMask unit_candidates = candidates & unit;
+            if (unit_candidates.Count() != 2)
+                continue;
+
+            unit_candidates.ForEach([&conjugates, &unit_candidates](int tile_idx) { conjugates[tile_idx] |= unit_candidates; });
+            paired_tiles |= unit_candidates;
+        }
+
+        // Colors every chain of conjugate pairs with two colors. Exactly one of the colors holds the number
+        TileMask colored_tiles;
+        paired_tiles.ForEach([&](int start_idx) {
+            if (colored_tiles.Test(start_idx))
+                return;
+
+            std::array<TileMask, 2> colors;
+            TileMask frontier;
+            frontier.Set(start_idx);
+            for (int color = 0; frontier.Any(); color ^= 1) {
+                colors[color] |= frontier;
+                colored_tiles |= frontier;
+                TileMask next_frontier;
+                frontier.ForEach([&next_frontier, &conjugates](int tile_idx) { next_frontier |= conjugates[tile_idx]; });
+                frontier = next_frontier & ~colored_tiles;
+            }
+
+            // One pair on its own is only a locked candidate, which the easier techniques already handle
+            if ((colors[0] | colors[1]).Count() < 3)
+                return;
+
+            // Color wrap: two tiles of the same color see each other, so that color can't be the number
+            const std::array<TileMask, 2> color_peers = { GetPeersOfMask(colors[0]), GetPeersOfMask(colors[1]) };
+            bool eliminated = false;
+            for (int color = 0; color < 2 && !eliminated; ++color) {
+                if ((color_peers[color] & colors[color]).Any())
+                    eliminated = EliminateCandidate(sudoku_board, colors[color], bit_num);
+            }
+
+            // Color trap: a tile that sees both colors can't be the number, whichever color is right
+            if (!eliminated) {
+                const TileMask trapped_tiles = candidates & ~(colors[0] | colors[1]) & color_peers[0] & color_peers[1];
+                eliminated = EliminateCandidate(sudoku_board, trapped_tiles, bit_num);
+            }
+
+            if (eliminated)
+                ++count;
+        });
+    }
+
+    return count;
+}
+
+size_t FindXYChains(GameBoard& sudoku_board) noexcept
+{
+    SDQ_TRACE_SCOPE("techs::FindXYChains");
+    size_t count = 0;
+
+    // pair_tiles[a][b] has the empty tiles whose only candidates are a and b
+    const auto candidate_tiles = GetCandidateTiles(sudoku_board);
+    std::array<std::array<TileMask, 9>, 9> pair_tiles = {};
+    TileMask bivalue_tiles;
+    for (const auto* puzzle_tile : sudoku_board.PuzzleTiles) {
+        if (puzzle_tile->IsTileFilled() || puzzle_tile->Pencilmarks.count() != 7)
+            continue;
+
+        std::array<int, 2> pair_numbers;
+        int pair_count = 0;
+        for (int bit_num = 0; bit_num < 9; ++bit_num)
+            if (!puzzle_tile->Pencilmarks[bit_num])
+                pair_numbers[pair_count++] = bit_num;
+
+        const int tile_idx = (puzzle_tile->Row * 9) + puzzle_tile->Column;
+        pair_tiles[pair_numbers[0]][pair_numbers[1]].Set(tile_idx);
+        pair_tiles[pair_numbers[1]][pair_numbers[0]].Set(tile_idx);
+        bivalue_tiles.Set(tile_idx);
+    }
+
+    // The chain starts on a bivalue tile assuming it is not x, so its other number is on. Every link goes to a
+    // bivalue peer that holds the number that is on, which turns that number off and the peer's other number on.
+    // All links of a chain length are followed at once, one tile mask per number
+    bivalue_tiles.ForEach([&](int start_idx) {
+        TileMask start_tile;
+        start_tile.Set(start_idx);
+        for (int x_num = 0; x_num < 9; ++x_num) {
+            if (!candidate_tiles[x_num].Test(start_idx))
+                continue;
+
+            std::array<TileMask, 9> off_tiles = {};    // Tiles reached with the number turned off, by that number
+            std::array<TileMask, 9> visited   = {};
+            off_tiles[x_num] = start_tile;
+            visited[x_num]   = start_tile;
+
+            TileMask eliminations;
+            for (int chain_length = 1; chain_length < MaxXYChainLength; ++chain_length) {
+                // The number that is on in each reached tile is the other number of its pair
+                std::array<TileMask, 9> on_tiles = {};
+                for (int off_num = 0; off_num < 9; ++off_num) {
+                    if (!off_tiles[off_num].Any())
+                        continue;
+                    for (int on_num = 0; on_num < 9; ++on_num)
+                        on_tiles[on_num] |= off_tiles[off_num] & pair_tiles[off_num][on_num];
+                }
+
+                // Either the start tile is x or a chain end with x on is, so a tile seeing both can't be x
+                const TileMask chain_ends = on_tiles[x_num] & ~start_tile;
+                if (chain_ends.Any())
+                    eliminations |= candidate_tiles[x_num] & TileMasks.Peers[start_idx] & GetPeersOfMask(chain_ends) & ~chain_ends;
+
+                bool extended = false;
+                for (int on_num = 0; on_num < 9; ++on_num) {
+                    off_tiles[on_num] = on_tiles[on_num].Any() ? GetPeersOfMask(on_tiles[on_num]) & candidate_tiles[on_num] & bivalue_tiles & ~visited[on_num] : TileMask();
+                    visited[on_num] |= off_tiles[on_num];
+                    extended = extended || off_tiles[on_num].Any();
+                }
+                if (!extended)
+                    break;
+            }
+
+            if (EliminateCandidate(sudoku_board, eliminations, x_num))
+                ++count;
+        }
+    });
+
+    return count;
+}
+
 }
 
 
@@ -2,12 +2,17 @@
 
 #include <vector>
 #include <array>
+#include <cstdint>
 #include <bitset>
 #include <iostream>
 #include <algorithm>
 #include <cassert>
 #include <random>
 #include <chrono>
+#include <memory>
+#include <optional>
+#include "sdq_save.h"
+#include "sdq_journal.h"
 #include "boost/archive/binary_iarchive.hpp"
 #include "boost/archive/binary_oarchive.hpp"
 #include "boost/serialization/bitset.hpp"
@@ -47,7 +52,9 @@ enum UsedSudokuTechnique_
     UsedSudokuTechnique_XWing          = 1 << 8,
     UsedSudokuTechnique_YWing          = 1 << 9,
     UsedSudokuTechnique_SwordFish      = 1 << 10,
-    UsedSudokuTechnique_JellyFish      = 1 << 11
+    UsedSudokuTechnique_JellyFish      = 1 << 11,
+    UsedSudokuTechnique_SimpleColoring = 1 << 12,
+    UsedSudokuTechnique_XYChain        = 1 << 13
 };
 
 enum SolveMethod_
@@ -86,6 +93,7 @@ public:
     void SetCellNumber(int row, int col, int number) noexcept;
     void ResetCellNumber(int row, int col, int number) noexcept;
 
+    bool operator == (const BoardOccurences& other) const noexcept;
 };
 
 // Structure holds the important parameters of a sudoku tile
@@ -135,6 +143,8 @@ struct GameBoard
     bool       CreateSudokuBoard(const std::array<std::array<int, 9>, 9>& sudoku_board, bool create_puzzletiles_vec = true) noexcept;
     void       UpdateBoardOccurences() noexcept;
     void       UpdateBoardOccurences(int row, int column) noexcept;
+    // Sets the number of a tile and updates only what it affects: the masks of its 3 units and the pencilmarks of its 20 peers
+    void       UpdateTileNumber(int row, int column, int number) noexcept;
     void       ClearSudokuBoard() noexcept;
     bool       IsBoardCompleted() const noexcept;
     void       CreatePuzzleTiles() noexcept;
@@ -166,8 +176,35 @@ struct GameBoard
 
 private:
     bool CreateBoardOccurences(const std::array<std::array<int, 9>, 9>& board) noexcept;
+    // True if the unit masks match a full rebuild from the tiles
+    bool IsBoardOccurencesConsistent() const noexcept;
 };
 
+// Small random bit generator (xoshiro256**) with 32 bytes of state. Jump() advances the generator by 2^128 steps,
+// so one seed can be split into many non-overlapping streams that stay the same no matter who consumes them
+class Xoshiro256
+{
+private:
+    std::array<uint64_t, 4> State;
+
+public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256(uint64_t seed = 0) noexcept;
+
+    static constexpr result_type min() noexcept { return 0; }
+    static constexpr result_type max() noexcept { return UINT64_MAX; }
+
+    void        Seed(uint64_t seed) noexcept;
+    result_type operator()() noexcept;
+    void        Jump() noexcept;
+    // Unbiased number in [0, bound)
+    uint64_t    NextBounded(uint64_t bound) noexcept;
+};
+
+// Undo/redo history of the puzzle board.
+// Every turn is packed into 4 bytes and kept in a ring of fixed size chunks. When the memory cap is reached the oldest
+// turns are dropped, so a long session can't grow the history without limit. Undo, redo and adding a turn are O(1).
 class TurnLog
 {
 public:
@@ -179,25 +216,65 @@ public:
         int NextNumber;
         std::bitset<9> PreviousPencilmark;
         std::bitset<9> NextPencilmark;
+        bool Linked;    // Part of the same group as the turn before it. A group is undone and redone as one turn
 
         TurnTile() noexcept 
-            : Row(0), Column(0), PreviousNumber(0), NextNumber(0), PreviousPencilmark(0), NextPencilmark(0) {};
-        TurnTile(int _row, int _col, int prev_num, int next_num, const std::bitset<9>& prev_pm, const std::bitset<9>& next_pm) noexcept 
-            : Row(_row), Column(_col), PreviousNumber(prev_num), NextNumber(next_num), PreviousPencilmark(prev_pm), NextPencilmark(next_pm) {}
+            : Row(0), Column(0), PreviousNumber(0), NextNumber(0), PreviousPencilmark(0), NextPencilmark(0), Linked(false) {};
+        TurnTile(int _row, int _col, int prev_num, int next_num, const std::bitset<9>& prev_pm, const std::bitset<9>& next_pm, bool linked = false) noexcept 
+            : Row(_row), Column(_col), PreviousNumber(prev_num), NextNumber(next_num), PreviousPencilmark(prev_pm), NextPencilmark(next_pm), Linked(linked) {}
     };
+
+    static constexpr size_t ChunkTurns       = 1024;
+    static constexpr size_t DefaultMemoryCap = 256 * 1024;   // In bytes, 64K turns
+
 private:
-    std::vector<TurnTile> TilesUsed;
+    using TurnChunk = std::array<uint32_t, ChunkTurns>;
+
+    std::vector<std::unique_ptr<TurnChunk>> Chunks;
+    size_t MaxChunks;
+    size_t FirstTurn;      // Ring position of the oldest turn
+    size_t TurnCount;
     size_t UndoPosition;
+    size_t GroupStart;     // First turn of the open group
+    bool   GroupOpen;
+    bool   GroupHasTurns;  // The open group added a turn, which dropped the redo tail. An empty group keeps it
+
 public:
-    TurnLog() noexcept;
+    explicit TurnLog(size_t memory_cap = DefaultMemoryCap) noexcept;
+    TurnLog(const TurnLog& other) noexcept;
+    TurnLog& operator = (const TurnLog& other) noexcept;
+
     void Add(int _row, int _col, int prev_num, int next_num, const std::bitset<9>& prev_pm = 0, const std::bitset<9>& next_pm = 0) noexcept;
     void Undo() noexcept;
     void Redo() noexcept;
     void Reset() noexcept;
+    // Turns added between BeginGroup and CommitGroup are undone and redone together
+    void BeginGroup() noexcept;
+    void CommitGroup() noexcept;
+    // Closes the group and drops its turns. The caller must have undone them first
+    void RollbackGroup() noexcept;
+    bool IsGroupOpen() const noexcept;
+    // Number of turns of the open group that are not undone
+    size_t GetGroupTurnCount() const noexcept;
+    // Drops the history and limits it to about memory_cap bytes from now on
+    void SetMemoryCap(size_t memory_cap) noexcept;
     bool CanUndo() const noexcept;
     bool CanRedo() const noexcept;
-    const TurnTile* GetUndoTile() const noexcept;
-    const TurnTile* GetRedoTile() const noexcept;
+    std::optional<TurnTile> GetUndoTile() const noexcept;
+    std::optional<TurnTile> GetRedoTile() const noexcept;
+
+    // Packed turns for the save file
+    void ExportHistory(save::TurnHistory& history) const noexcept;
+    bool ImportHistory(const save::TurnHistory& history) noexcept;
+
+    // The 4 byte turn of the save file. Shared with the session manager, which keeps its turns in the same layout
+    static uint32_t PackTurn(const TurnTile& turn_tile) noexcept;
+    static TurnTile UnpackTurn(uint32_t packed_turn) noexcept;
+    static bool     IsValidPackedTurn(uint32_t packed_turn) noexcept;
+
+private:
+    uint32_t&       GetPackedTurn(size_t turn_idx) noexcept;
+    const uint32_t& GetPackedTurn(size_t turn_idx) const noexcept;
 };
 
 //class Time
@@ -216,6 +293,35 @@ public:
 //    std::optional<std::tm> GetTimeDuration();
 //};
 
+namespace grading
+{
+class GradeCache;
+struct GradeResult;
+}
+
+namespace jobs
+{
+class JobSystem;
+}
+
+namespace grids
+{
+class GridFactory;
+class PuzzleSeedSet;
+}
+
+// What the last CreateSudoku(difficulty) went through to find its puzzle. Used to tune the generator parameters
+struct GenerationStats
+{
+    uint32_t              Attempts;            // Complete boards generated. Every attempt but the last was rejected by the grader
+    uint32_t              UniquenessChecks;    // IsUniqueBoard calls of every attempt that decided a clue
+    uint32_t              SpeculativeChecks;   // IsUniqueBoard calls made ahead on the workers whose result was never used
+    uint32_t              RemovedTiles;        // Clues removed from the accepted puzzle
+    uint32_t              MaxRemovedTiles;
+    std::vector<uint32_t> GraderScores;        // Grader score of every attempt, the accepted one last
+    bool                  DerivedFromSeed;     // Transformed from a puzzle of the seed set. Nothing was generated or graded
+};
+
 // Class for maintaining and holding sudoku game instance
 class Instance
 {
@@ -223,10 +329,24 @@ private:
     SudokuDifficulty   GameDifficulty;    // Stores the current game difficulty
     SudokuDifficulty   RandomDifficulty;  // Store the actual difficulty if the game difficulty is random or custom
     size_t             MaxRemovedTiles;   // Max removed tiles for certain difficulties. The lower it is, the easier the difficulty could be
-    std::mt19937_64    GameRNG;           // Sudoku's Random Number Generator for generating the puzzle
+    uint64_t           PuzzleSeed;        // The seed that produced the current puzzle. Same seed and difficulty, same puzzle
+    uint32_t           ElapsedSeconds;    // Play time kept with the save record and the journal. The caller runs the clock and keeps it current
+    Xoshiro256         GameRNG;           // Sudoku's Random Number Generator for generating the puzzle
     GameBoard          SolutionBoard;     // Stores the solution of the sudoku board
     GameBoard          PuzzleBoard;       // Stores the puzzle of the sudoku board
     TurnLog            GameTurnLogs;
+    save::Journal*     GameJournal;       // Optional autosave journal that receives every change of the puzzle board
+    grading::GradeCache* GameGradeCache;  // Optional cache of puzzle grades, used when grading an imported board
+    jobs::JobSystem*   GeneratorJobs;     // Optional workers that test the next clue removals ahead of the generator
+    const grids::GridFactory* GeneratorGrids; // Optional source of the complete boards, instead of the backtracking filler
+    grids::PuzzleSeedSet* GeneratorSeeds; // Optional graded puzzles that new puzzles are derived from instead of generated
+    GenerationStats    LastGeneration;
+
+    // Kept up to date on every move so error highlighting and win detection never scan the whole board
+    std::array<std::array<uint8_t, 9>, 27> UnitDigitCounts;    // [unit][number - 1]. Units 0-8 are rows, 9-17 columns, 18-26 cells
+    std::bitset<81>                        ConflictTiles;      // Filled tiles that share a number with one of their peers
+    int                                    FilledTileCount;
+    int                                    SolutionMismatches; // Tiles that differ from the solution board
 
 public:
     Instance();
@@ -235,12 +355,20 @@ public:
     bool CreateSudoku(const std::array<std::array<int, 9>, 9>& board) noexcept;
     // Initialized the game with a random sudoku board
     bool CreateSudoku(SudokuDifficulty game_difficulty) noexcept;
+    // Initialized the game with the sudoku board addressed by the seed
+    bool CreateSudoku(SudokuDifficulty game_difficulty, uint64_t seed) noexcept;
     // Initialize the game with a save progress
     bool LoadSudokuSave(const char* filepath) noexcept;
     // Save the current progress of the puzzle
     bool SaveCurrentProgress(const char* filepath) const noexcept;
+    // Pack the current progress into a fixed layout save record
+    void CreateSaveRecord(save::SaveRecord& record) const noexcept;
+    // Initialize the game with a packed save record
+    bool LoadSaveRecord(const save::SaveRecord& record) noexcept;
     // Checks if the current puzzle is already finished
     bool CheckPuzzleState() const noexcept;
+    // Static Function! Creates a fresh puzzle seed
+    static uint64_t NewPuzzleSeed() noexcept;
     // Static Function! Load the difficulty of save files
     static SudokuDifficulty LoadDifficultyFromSaveFile(const char* filepath) noexcept;
 
@@ -248,9 +376,25 @@ public:
     const GameBoard*        GetPuzzleBoard() const noexcept;
     const GameBoard*        GetSolutionBoard() const noexcept;
     SudokuDifficulty        GetBoardDifficulty() const noexcept;
+    uint64_t                GetPuzzleSeed() const noexcept;
     const TurnLog*          GetTurnLogs() const noexcept;
+    const std::bitset<81>&  GetConflictTiles() const noexcept;
+    const GenerationStats&  GetGenerationStats() const noexcept;
+    int                     GetFilledTileCount() const noexcept;
+    uint32_t                GetElapsedSeconds() const noexcept;
 
     // Setters
+    void SetJournal(save::Journal* journal) noexcept;
+    void SetGradeCache(grading::GradeCache* grade_cache) noexcept;
+    // The generator tests clue removals on these workers too. Safe to use from a job of the same system
+    void SetJobSystem(jobs::JobSystem* job_system) noexcept;
+    // The generator takes its complete boards from the factory. A seed gives another puzzle with a factory than without one
+    void SetGridFactory(const grids::GridFactory* grid_factory) noexcept;
+    // CreateSudoku(difficulty) derives its puzzles from the seeds of the difficulty once it has all of them, and adds
+    // the puzzles it generates until then. For when a puzzle is needed fast more than a new one
+    void SetPuzzleSeeds(grids::PuzzleSeedSet* puzzle_seeds) noexcept;
+    // Stored by CreateSaveRecord and restored by LoadSaveRecord. A new puzzle starts at 0
+    void SetElapsedSeconds(uint32_t elapsed_seconds) noexcept;
     bool SetTile(int row, int col, int number) noexcept;
     bool ResetTile(int row, int col) noexcept;
     void ResetTurnLogs() noexcept;
@@ -258,14 +402,35 @@ public:
     void AddPencilmark(int row, int col, int number) noexcept;
     void ClearAllPencilmarks() noexcept;
     void ResetAllPencilmarks() noexcept;
-    bool IsValidTile(int row, int col) noexcept;
+    bool IsValidTile(int row, int col) const noexcept;
     void UndoTurn() noexcept;
     void RedoTurn() noexcept;
+    // Groups every change until the commit into one undo step
+    void BeginTransaction() noexcept;
+    void CommitTransaction() noexcept;
+    // Reverts every change since BeginTransaction and drops them from the turn log
+    void RollbackTransaction() noexcept;
 
 private:
+    // Changes the number of a puzzle tile and updates the board counters with it
+    void UpdateTileNumber(int row, int col, int number) noexcept;
+    void RebuildBoardCounters() noexcept;
+    void UpdateTileConflict(int tile_idx) noexcept;
+    void ApplyUndoTurn(const TurnLog::TurnTile& turn_tile) noexcept;
+    void ApplyRedoTurn(const TurnLog::TurnTile& turn_tile) noexcept;
+    bool LoadLegacySudokuSave(const char* filepath) noexcept;
+    // Hand the journal the tiles a change may have touched, it drops the ones that stayed the same. A number change
+    // can rule the pencilmarks of its peers in or out, so they go with it. Bulk changes hand over the whole board
+    void JournalTile(int row, int col, bool with_peers) const noexcept;
+    void JournalPuzzleBoard() const noexcept;
     void ClearAllBoards() noexcept;
     bool CreateCompleteBoard() noexcept;
-    bool GeneratePuzzle() noexcept;
+    bool GeneratePuzzle(grading::GradeResult& grade) noexcept;
+    bool DerivePuzzle() noexcept;
+    // Both remove the clues in the given order and keep a clue whenever removing it breaks uniqueness. They return
+    // the number of removed clues and give the same puzzle, the speculative one tests the next clues on the workers
+    size_t RemoveClues(const std::array<std::pair<int, int>, 81>& removal_order) noexcept;
+    size_t RemoveCluesSpeculatively(const std::array<std::pair<int, int>, 81>& removal_order) noexcept;
     void InitializeGameParameters(SudokuDifficulty game_difficulty) noexcept;
 };
 
@@ -276,6 +441,15 @@ constexpr int GetNextRow(int row, int col) noexcept;
 constexpr int GetNextCol(int col) noexcept;
 constexpr int GetCellBlock(int row, int col) noexcept;
 constexpr std::tuple<int, int, int, int> GetMinMaxRowColumnFromCell(int const cell) noexcept;
+// Tile indices (row * 9 + col) of the 20 tiles that share a row, column or cell with the tile
+const std::array<uint8_t, 20>& GetPeers(int row, int col) noexcept;
+// Fisher-Yates shuffle that gives the same order on every standard library, unlike std::shuffle
+template<typename Container>
+void Shuffle(Container& container, Xoshiro256& rng) noexcept
+{
+    for (size_t idx = container.size() - 1; idx > 0; --idx)
+        std::swap(container[idx], container[rng.NextBounded(idx + 1)]);
+}
 
 }
 
@@ -308,7 +482,7 @@ SolveBruteForceEX(GameBoard& sudoku_board) noexcept;
 bool
 SolveHumanely(GameBoard& sudoku_board, size_t* difficulty_score = nullptr) noexcept;
 bool
-SolveHumanelyEX(GameBoard& sudoku_board, size_t& difficulty_score) noexcept;
+SolveHumanelyEX(GameBoard& sudoku_board, size_t& difficulty_score, UsedSudokuTechnique* used_techniques = nullptr) noexcept;
 
 }
 
@@ -333,6 +507,9 @@ SudokuDifficulty
 CheckPuzzleDifficulty(const GameBoard& sudoku_board) noexcept;
 SudokuDifficulty 
 CheckPuzzleDifficulty(GameBoard& sudoku_board) noexcept;
+// Maps the score of the humanlike solver to a difficulty. blank_count is only used if the solver got stuck
+SudokuDifficulty
+GetDifficultyFromScore(size_t difficulty_score, bool puzzle_completed, size_t blank_count) noexcept;
 //
 std::optional<std::array<std::array<int, 9>, 9>> 
 OpenSudokuFile(const char* filename) noexcept;
@@ -389,6 +566,12 @@ FindYWings(GameBoard& sudoku_board) noexcept;
 */
 std::tuple<size_t, size_t, size_t>
 FindFishes(GameBoard& sudoku_board) noexcept;
+/* @returns The number of conjugate pair chains of a single number that removed candidates */
+size_t
+FindSimpleColorings(GameBoard& sudoku_board) noexcept;
+/* @returns The number of bivalue chain starts that removed candidates */
+size_t
+FindXYChains(GameBoard& sudoku_board) noexcept;
 
 }
 
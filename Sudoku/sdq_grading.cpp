@@ -0,0 +1,237 @@
+#include "sdq_grading.h"
+#include "sdq_metrics.h"
+#include "sdq_trace.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <latch>
+#include <memory>
+
+namespace sdq::grading
+{
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// Grade Cache
+//--------------------------------------------------------------------------------------------------------------------------------
+
+size_t GradeCache::PuzzleKeyHash::operator () (const PuzzleKey& key) const noexcept
+{
+    return sdq::save::Checksum(key.data(), key.size());
+}
+
+GradeCache::GradeCache() noexcept : Dirty(false)
+{}
+
+bool GradeCache::Load(const char* filepath) noexcept
+{
+    std::ifstream ifile(filepath, std::ios::binary | std::ios::ate);
+    if (!ifile.good())
+        return false;
+
+    const auto file_size = static_cast<uint64_t>(ifile.tellg());
+    ifile.seekg(0);
+    GradeCacheHeader header;
+    if (file_size < sizeof(GradeCacheHeader) || !ifile.read(reinterpret_cast<char*>(&header), sizeof(GradeCacheHeader)))
+        return false;
+    if (header.Magic != GradeCacheMagic || header.Version != GradeCacheVersion)
+        return false;
+    // A damaged count must not ask for more entries than the file holds
+    if (static_cast<uint64_t>(header.EntryCount) * sizeof(GradeCacheEntry) > file_size - sizeof(GradeCacheHeader))
+        return false;
+
+    std::vector<GradeCacheEntry> file_entries(header.EntryCount);
+    if (!ifile.read(reinterpret_cast<char*>(file_entries.data()), file_entries.size() * sizeof(GradeCacheEntry)))
+        return false;
+    if (header.Checksum != sdq::save::Checksum(file_entries.data(), file_entries.size() * sizeof(GradeCacheEntry)))
+        return false;
+
+    std::unique_lock entries_lock(EntriesMutex);
+    Entries.reserve(Entries.size() + file_entries.size());
+    for (const auto& entry : file_entries)
+        Entries.try_emplace(entry.Puzzle, GradeResult{ entry.Score, entry.UsedTechniques, entry.Difficulty });
+
+    return true;
+}
+
+bool GradeCache::Save(const char* filepath) noexcept
+{
+    std::lock_guard save_guard(SaveMutex);
+    if (!this->IsDirty())
+        return true;
+
+    this->Load(filepath);
+    std::vector<char> bytes;
+    {
+        std::unique_lock entries_lock(EntriesMutex);
+        if (!Dirty)
+            return true;
+
+        bytes.resize(sizeof(GradeCacheHeader) + Entries.size() * sizeof(GradeCacheEntry));
+        auto* file_entry = reinterpret_cast<GradeCacheEntry*>(bytes.data() + sizeof(GradeCacheHeader));
+        for (const auto& [key, result] : Entries) {
+            GradeCacheEntry entry = {};
+            entry.Puzzle         = key;
+            entry.Difficulty     = static_cast<uint8_t>(result.Difficulty);
+            entry.UsedTechniques = static_cast<uint16_t>(result.UsedTechniques);
+            entry.Score          = result.Score;
+            std::memcpy(file_entry++, &entry, sizeof(GradeCacheEntry));
+        }
+        Dirty = false;
+    }
+
+    GradeCacheHeader header = {};
+    header.Magic      = GradeCacheMagic;
+    header.Version    = GradeCacheVersion;
+    header.EntryCount = static_cast<uint32_t>((bytes.size() - sizeof(GradeCacheHeader)) / sizeof(GradeCacheEntry));
+    header.Checksum   = sdq::save::Checksum(bytes.data() + sizeof(GradeCacheHeader), bytes.size() - sizeof(GradeCacheHeader));
+    std::memcpy(bytes.data(), &header, sizeof(GradeCacheHeader));
+
+    if (sdq::save::WriteFileAtomically(filepath, bytes.data(), bytes.size()))
+        return true;
+
+    // The grades are still only in memory, the next save tries again
+    std::unique_lock entries_lock(EntriesMutex);
+    Dirty = true;
+    return false;
+}
+
+bool GradeCache::Find(const PuzzleKey& key, GradeResult& result) const noexcept
+{
+    std::shared_lock entries_lock(EntriesMutex);
+    const auto entry = Entries.find(key);
+    if (entry == Entries.end())
+        return false;
+
+    result = entry->second;
+    return true;
+}
+
+void GradeCache::Insert(const PuzzleKey& key, const GradeResult& result) noexcept
+{
+    std::unique_lock entries_lock(EntriesMutex);
+    if (Entries.try_emplace(key, result).second)
+        Dirty = true;
+}
+
+size_t GradeCache::GetSize() const noexcept
+{
+    std::shared_lock entries_lock(EntriesMutex);
+    return Entries.size();
+}
+
+bool GradeCache::IsDirty() const noexcept
+{
+    std::shared_lock entries_lock(EntriesMutex);
+    return Dirty;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// Grading
+//--------------------------------------------------------------------------------------------------------------------------------
+
+PuzzleKey MakePuzzleKey(const GameBoard& puzzle_board) noexcept
+{
+    PuzzleKey key = {};
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx)
+        sdq::save::SetPackedDigit(key, tile_idx, puzzle_board.GetTile(tile_idx / 9, tile_idx % 9).TileNumber);
+
+    return key;
+}
+
+PuzzleKey MakePuzzleKey(const DigitGrid& puzzle_digits) noexcept
+{
+    PuzzleKey key = {};
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx)
+        sdq::save::SetPackedDigit(key, tile_idx, puzzle_digits[tile_idx / 9][tile_idx % 9]);
+
+    return key;
+}
+
+GradeResult GradePuzzle(const GameBoard& puzzle_board) noexcept
+{
+    SDQ_TRACE_SCOPE("grading::GradePuzzle");
+    sdq::metrics::IncrementCounter(MetricCounter_GraderRuns);
+    size_t              difficulty_score = 0;
+    UsedSudokuTechnique used_techniques  = UsedSudokuTechnique_None;
+    auto sudoku_board_copy = puzzle_board;
+    sdq::solvers::SolveHumanelyEX(sudoku_board_copy, difficulty_score, &used_techniques);
+
+    const bool puzzle_completed = sudoku_board_copy.IsBoardCompleted();
+    size_t blank_count = 0;
+    if (!puzzle_completed)
+        blank_count = std::count_if(sudoku_board_copy.PuzzleTiles.begin(), sudoku_board_copy.PuzzleTiles.end(), [](const BoardTile* tile) { return !tile->IsTileFilled(); });
+
+    return { static_cast<uint32_t>(difficulty_score), used_techniques, sdq::utils::GetDifficultyFromScore(difficulty_score, puzzle_completed, blank_count) };
+}
+
+GradeResult GradePuzzle(const GameBoard& puzzle_board, GradeCache& cache) noexcept
+{
+    const PuzzleKey key = MakePuzzleKey(puzzle_board);
+    GradeResult result;
+    if (cache.Find(key, result)) {
+        sdq::metrics::IncrementCounter(MetricCounter_GradeCacheHits);
+        return result;
+    }
+
+    result = GradePuzzle(puzzle_board);
+    cache.Insert(key, result);
+    return result;
+}
+
+GradeResult GradePuzzle(const DigitGrid& puzzle_digits, GradeCache* cache) noexcept
+{
+    GradeResult result;
+    if (cache != nullptr && cache->Find(MakePuzzleKey(puzzle_digits), result)) {
+        sdq::metrics::IncrementCounter(MetricCounter_GradeCacheHits);
+        return result;
+    }
+
+    // Same board state Instance::CreateSudoku grades, so both give the same grade for the same digits
+    GameBoard puzzle_board;
+    if (!puzzle_board.CreateSudokuBoard(puzzle_digits))
+        return { 0, UsedSudokuTechnique_None, SudokuDifficulty_Random };
+
+    return cache != nullptr ? GradePuzzle(puzzle_board, *cache) : GradePuzzle(puzzle_board);
+}
+
+std::vector<GradeResult> GradeBatch(const std::vector<DigitGrid>& puzzles, jobs::JobSystem& job_system, GradeCache* cache)
+{
+    SDQ_TRACE_SCOPE("grading::GradeBatch");
+    std::vector<GradeResult> results(puzzles.size());
+    if (puzzles.empty())
+        return results;
+
+    // Every grader takes the next board until none are left. A grader job that only starts after the batch returned
+    // finds no board and never touches the puzzles or the results
+    struct BatchState
+    {
+        const std::vector<DigitGrid>* Puzzles;
+        std::vector<GradeResult>*     Results;
+        size_t                        Count;      // Kept apart, the late jobs must not read the puzzles of a returned batch
+        GradeCache*                   Cache;
+        std::atomic<size_t>           NextIdx;
+        std::latch                    Graded;
+
+        BatchState(const std::vector<DigitGrid>* puzzles, std::vector<GradeResult>* results, GradeCache* cache) :
+            Puzzles(puzzles), Results(results), Count(puzzles->size()), Cache(cache), NextIdx(0), Graded(static_cast<std::ptrdiff_t>(puzzles->size()))
+        {}
+    };
+    auto batch = std::make_shared<BatchState>(&puzzles, &results, cache);
+    auto grade_boards = [batch]() {
+        for (size_t idx = batch->NextIdx.fetch_add(1, std::memory_order_relaxed); idx < batch->Count;
+             idx = batch->NextIdx.fetch_add(1, std::memory_order_relaxed)) {
+            (*batch->Results)[idx] = GradePuzzle((*batch->Puzzles)[idx], batch->Cache);
+            batch->Graded.count_down();
+        }
+    };
+
+    const size_t grader_jobs = std::min(job_system.GetWorkerCount(), puzzles.size() - 1);
+    for (size_t job_idx = 0; job_idx < grader_jobs; ++job_idx)
+        job_system.Submit(JobPriority_Low, grade_boards);
+
+    grade_boards();
+    batch->Graded.wait();
+    return results;
+}
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "sdq.h"
+#include "sdq_jobs.h"
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+// Difficulty grading with a persistent cache.
+// Grading runs the whole humanlike solver, which is the most expensive thing we do with a finished puzzle. The grade
+// only depends on the given digits, so it is cached by them: re-grading a known puzzle is a hash lookup, and the
+// cache file keeps the grades across launches and tools. Batches are graded on the workers of a job system.
+
+namespace sdq::grading
+{
+
+constexpr uint32_t GradeCacheMagic   = 0x47514453; // "SDQG"
+constexpr uint16_t GradeCacheVersion = 2;    // Version 2 grades with the chain techniques
+
+// The given digits of a puzzle, packed like the digits of a save record. Blank tiles are 0
+using PuzzleKey = std::array<uint8_t, 41>;
+using DigitGrid = std::array<std::array<int, 9>, 9>;
+
+struct GradeResult
+{
+    uint32_t            Score;             // Difficulty score of the humanlike solver
+    UsedSudokuTechnique UsedTechniques;    // Every technique the solver needed
+    SudokuDifficulty    Difficulty;        // SudokuDifficulty_Random if the board is invalid and couldn't be graded
+};
+
+struct GradeCacheHeader
+{
+    uint32_t Magic;
+    uint16_t Version;
+    uint16_t Reserved;
+    uint32_t EntryCount;
+    uint32_t Checksum;      // FNV-1a of the entries
+};
+
+struct GradeCacheEntry
+{
+    PuzzleKey Puzzle;
+    uint8_t   Difficulty;
+    uint16_t  UsedTechniques;
+    uint32_t  Score;
+};
+
+static_assert(sizeof(GradeCacheHeader) == 16, "GradeCacheHeader layout changed! Bump the grade cache version.");
+static_assert(sizeof(GradeCacheEntry) == 48, "GradeCacheEntry layout changed! Bump the grade cache version.");
+
+// Thread safe. Lookups from several graders only share a read lock
+class GradeCache
+{
+private:
+    struct PuzzleKeyHash
+    {
+        size_t operator () (const PuzzleKey& key) const noexcept;
+    };
+
+    mutable std::shared_mutex                                 EntriesMutex;
+    std::unordered_map<PuzzleKey, GradeResult, PuzzleKeyHash> Entries;
+    bool                                                      Dirty;          // Grades were added since the last load or save
+    std::mutex                                                SaveMutex;      // Two saves never write the same file at once
+
+public:
+    GradeCache() noexcept;
+
+    GradeCache(const GradeCache&) = delete;
+    GradeCache& operator = (const GradeCache&) = delete;
+
+    // Adds the grades of the file to the cache. False if the file is missing or damaged, which is not an error
+    bool Load(const char* filepath) noexcept;
+    // Writes the whole cache if anything was added since it was loaded or last saved. The grades already in the file
+    // are merged in first, so a save never drops grades another process or an unfinished load put there
+    bool Save(const char* filepath) noexcept;
+
+    bool   Find(const PuzzleKey& key, GradeResult& result) const noexcept;
+    void   Insert(const PuzzleKey& key, const GradeResult& result) noexcept;
+    size_t GetSize() const noexcept;
+    bool   IsDirty() const noexcept;
+};
+
+PuzzleKey   MakePuzzleKey(const GameBoard& puzzle_board) noexcept;
+PuzzleKey   MakePuzzleKey(const DigitGrid& puzzle_digits) noexcept;
+
+// Grades the board as it is, without touching it. Gives the same difficulty as utils::CheckPuzzleDifficulty
+GradeResult GradePuzzle(const GameBoard& puzzle_board) noexcept;
+GradeResult GradePuzzle(const GameBoard& puzzle_board, GradeCache& cache) noexcept;
+GradeResult GradePuzzle(const DigitGrid& puzzle_digits, GradeCache* cache = nullptr) noexcept;
+
+// Grades every board on the workers of the job system, in the same order as the boards. The calling thread grades
+// along with the workers and returns once every board is graded, so it must not be a job of the same system
+std::vector<GradeResult> GradeBatch(const std::vector<DigitGrid>& puzzles, jobs::JobSystem& job_system, GradeCache* cache = nullptr);
+
+}
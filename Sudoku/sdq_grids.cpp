@@ -0,0 +1,274 @@
+#include "sdq_grids.h"
+#include <algorithm>
+
+namespace sdq::grids
+{
+
+namespace
+{
+
+constexpr std::array<std::array<uint8_t, 3>, 6> Permutations3 = { { {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0} } };
+
+constexpr uint64_t LineOrderCount  = 6 * 6 * 6 * 6;    // Block order and the line order inside each of the 3 blocks
+constexpr uint64_t DigitOrderCount = 362880;           // 9!
+constexpr uint64_t TransformCount  = 2 * LineOrderCount * LineOrderCount * DigitOrderCount;
+
+// Order of the 9 lines that keeps every band (or stack) together: the blocks are permuted, then the lines inside each block
+std::array<uint8_t, 9> DecodeLineOrder(uint64_t line_order) noexcept
+{
+    std::array<uint8_t, 9> lines;
+    const auto& blocks = Permutations3[line_order % 6];
+    line_order /= 6;
+    for (int block = 0; block < 3; ++block) {
+        const auto& block_lines = Permutations3[line_order % 6];
+        line_order /= 6;
+        for (int idx = 0; idx < 3; ++idx)
+            lines[block * 3 + idx] = static_cast<uint8_t>(blocks[block] * 3 + block_lines[idx]);
+    }
+
+    return lines;
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// Grid Transform
+//--------------------------------------------------------------------------------------------------------------------------------
+
+GridTransform GridTransform::Random(Xoshiro256& rng) noexcept
+{
+    // One draw numbers every transform, which is cheaper than a draw for each of the 8 line orders and 8 digit swaps
+    uint64_t transform_code = rng.NextBounded(TransformCount);
+    const bool transpose = (transform_code & 1) != 0;
+    transform_code >>= 1;
+    const auto rows = DecodeLineOrder(transform_code % LineOrderCount);
+    transform_code /= LineOrderCount;
+    const auto cols = DecodeLineOrder(transform_code % LineOrderCount);
+    transform_code /= LineOrderCount;
+
+    GridTransform transform;
+    const int row_stride = transpose ? 1 : 9;
+    const int col_stride = transpose ? 9 : 1;
+    for (int row = 0; row < 9; ++row)
+        for (int col = 0; col < 9; ++col)
+            transform.SourceTiles[row * 9 + col] = static_cast<uint8_t>(rows[row] * row_stride + cols[col] * col_stride);
+
+    // Fisher-Yates with the swaps read off the rest of the code, the same as Shuffle with 8 draws. It fits in 32 bits by now,
+    // and the divisions are a lot cheaper at that width
+    uint32_t digit_code = static_cast<uint32_t>(transform_code);
+    transform.Digits = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    for (uint32_t digit = 9; digit > 1; --digit) {
+        std::swap(transform.Digits[digit], transform.Digits[1 + digit_code % digit]);
+        digit_code /= digit;
+    }
+
+    return transform;
+}
+
+GridTransform GridTransform::Identity() noexcept
+{
+    GridTransform transform;
+    for (int idx = 0; idx < 81; ++idx)
+        transform.SourceTiles[idx] = static_cast<uint8_t>(idx);
+    for (int digit = 0; digit < 10; ++digit)
+        transform.Digits[digit] = static_cast<uint8_t>(digit);
+    return transform;
+}
+
+void GridTransform::Apply(const Grid& source, Grid& result) const noexcept
+{
+    // Built in a local, since a store through result could alias the tables and would keep the loads from being reordered
+    Grid transformed;
+    for (int idx = 0; idx < 81; ++idx)
+        transformed[idx] = Digits[source[SourceTiles[idx]]];
+    result = transformed;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// Grid Factory
+//--------------------------------------------------------------------------------------------------------------------------------
+
+GridFactory::GridFactory(size_t pool_size, uint64_t pool_seed) noexcept : PoolSize(std::max<size_t>(1, pool_size)), PoolSeed(pool_seed)
+{
+}
+
+void GridFactory::FillPool() const noexcept
+{
+    std::call_once(PoolFilled, [this]() {
+        Xoshiro256 rng(PoolSeed);
+        GameBoard  board;
+        BaseGrids.resize(PoolSize);
+        for (auto& base_grid : BaseGrids) {
+            FillRandomBoard(board, rng);
+            BoardToGrid(board, base_grid);
+        }
+    });
+}
+
+void GridFactory::CreateGrid(Xoshiro256& rng, Grid& grid) const noexcept
+{
+    this->FillPool();
+    const Grid& base_grid = BaseGrids[rng.NextBounded(BaseGrids.size())];
+    GridTransform::Random(rng).Apply(base_grid, grid);
+}
+
+size_t GridFactory::GetPoolSize() const noexcept
+{
+    return PoolSize;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// Puzzle Seeds
+//--------------------------------------------------------------------------------------------------------------------------------
+
+PuzzleSeedSet::PuzzleSeedSet(size_t seeds_per_difficulty) noexcept : SeedsPerDifficulty(std::max<size_t>(1, seeds_per_difficulty))
+{
+    for (auto& difficulty_seeds : Seeds)
+        difficulty_seeds.reserve(SeedsPerDifficulty);
+}
+
+bool PuzzleSeedSet::Add(SudokuDifficulty difficulty, const SeedPuzzle& seed) noexcept
+{
+    if (this->GetSeedCount(difficulty) >= SeedsPerDifficulty)
+        return false;
+
+    // Graded without the lock. The transforms only depend on the seed, so a seed is always kept or always turned away
+    Xoshiro256          check_rng(sdq::save::Checksum(seed.Puzzle.data(), seed.Puzzle.size()));
+    SeedPuzzle          derived;
+    grading::DigitGrid  derived_digits;
+    for (int check = 0; check < StabilityChecks; ++check) {
+        DerivePuzzle(seed, check_rng, derived);
+        for (int idx = 0; idx < 81; ++idx)
+            derived_digits[idx / 9][idx % 9] = derived.Puzzle[idx];
+        if (grading::GradePuzzle(derived_digits).Difficulty != seed.Grade.Difficulty)
+            return false;
+    }
+
+    std::unique_lock lock(SeedsMutex);
+    if (Seeds[difficulty].size() >= SeedsPerDifficulty)
+        return false;
+
+    Seeds[difficulty].push_back(seed);
+    return true;
+}
+
+bool PuzzleSeedSet::Derive(SudokuDifficulty difficulty, Xoshiro256& rng, SeedPuzzle& derived) const noexcept
+{
+    if (difficulty < 0 || static_cast<size_t>(difficulty) >= Seeds.size())
+        return false;
+
+    std::shared_lock lock(SeedsMutex);
+    const auto& difficulty_seeds = Seeds[difficulty];
+    if (difficulty_seeds.size() < SeedsPerDifficulty)
+        return false;
+
+    DerivePuzzle(difficulty_seeds[rng.NextBounded(difficulty_seeds.size())], rng, derived);
+    return true;
+}
+
+size_t PuzzleSeedSet::GetSeedCount(SudokuDifficulty difficulty) const noexcept
+{
+    if (difficulty < 0 || static_cast<size_t>(difficulty) >= Seeds.size())
+        return 0;
+
+    std::shared_lock lock(SeedsMutex);
+    return Seeds[difficulty].size();
+}
+
+size_t PuzzleSeedSet::GetSeedsPerDifficulty() const noexcept
+{
+    return SeedsPerDifficulty;
+}
+
+void DerivePuzzle(const SeedPuzzle& seed, Xoshiro256& rng, SeedPuzzle& derived) noexcept
+{
+    // One transform for both, so the derived solution is still the solution of the derived puzzle
+    const auto transform = GridTransform::Random(rng);
+    transform.Apply(seed.Puzzle, derived.Puzzle);
+    transform.Apply(seed.Solution, derived.Solution);
+    derived.Grade = seed.Grade;
+}
+
+SeedPuzzle MakeSeedPuzzle(const GameBoard& puzzle_board, const GameBoard& solution_board, const grading::GradeResult& grade) noexcept
+{
+    SeedPuzzle seed;
+    BoardToGrid(puzzle_board, seed.Puzzle);
+    BoardToGrid(solution_board, seed.Solution);
+    seed.Grade = grade;
+    return seed;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// Grid Utilities
+//--------------------------------------------------------------------------------------------------------------------------------
+
+bool FillRandomBoard(GameBoard& board, Xoshiro256& rng) noexcept
+{
+    board.ClearSudokuBoard();
+
+    std::array<int, 9> random_numbers = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    auto fill_diagonal_cells = [&board, &rng, &random_numbers](int start_row, int end_row, int start_col, int end_col) {
+        sdq::helpers::Shuffle(random_numbers, rng);
+        int num_idx = 0;
+        for (int row = start_row; row < end_row; ++row) {
+            for (int col = start_col; col < end_col; ++col) {
+                board.BoardTiles[row][col].SetTileNumber(random_numbers[num_idx]);
+                num_idx++;
+            }
+        }
+    };
+
+    fill_diagonal_cells(0, 3, 0, 3); // We will fill the three      x o o
+    fill_diagonal_cells(3, 6, 3, 6); // non-connecting diagonal     o x o
+    fill_diagonal_cells(6, 9, 6, 9); // cells of the sudoku board   o o x
+
+    sdq::helpers::Shuffle(random_numbers, rng);
+    if (!sdq::utils::FillSudoku(board, random_numbers))
+        return false;
+
+    board.BoardInitialized = true;
+    return true;
+}
+
+bool IsValidGrid(const Grid& grid) noexcept
+{
+    std::array<uint16_t, 27> unit_digits = {};
+    for (int row = 0; row < 9; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            const int digit = grid[row * 9 + col];
+            if (digit < 1 || digit > 9)
+                return false;
+
+            const uint16_t digit_bit = static_cast<uint16_t>(1u << digit);
+            for (const int unit : { row, 9 + col, 18 + (row / 3) * 3 + col / 3 }) {
+                if (unit_digits[unit] & digit_bit)
+                    return false;
+                unit_digits[unit] |= digit_bit;
+            }
+        }
+    }
+
+    return true;
+}
+
+void GridToBoard(const Grid& grid, GameBoard& board) noexcept
+{
+    board.ClearSudokuBoard();
+    for (int row = 0; row < 9; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            if (grid[row * 9 + col] != 0)
+                board.BoardTiles[row][col].SetTileNumber(grid[row * 9 + col]);
+        }
+    }
+
+    board.BoardInitialized = true;
+}
+
+void BoardToGrid(const GameBoard& board, Grid& grid) noexcept
+{
+    for (int row = 0; row < 9; ++row)
+        for (int col = 0; col < 9; ++col)
+            grid[row * 9 + col] = static_cast<uint8_t>(board.GetTile(row, col).TileNumber);
+}
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "sdq.h"
+#include "sdq_grading.h"
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+// Completed grids from validity preserving transforms.
+// Relabeling the digits, permuting the bands, the stacks, the rows inside a band and the columns inside a stack, and
+// transposing all map a valid grid to a valid grid. Together they give up to 2 * 6^8 * 9! different grids from one
+// base grid, so a small pool of base grids filled once by the backtracking filler is enough to hand out random
+// completed grids at the cost of a few random draws and one pass over the 81 tiles.
+// The same transforms map a puzzle to one with the same number of solutions that needs the same techniques, so a
+// graded puzzle can stand for a whole family of puzzles that never have to be checked for uniqueness or graded again.
+
+namespace sdq::grids
+{
+
+// 81 digits in row major order. 0 is a blank tile, so puzzles go through the same transforms as completed grids
+using Grid = std::array<uint8_t, 81>;
+
+struct GridTransform
+{
+    std::array<uint8_t, 81> SourceTiles;    // The tile of the source grid that lands on each tile of the result
+    std::array<uint8_t, 10> Digits;         // [source digit], Digits[0] is always 0
+
+    // Every band, stack, row, column and digit order and the transposition are equally likely
+    static GridTransform Random(Xoshiro256& rng) noexcept;
+    static GridTransform Identity() noexcept;
+
+    void Apply(const Grid& source, Grid& result) const noexcept;
+};
+
+class GridFactory
+{
+private:
+    size_t                    PoolSize;
+    uint64_t                  PoolSeed;
+    mutable std::once_flag    PoolFilled;
+    mutable std::vector<Grid> BaseGrids;    // Filled once by FillPool, never changed after
+
+public:
+    static constexpr size_t   DefaultPoolSize = 128;
+    static constexpr uint64_t DefaultPoolSeed = 0x5344514752494453;    // "SDQGRIDS"
+
+    // Cheap, the pool is only filled by the first FillPool or CreateGrid, so the factory can live on the render thread
+    // and have its pool built by the first generation job. Same size and seed, same pool, so the grids stay reproducible
+    explicit GridFactory(size_t pool_size = DefaultPoolSize, uint64_t pool_seed = DefaultPoolSeed) noexcept;
+
+    GridFactory(const GridFactory&) = delete;
+    GridFactory& operator = (const GridFactory&) = delete;
+
+    // Thread safe. Fills the pool with the backtracking filler if it is still empty, other callers wait for it
+    void   FillPool() const noexcept;
+    void   CreateGrid(Xoshiro256& rng, Grid& grid) const noexcept;
+    size_t GetPoolSize() const noexcept;
+};
+
+// A graded puzzle and its solution
+struct SeedPuzzle
+{
+    Grid                 Puzzle;
+    Grid                 Solution;
+    grading::GradeResult Grade;
+};
+
+// Fixed number of graded puzzles per requested difficulty that puzzles are derived from. Thread safe, so one set can
+// feed every generator of a process. Each difficulty keeps the first puzzles added to it and ignores the rest.
+// The humanlike solver scores a little differently depending on the order it meets the tiles in, so a puzzle close to
+// a difficulty boundary can grade to the next difficulty once transformed. Add grades a few transforms of every new
+// seed and turns it away if any of them changes difficulty, which is the only grading the seeds ever need
+class PuzzleSeedSet
+{
+private:
+    mutable std::shared_mutex              SeedsMutex;
+    size_t                                 SeedsPerDifficulty;
+    std::array<std::vector<SeedPuzzle>, 5> Seeds;    // [requested difficulty]. A random difficulty keeps the grade it got
+
+public:
+    static constexpr size_t DefaultSeedsPerDifficulty = 8;
+    static constexpr int    StabilityChecks           = 8;    // Transforms graded by Add
+
+    explicit PuzzleSeedSet(size_t seeds_per_difficulty = DefaultSeedsPerDifficulty) noexcept;
+
+    PuzzleSeedSet(const PuzzleSeedSet&) = delete;
+    PuzzleSeedSet& operator = (const PuzzleSeedSet&) = delete;
+
+    // False if the difficulty already has all its seeds or the seed doesn't keep its difficulty. Grades the seed
+    // StabilityChecks times, so it takes as long as that many grader runs
+    bool   Add(SudokuDifficulty difficulty, const SeedPuzzle& seed) noexcept;
+    // Derives a puzzle from a random seed of the difficulty. False until the difficulty has all its seeds, so the
+    // first puzzles of a difficulty are still generated and a derived puzzle is never from a set of one
+    bool   Derive(SudokuDifficulty difficulty, Xoshiro256& rng, SeedPuzzle& derived) const noexcept;
+    size_t GetSeedCount(SudokuDifficulty difficulty) const noexcept;
+    size_t GetSeedsPerDifficulty() const noexcept;
+};
+
+// The seed under a random transform: another puzzle with one solution and the grade of the seed, without solving or grading it
+void       DerivePuzzle(const SeedPuzzle& seed, Xoshiro256& rng, SeedPuzzle& derived) noexcept;
+SeedPuzzle MakeSeedPuzzle(const GameBoard& puzzle_board, const GameBoard& solution_board, const grading::GradeResult& grade) noexcept;
+
+// Clears the board and fills it with a random completed grid the way the generator always did: the three diagonal
+// cells are shuffled, then the backtracking filler completes the rest
+bool FillRandomBoard(GameBoard& board, Xoshiro256& rng) noexcept;
+// Every tile holds 1-9 and no unit has the same digit twice
+bool IsValidGrid(const Grid& grid) noexcept;
+// Clears the board and sets the digits of the grid like the filler does, so the board ends up the same as a filled one
+void GridToBoard(const Grid& grid, GameBoard& board) noexcept;
+void BoardToGrid(const GameBoard& board, Grid& grid) noexcept;
+
+}
@@ -0,0 +1,119 @@
+#include "sdq_jobs.h"
+#include <algorithm>
+
+namespace sdq::jobs
+{
+
+JobSystem::JobSystem(size_t worker_count) :
+    Queues({}),
+    StopWorkers(false),
+    PendingJobCount(0)
+{
+    Workers.reserve(worker_count);
+    for (size_t idx = 0; idx < std::max<size_t>(worker_count, 1); ++idx)
+        Workers.emplace_back(&JobSystem::WorkerLoop, this);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard queue_guard(QueueMutex);
+        StopWorkers = true;
+    }
+    QueueSignal.notify_all();
+    for (auto& worker : Workers)
+        worker.join();
+}
+
+void JobSystem::Submit(JobPriority priority, Task work)
+{
+    Enqueue(priority, std::move(work));
+}
+
+size_t JobSystem::RunCompletions()
+{
+    {
+        std::lock_guard completion_guard(CompletionMutex);
+        if (PendingCompletions.empty())
+            return 0;
+
+        // Both buffers keep their capacity, and a completion that submits a new job never runs under the lock
+        std::swap(PendingCompletions, RunningCompletions);
+    }
+
+    const size_t completion_count = RunningCompletions.size();
+    for (auto& completion : RunningCompletions) {
+        completion();
+        PendingJobCount.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    RunningCompletions.clear();
+
+    return completion_count;
+}
+
+void JobSystem::SetCompletionNotifier(Task notifier)
+{
+    std::lock_guard completion_guard(CompletionMutex);
+    CompletionNotifier = std::move(notifier);
+}
+
+size_t JobSystem::GetPendingJobCount() const noexcept
+{
+    return PendingJobCount.load(std::memory_order_acquire);
+}
+
+size_t JobSystem::GetWorkerCount() const noexcept
+{
+    return Workers.size();
+}
+
+size_t JobSystem::GetDefaultWorkerCount() noexcept
+{
+    // Leaves a core for the render thread. Generation is the heaviest job and rarely runs more than once at a time
+    const size_t core_count = std::thread::hardware_concurrency();
+    return std::clamp<size_t>(core_count > 1 ? core_count - 1 : 1, 2, 4);
+}
+
+void JobSystem::Enqueue(JobPriority priority, Task task)
+{
+    PendingJobCount.fetch_add(1, std::memory_order_acq_rel);
+    {
+        std::lock_guard queue_guard(QueueMutex);
+        Queues[std::clamp<JobPriority>(priority, JobPriority_High, JobPriority_Low)].push_back(std::move(task));
+    }
+    QueueSignal.notify_one();
+}
+
+void JobSystem::PostCompletion(Task completion)
+{
+    // Counted before the job itself is, so the pending count never touches zero in between
+    PendingJobCount.fetch_add(1, std::memory_order_acq_rel);
+    std::lock_guard completion_guard(CompletionMutex);
+    PendingCompletions.push_back(std::move(completion));
+    if (CompletionNotifier)
+        CompletionNotifier();
+}
+
+void JobSystem::WorkerLoop()
+{
+    std::unique_lock queue_lock(QueueMutex);
+    while (true) {
+        QueueSignal.wait(queue_lock, [this]() {
+            return StopWorkers || std::any_of(Queues.begin(), Queues.end(), [](const auto& queue) { return !queue.empty(); });
+        });
+        if (StopWorkers)
+            break;
+
+        auto& queue = *std::find_if(Queues.begin(), Queues.end(), [](const auto& queue) { return !queue.empty(); });
+        Task task = std::move(queue.front());
+        queue.pop_front();
+        queue_lock.unlock();
+
+        task();
+        PendingJobCount.fetch_sub(1, std::memory_order_acq_rel);
+
+        queue_lock.lock();
+    }
+}
+
+}
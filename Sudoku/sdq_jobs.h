@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Small fixed pool of worker threads for everything that runs off the render thread.
+// Jobs are queued by priority and picked up by whichever worker is free, so no thread is created per action and
+// several jobs can run at once. The optional completion of a job is queued back to the owner of the system, which
+// runs it with RunCompletions() at a point of its frame where touching UI state is safe, instead of polling futures.
+
+enum JobPriority_
+{
+    JobPriority_High   = 0,    // The player waits on it behind a loading screen
+    JobPriority_Normal = 1,    // Short work the player started, e.g. writing a save
+    JobPriority_Low    = 2,    // Background work nobody waits on, e.g. grading
+    JobPriority_COUNT
+};
+using JobPriority = int;
+
+namespace sdq::jobs
+{
+
+using Task = std::function<void()>;
+
+class JobSystem
+{
+private:
+    std::vector<std::thread>                        Workers;
+    std::mutex                                      QueueMutex;
+    std::condition_variable                         QueueSignal;
+    std::array<std::deque<Task>, JobPriority_COUNT> Queues;
+    bool                                            StopWorkers;
+
+    std::mutex          CompletionMutex;
+    std::vector<Task>   PendingCompletions;      // Filled by the workers
+    std::vector<Task>   RunningCompletions;      // Swapped with PendingCompletions by RunCompletions()
+    Task                CompletionNotifier;
+    std::atomic<size_t> PendingJobCount;
+
+public:
+    explicit JobSystem(size_t worker_count = GetDefaultWorkerCount());
+    // Waits for the running jobs. Queued jobs and completions that haven't run are dropped
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator = (const JobSystem&) = delete;
+
+    // Queues work for the workers
+    void Submit(JobPriority priority, Task work);
+    // Queues work for the workers. Once it is done, RunCompletions() calls completion with what work returned
+    template<typename Work, typename Completion>
+    void Submit(JobPriority priority, Work work, Completion completion);
+
+    // Runs the completions of the finished jobs in the order they finished. Returns how many ran
+    size_t RunCompletions();
+    // Called on a worker every time a completion is queued, e.g. to wake up a render loop that waits for input.
+    // Set it before submitting anything
+    void SetCompletionNotifier(Task notifier);
+    // Jobs that are queued, running, or waiting for their completion to run
+    size_t GetPendingJobCount() const noexcept;
+    size_t GetWorkerCount() const noexcept;
+
+    static size_t GetDefaultWorkerCount() noexcept;
+
+private:
+    void Enqueue(JobPriority priority, Task task);
+    void PostCompletion(Task completion);
+    void WorkerLoop();
+};
+
+// Hands the latest object built on a worker to the owner thread with a single atomic pointer swap.
+// The worker builds the object on its own and publishes it whole, the owner takes it whenever it is ready to, so
+// neither side ever blocks or sees a half-built object. Publishing again before the owner took the object replaces it
+template<typename T>
+class Handoff
+{
+private:
+    std::atomic<T*> Published;
+
+public:
+    Handoff() noexcept : Published(nullptr) {}
+    ~Handoff() { delete Published.load(std::memory_order_acquire); }
+
+    Handoff(const Handoff&) = delete;
+    Handoff& operator = (const Handoff&) = delete;
+
+    // Called by the worker once the object is complete
+    void Publish(std::unique_ptr<T> object) noexcept
+    {
+        delete Published.exchange(object.release(), std::memory_order_acq_rel);
+    }
+
+    // Called by the owner. Empty if nothing was published since the last call
+    std::unique_ptr<T> Take() noexcept
+    {
+        return std::unique_ptr<T>(Published.exchange(nullptr, std::memory_order_acq_rel));
+    }
+};
+
+template<typename Work, typename Completion>
+void JobSystem::Submit(JobPriority priority, Work work, Completion completion)
+{
+    Enqueue(priority, [this, work = std::move(work), completion = std::move(completion)]() mutable {
+        if constexpr (std::is_void_v<std::invoke_result_t<Work&>>) {
+            work();
+            PostCompletion(std::move(completion));
+        }
+        else {
+            PostCompletion([completion = std::move(completion), result = work()]() mutable { completion(std::move(result)); });
+        }
+    });
+}
+
+}
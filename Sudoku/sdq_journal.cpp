@@ -0,0 +1,237 @@
+#include "sdq_journal.h"
+#include <chrono>
+#include <filesystem>
+
+namespace sdq::save
+{
+
+static bool IsValidEntry(const JournalEntry& entry) noexcept
+{
+    return entry.TileIdx == ElapsedSecondsEntry || (entry.TileIdx < 81 && entry.Number <= 9 && entry.Pencilmarks < (1 << 9));
+}
+
+static void ApplyEntry(SaveRecord& record, const JournalEntry& entry) noexcept
+{
+    if (entry.TileIdx == ElapsedSecondsEntry) {
+        record.ElapsedSeconds = (static_cast<uint32_t>(entry.Number) << 16) | entry.Pencilmarks;
+        return;
+    }
+
+    SetPackedDigit(record.PuzzleDigits, entry.TileIdx, entry.Number);
+    record.Pencilmarks[entry.TileIdx] = entry.Pencilmarks;
+}
+
+static JournalEntry MakeElapsedSecondsEntry(uint32_t elapsed_seconds) noexcept
+{
+    return { ElapsedSecondsEntry, static_cast<uint8_t>(elapsed_seconds >> 16), static_cast<uint16_t>(elapsed_seconds & 0xFFFF) };
+}
+
+static std::string GetSnapshotPath(const char* directory_name)
+{
+    return std::string(directory_name) + "\\autosave.bin";
+}
+
+static std::string GetJournalPath(const char* directory_name)
+{
+    return std::string(directory_name) + "\\autosave.journal";
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// Journal CLASS
+//--------------------------------------------------------------------------------------------------------------------------------
+
+Journal::Journal(const char* directory_name) :
+    SnapshotPath(GetSnapshotPath(directory_name)),
+    JournalPath(GetJournalPath(directory_name)),
+    LastTiles({}),
+    PendingElapsedSeconds(0),
+    SessionActive(false),
+    PendingDiscard(false),
+    StopWriter(false),
+    RecoveryAvailable(false),
+    ShadowRecord({}),
+    JournalEntryCount(0),
+    WriterActive(false)
+{
+    std::error_code error;
+    if (!std::filesystem::exists(directory_name, error))
+        std::filesystem::create_directory(directory_name, error);
+
+    RecoveryAvailable = std::filesystem::exists(SnapshotPath, error);
+    Writer = std::thread(&Journal::WriterLoop, this);
+}
+
+Journal::~Journal()
+{
+    {
+        std::lock_guard queue_guard(QueueMutex);
+        StopWriter = true;
+    }
+    QueueSignal.notify_one();
+    Writer.join();
+}
+
+void Journal::BeginSession(const SaveRecord& record) noexcept
+{
+    {
+        std::lock_guard queue_guard(QueueMutex);
+        PendingSnapshot = record;
+        PendingEntries.clear();
+        for (int tile_idx = 0; tile_idx < 81; ++tile_idx) {
+            LastTiles[tile_idx].TileIdx     = static_cast<uint8_t>(tile_idx);
+            LastTiles[tile_idx].Number      = static_cast<uint8_t>(GetPackedDigit(record.PuzzleDigits, tile_idx));
+            LastTiles[tile_idx].Pencilmarks = record.Pencilmarks[tile_idx];
+        }
+        PendingElapsedSeconds = record.ElapsedSeconds;
+        SessionActive         = true;
+        RecoveryAvailable     = true;
+    }
+    QueueSignal.notify_one();
+}
+
+void Journal::Record(const JournalEntry* tiles, size_t tile_count, uint32_t elapsed_seconds) noexcept
+{
+    // No notify here. The writer picks the entries up on its next flush, so a burst of moves is one write
+    std::lock_guard queue_guard(QueueMutex);
+    if (!SessionActive)
+        return;
+
+    for (size_t idx = 0; idx < tile_count; ++idx) {
+        const auto& tile = tiles[idx];
+        auto& last_tile = LastTiles[tile.TileIdx];
+        if (last_tile.Number == tile.Number && last_tile.Pencilmarks == tile.Pencilmarks)
+            continue;
+
+        last_tile = tile;
+        PendingEntries.push_back(tile);
+    }
+    PendingElapsedSeconds = elapsed_seconds < MaxJournalSeconds ? elapsed_seconds : MaxJournalSeconds;
+}
+
+void Journal::EndSession() noexcept
+{
+    {
+        std::lock_guard queue_guard(QueueMutex);
+        PendingSnapshot.reset();
+        PendingEntries.clear();
+        SessionActive     = false;
+        PendingDiscard    = true;
+        RecoveryAvailable = false;
+    }
+    QueueSignal.notify_one();
+}
+
+bool Journal::HasRecovery() noexcept
+{
+    std::lock_guard queue_guard(QueueMutex);
+    return RecoveryAvailable;
+}
+
+bool Journal::Recover(const char* directory_name, SaveRecord& record) noexcept
+{
+    if (ReadSaveRecord(GetSnapshotPath(directory_name).c_str(), record) != SaveReadResult_Ok)
+        return false;
+
+    std::ifstream journal_file(GetJournalPath(directory_name), std::ios::binary);
+    JournalHeader header;
+    if (journal_file.read(reinterpret_cast<char*>(&header), sizeof(JournalHeader)) &&
+        header.Magic == JournalMagic && header.Version >= 1 && header.Version <= JournalVersion && header.SnapshotChecksum == record.Header.Checksum)
+    {
+        // A torn or garbled tail from a crash mid write ends the replay
+        JournalEntry entry;
+        while (journal_file.read(reinterpret_cast<char*>(&entry), sizeof(JournalEntry)) && IsValidEntry(entry))
+            ApplyEntry(record, entry);
+    }
+
+    SealRecord(record, record.Header.Difficulty);
+    return true;
+}
+
+void Journal::WriterLoop()
+{
+    std::unique_lock queue_lock(QueueMutex);
+    while (true) {
+        QueueSignal.wait_for(queue_lock, std::chrono::milliseconds(FlushIntervalMs), [this]() {
+            return StopWriter || PendingDiscard || PendingSnapshot.has_value();
+        });
+
+        const bool     stop_writer     = StopWriter;
+        const bool     discard         = PendingDiscard;
+        const uint32_t elapsed_seconds = PendingElapsedSeconds;
+        std::optional<SaveRecord> snapshot;
+        snapshot.swap(PendingSnapshot);
+        PendingDiscard = false;
+        std::swap(PendingEntries, WritingEntries);
+        queue_lock.unlock();
+
+        if (discard)
+            DiscardFiles();
+        if (snapshot.has_value())
+            StartFiles(snapshot.value());
+        // The play time goes in with the batch it was recorded with, so a recovered game doesn't restart its timer
+        if (WriterActive && elapsed_seconds != ShadowRecord.ElapsedSeconds)
+            WritingEntries.push_back(MakeElapsedSecondsEntry(elapsed_seconds));
+        if (!WritingEntries.empty())
+            AppendEntries();
+        if (WriterActive && (JournalEntryCount >= CompactThreshold || (stop_writer && JournalEntryCount > 0)))
+            CompactJournal();
+        WritingEntries.clear();
+
+        queue_lock.lock();
+        if (stop_writer)
+            break;
+    }
+}
+
+void Journal::StartFiles(const SaveRecord& record)
+{
+    ShadowRecord = record;
+    WriterActive = WriteFileAtomically(SnapshotPath.c_str(), &ShadowRecord, sizeof(SaveRecord)) && ResetJournalFile();
+}
+
+void Journal::AppendEntries()
+{
+    if (!WriterActive)
+        return;
+
+    JournalFile.write(reinterpret_cast<const char*>(WritingEntries.data()), WritingEntries.size() * sizeof(JournalEntry));
+    JournalFile.flush();
+    for (const auto& entry : WritingEntries)
+        ApplyEntry(ShadowRecord, entry);
+    JournalEntryCount += WritingEntries.size();
+}
+
+void Journal::CompactJournal()
+{
+    // The new snapshot lands before the journal is reset. If we crash in between, the old journal no longer
+    // matches the snapshot checksum and is ignored, and the snapshot already has its entries
+    SealRecord(ShadowRecord, ShadowRecord.Header.Difficulty);
+    WriterActive = WriteFileAtomically(SnapshotPath.c_str(), &ShadowRecord, sizeof(SaveRecord)) && ResetJournalFile();
+}
+
+void Journal::DiscardFiles()
+{
+    JournalFile.close();
+    WriterActive      = false;
+    JournalEntryCount = 0;
+
+    std::error_code error;
+    std::filesystem::remove(JournalPath, error);
+    std::filesystem::remove(SnapshotPath, error);
+}
+
+bool Journal::ResetJournalFile()
+{
+    JournalFile.close();
+    JournalFile.open(JournalPath, std::ios::binary | std::ios::trunc);
+    JournalEntryCount = 0;
+    if (!JournalFile.good())
+        return false;
+
+    const JournalHeader header = { JournalMagic, JournalVersion, 0, ShadowRecord.Header.Checksum };
+    JournalFile.write(reinterpret_cast<const char*>(&header), sizeof(JournalHeader));
+    JournalFile.flush();
+    return JournalFile.good();
+}
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "sdq_save.h"
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Crash safe autosave.
+// Every move appends the tiles it changed and the play time to an append only journal. A background writer owns all of the file I/O:
+// it appends the journal in batches and every so often folds it into a full snapshot that is swapped in with a rename.
+// Recovering is loading the snapshot and replaying the journal on top of it.
+// The game thread only ever takes a short lock to queue entries, it never waits on the disk.
+
+namespace sdq::save
+{
+
+constexpr uint32_t JournalMagic   = 0x4A514453; // "SDQJ"
+constexpr uint16_t JournalVersion = 2;         // Version 1 has no play time entries
+
+struct JournalHeader
+{
+    uint32_t Magic;
+    uint16_t Version;
+    uint16_t Reserved;
+    uint32_t SnapshotChecksum; // The journal only applies to the snapshot with this checksum
+};
+
+// The new state of one puzzle tile. Replaying an entry twice gives the same board
+struct JournalEntry
+{
+    uint8_t  TileIdx;
+    uint8_t  Number;
+    uint16_t Pencilmarks;
+};
+
+// An entry with this TileIdx holds the play time instead of a tile, the top 8 bits in Number and the rest in Pencilmarks
+constexpr uint8_t  ElapsedSecondsEntry = 0xFF;
+constexpr uint32_t MaxJournalSeconds   = 0xFFFFFF;
+
+static_assert(sizeof(JournalHeader) == 12, "JournalHeader layout changed! Bump the journal version.");
+static_assert(sizeof(JournalEntry) == 4, "JournalEntry layout changed! Bump the journal version.");
+
+class Journal
+{
+private:
+    static constexpr size_t CompactThreshold = 1024;   // Journal entries before the writer folds them into a snapshot
+    static constexpr int    FlushIntervalMs  = 250;
+
+    std::string SnapshotPath;
+    std::string JournalPath;
+
+    // Shared with the writer thread
+    std::mutex                   QueueMutex;
+    std::condition_variable      QueueSignal;
+    std::vector<JournalEntry>    PendingEntries;
+    std::optional<SaveRecord>    PendingSnapshot;
+    std::array<JournalEntry, 81> LastTiles;            // Tile states already queued, so only the changed tiles are journaled
+    uint32_t                     PendingElapsedSeconds;
+    bool                         SessionActive;
+    bool                         PendingDiscard;
+    bool                         StopWriter;
+    bool                         RecoveryAvailable;
+
+    // Only touched by the writer thread
+    std::vector<JournalEntry> WritingEntries;
+    SaveRecord                ShadowRecord;            // Snapshot plus every journaled entry
+    std::ofstream             JournalFile;
+    size_t                    JournalEntryCount;
+    bool                      WriterActive;
+
+    std::thread Writer;
+
+public:
+    explicit Journal(const char* directory_name);
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator = (const Journal&) = delete;
+
+    // Starts journaling a new game. The record becomes the first snapshot
+    void BeginSession(const SaveRecord& record) noexcept;
+    // Queues the given tiles that changed since they were last queued, and the play time with them
+    void Record(const JournalEntry* tiles, size_t tile_count, uint32_t elapsed_seconds) noexcept;
+    // Stops journaling and deletes the autosave, e.g. when the puzzle is finished
+    void EndSession() noexcept;
+    // True if there is an autosave on disk that Recover can load
+    bool HasRecovery() noexcept;
+
+    // Static Function! Loads the snapshot and replays the journal on top of it
+    static bool Recover(const char* directory_name, SaveRecord& record) noexcept;
+
+private:
+    void WriterLoop();
+    void StartFiles(const SaveRecord& record);
+    void AppendEntries();
+    void CompactJournal();
+    void DiscardFiles();
+    bool ResetJournalFile();
+};
+
+}
@@ -0,0 +1,110 @@
+#include "sdq_metrics.h"
+#include <algorithm>
+
+namespace sdq::metrics
+{
+
+namespace
+{
+
+// Every counter and ring gets its own cache line, so threads bumping different metrics never share one
+struct alignas(64) CounterSlot
+{
+    std::atomic<uint64_t> Value = 0;
+};
+
+struct alignas(64) LatencyRing
+{
+    std::array<std::atomic<float>, LatencyHistorySize> Samples = {};
+    std::atomic<uint64_t>                              WriteIndex = 0;
+};
+
+struct alignas(64) FrameRing
+{
+    std::array<std::atomic<float>, FrameHistorySize> BuildMs  = {};
+    std::array<std::atomic<float>, FrameHistorySize> RenderMs = {};
+    std::atomic<uint64_t>                            WriteIndex = 0;
+};
+
+std::array<CounterSlot, MetricCounter_COUNT>   Counters;
+std::array<LatencyRing, MetricOperation_COUNT> Latencies;
+FrameRing                                      Frames;
+
+constexpr std::array<const char*, MetricCounter_COUNT>   CounterNames   = { "Generation attempts", "Uniqueness checks", "Grader runs", "Grade cache hits", "Derived puzzles" };
+constexpr std::array<const char*, MetricOperation_COUNT> OperationNames = { "New game", "Load save file", "Save progress", "Startup to first frame",
+                                                                             "Font atlas from cache", "Font atlas baked" };
+
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// Counters
+//--------------------------------------------------------------------------------------------------------------------------------
+
+void IncrementCounter(MetricCounter counter, uint64_t amount) noexcept
+{
+    Counters[counter].Value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+uint64_t GetCounter(MetricCounter counter) noexcept
+{
+    return Counters[counter].Value.load(std::memory_order_relaxed);
+}
+
+const char* GetCounterName(MetricCounter counter) noexcept
+{
+    return CounterNames[counter];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// Latencies
+//--------------------------------------------------------------------------------------------------------------------------------
+
+void RecordLatency(MetricOperation operation, float milliseconds) noexcept
+{
+    // fetch_add hands every writer its own slot, so two threads finishing at once don't overwrite each other
+    auto& ring = Latencies[operation];
+    const uint64_t index = ring.WriteIndex.fetch_add(1, std::memory_order_relaxed);
+    ring.Samples[index % LatencyHistorySize].store(milliseconds, std::memory_order_relaxed);
+}
+
+size_t GetLatencies(MetricOperation operation, std::array<float, LatencyHistorySize>& latencies) noexcept
+{
+    const auto& ring = Latencies[operation];
+    const uint64_t end_index   = ring.WriteIndex.load(std::memory_order_relaxed);
+    const uint64_t begin_index = end_index > LatencyHistorySize ? end_index - LatencyHistorySize : 0;
+    for (uint64_t idx = begin_index; idx < end_index; ++idx)
+        latencies[idx - begin_index] = ring.Samples[idx % LatencyHistorySize].load(std::memory_order_relaxed);
+
+    return static_cast<size_t>(end_index - begin_index);
+}
+
+const char* GetOperationName(MetricOperation operation) noexcept
+{
+    return OperationNames[operation];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// Frame Times
+//--------------------------------------------------------------------------------------------------------------------------------
+
+void RecordFrameTime(float build_ms, float render_ms) noexcept
+{
+    const uint64_t index = Frames.WriteIndex.load(std::memory_order_relaxed);
+    Frames.BuildMs[index % FrameHistorySize].store(build_ms, std::memory_order_relaxed);
+    Frames.RenderMs[index % FrameHistorySize].store(render_ms, std::memory_order_relaxed);
+    Frames.WriteIndex.store(index + 1, std::memory_order_release);
+}
+
+size_t GetFrameTimes(std::array<FrameTime, FrameHistorySize>& frame_times) noexcept
+{
+    const uint64_t end_index   = Frames.WriteIndex.load(std::memory_order_acquire);
+    const uint64_t begin_index = end_index > FrameHistorySize ? end_index - FrameHistorySize : 0;
+    for (uint64_t idx = begin_index; idx < end_index; ++idx) {
+        frame_times[idx - begin_index].BuildMs  = Frames.BuildMs[idx % FrameHistorySize].load(std::memory_order_relaxed);
+        frame_times[idx - begin_index].RenderMs = Frames.RenderMs[idx % FrameHistorySize].load(std::memory_order_relaxed);
+    }
+
+    return static_cast<size_t>(end_index - begin_index);
+}
+
+}
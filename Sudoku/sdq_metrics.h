@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Live performance numbers for the in-game overlay.
+// Everything is a relaxed atomic, so generation threads publish counters and latencies without ever taking a lock,
+// and the render thread reads whatever is there when it draws. A reader can see a sample that is one write behind,
+// which is fine for a display.
+
+enum MetricCounter_
+{
+    MetricCounter_GenerationAttempts = 0,    // Complete boards generated while looking for a puzzle of the asked difficulty
+    MetricCounter_UniquenessChecks   = 1,
+    MetricCounter_GraderRuns         = 2,    // Difficulty checks by the human-like solver
+    MetricCounter_GradeCacheHits     = 3,    // Difficulty checks answered by the grade cache instead of the solver
+    MetricCounter_DerivedPuzzles     = 4,    // Puzzles transformed from a seed puzzle instead of generated
+    MetricCounter_COUNT
+};
+using MetricCounter = int;
+
+enum MetricOperation_
+{
+    MetricOperation_CreateNewGame = 0,
+    MetricOperation_LoadSaveFile  = 1,
+    MetricOperation_SaveProgress  = 2,
+    MetricOperation_Startup       = 3,    // Launch to the first presented frame
+    MetricOperation_FontAtlasLoad = 4,    // Font atlas restored from the baked cache
+    MetricOperation_FontAtlasBake = 5,    // Font atlas rasterized because the cache was missing or stale
+    MetricOperation_COUNT
+};
+using MetricOperation = int;
+
+namespace sdq::metrics
+{
+
+// Number of latencies kept per operation and of frames kept in the frame time history
+constexpr size_t LatencyHistorySize = 32;
+constexpr size_t FrameHistorySize   = 120;
+
+struct FrameTime
+{
+    float BuildMs;     // ImGui frame build, i.e. NewFrame and every window of the game
+    float RenderMs;    // Draw data submission and buffer swap
+};
+
+void        IncrementCounter(MetricCounter counter, uint64_t amount = 1) noexcept;
+uint64_t    GetCounter(MetricCounter counter) noexcept;
+const char* GetCounterName(MetricCounter counter) noexcept;
+
+void        RecordLatency(MetricOperation operation, float milliseconds) noexcept;
+// Copies the latest latencies of the operation, oldest first. Returns how many were copied
+size_t      GetLatencies(MetricOperation operation, std::array<float, LatencyHistorySize>& latencies) noexcept;
+const char* GetOperationName(MetricOperation operation) noexcept;
+
+// Only called by the render thread
+void        RecordFrameTime(float build_ms, float render_ms) noexcept;
+// Copies the latest frame times, oldest first. Returns how many were copied
+size_t      GetFrameTimes(std::array<FrameTime, FrameHistorySize>& frame_times) noexcept;
+
+// Records the time from construction to destruction as a latency of the operation
+class ScopedLatency
+{
+private:
+    MetricOperation                       Operation;
+    std::chrono::steady_clock::time_point Start;
+
+public:
+    explicit ScopedLatency(MetricOperation operation) noexcept : Operation(operation), Start(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() noexcept
+    {
+        RecordLatency(Operation, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - Start).count());
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator = (const ScopedLatency&) = delete;
+};
+
+}
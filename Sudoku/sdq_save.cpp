@@ -0,0 +1,207 @@
+#include "sdq_save.h"
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <filesystem>
+#include <string>
+
+namespace sdq::save
+{
+
+uint32_t Checksum(const void* data, size_t size, uint32_t hash) noexcept
+{
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t idx = 0; idx < size; ++idx) {
+        hash ^= bytes[idx];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+constexpr uint32_t MaxHistoryTurns = 1 << 20;
+
+static bool IsSupportedVersion(uint16_t version) noexcept
+{
+    return version >= 1 && version <= SaveVersion;
+}
+
+// Versions 1 and 2 end where the play time starts
+static size_t GetRecordSize(uint16_t version) noexcept
+{
+    return version < 3 ? offsetof(SaveRecord, ElapsedSeconds) : sizeof(SaveRecord);
+}
+
+static uint32_t RecordPayloadChecksum(const SaveRecord& record, size_t record_size = sizeof(SaveRecord)) noexcept
+{
+    const auto* payload = reinterpret_cast<const uint8_t*>(&record) + sizeof(SaveHeader);
+    return Checksum(payload, record_size - sizeof(SaveHeader));
+}
+
+void SealRecord(SaveRecord& record, int difficulty) noexcept
+{
+    record.Header.Magic      = SaveMagic;
+    record.Header.Version    = SaveVersion;
+    record.Header.Difficulty = static_cast<uint8_t>(difficulty);
+    record.Header.Reserved   = 0;
+    record.Header.Timestamp  = static_cast<int64_t>(std::time(nullptr));
+    record.Header.RecordSize = sizeof(SaveRecord);
+    record.Padding           = 0;
+    record.Reserved          = 0;
+    record.Header.Checksum   = RecordPayloadChecksum(record);
+}
+
+SaveReadResult ReadSaveHeader(const char* filepath, SaveHeader& header) noexcept
+{
+    std::ifstream ifile(filepath, std::ios::binary);
+    if (!ifile.good())
+        return SaveReadResult_NotFound;
+
+    if (!ifile.read(reinterpret_cast<char*>(&header), sizeof(SaveHeader)) || header.Magic != SaveMagic)
+        return SaveReadResult_Legacy;
+
+    if (!IsSupportedVersion(header.Version) || header.RecordSize != GetRecordSize(header.Version))
+        return SaveReadResult_Corrupted;
+
+    return SaveReadResult_Ok;
+}
+
+SaveReadResult ReadSaveRecord(const char* filepath, SaveRecord& record, TurnHistory* history) noexcept
+{
+    std::ifstream ifile(filepath, std::ios::binary);
+    if (!ifile.good())
+        return SaveReadResult_NotFound;
+
+    if (!ifile.read(reinterpret_cast<char*>(&record.Header), sizeof(SaveHeader)) || record.Header.Magic != SaveMagic)
+        return SaveReadResult_Legacy;
+
+    if (!IsSupportedVersion(record.Header.Version))
+        return SaveReadResult_Corrupted;
+
+    // The history of an older save starts right after its shorter record
+    const size_t record_size = GetRecordSize(record.Header.Version);
+    record.ElapsedSeconds = 0;
+    record.Reserved       = 0;
+    if (record.Header.RecordSize != record_size ||
+        !ifile.read(reinterpret_cast<char*>(&record) + sizeof(SaveHeader), record_size - sizeof(SaveHeader)))
+        return SaveReadResult_Corrupted;
+
+    if (record.Header.Checksum != RecordPayloadChecksum(record, record_size))
+        return SaveReadResult_Corrupted;
+
+    if (history == nullptr)
+        return SaveReadResult_Ok;
+
+    history->Turns.clear();
+    history->UndoPosition = 0;
+    TurnHistoryHeader history_header;
+    if (record.Header.Version < 2 || !ifile.read(reinterpret_cast<char*>(&history_header), sizeof(TurnHistoryHeader)))
+        return SaveReadResult_Ok;
+
+    // Don't trust a damaged count with a huge allocation
+    if (history_header.TurnCount > MaxHistoryTurns)
+        return SaveReadResult_Ok;
+
+    history->Turns.resize(history_header.TurnCount);
+    const bool history_read = ifile.read(reinterpret_cast<char*>(history->Turns.data()), history_header.TurnCount * sizeof(uint32_t)).good();
+    if (!history_read || history_header.UndoPosition > history_header.TurnCount ||
+        history_header.Checksum != Checksum(history->Turns.data(), history->Turns.size() * sizeof(uint32_t)))
+    {
+        history->Turns.clear();
+        return SaveReadResult_Ok;
+    }
+    history->UndoPosition = history_header.UndoPosition;
+
+    return SaveReadResult_Ok;
+}
+
+// The whole file goes through WriteFileAtomically, so a failed overwrite keeps the previous save
+bool WriteSaveRecord(const char* filepath, const SaveRecord& record, const TurnHistory* history) noexcept
+{
+    const size_t history_size = history != nullptr ? sizeof(TurnHistoryHeader) + history->Turns.size() * sizeof(uint32_t) : 0;
+    std::vector<char> bytes(sizeof(SaveRecord) + history_size);
+    std::memcpy(bytes.data(), &record, sizeof(SaveRecord));
+    if (history != nullptr) {
+        TurnHistoryHeader history_header;
+        history_header.TurnCount    = static_cast<uint32_t>(history->Turns.size());
+        history_header.UndoPosition = history->UndoPosition;
+        history_header.Checksum     = Checksum(history->Turns.data(), history->Turns.size() * sizeof(uint32_t));
+        std::memcpy(bytes.data() + sizeof(SaveRecord), &history_header, sizeof(TurnHistoryHeader));
+        if (!history->Turns.empty())
+            std::memcpy(bytes.data() + sizeof(SaveRecord) + sizeof(TurnHistoryHeader), history->Turns.data(), history->Turns.size() * sizeof(uint32_t));
+    }
+
+    return WriteFileAtomically(filepath, bytes.data(), bytes.size());
+}
+
+int GetRecordProgress(const SaveRecord& record) noexcept
+{
+    int puzzle_tiles = 0;
+    int filled_tiles = 0;
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        if (!IsBitmapSet(record.PuzzleTileBitmap, tile_idx))
+            continue;
+
+        ++puzzle_tiles;
+        if (GetPackedDigit(record.PuzzleDigits, tile_idx) != 0)
+            ++filled_tiles;
+    }
+
+    return puzzle_tiles == 0 ? 100 : (filled_tiles * 100) / puzzle_tiles;
+}
+
+SaveReadResult ReadSaveManifest(const char* filepath, SaveManifest& manifest) noexcept
+{
+    std::ifstream ifile(filepath, std::ios::binary);
+    if (!ifile.good())
+        return SaveReadResult_NotFound;
+
+    if (!ifile.read(reinterpret_cast<char*>(&manifest), sizeof(SaveManifest)) || manifest.Magic != ManifestMagic)
+        return SaveReadResult_Corrupted;
+
+    if (manifest.Version != ManifestVersion || manifest.SlotCount != ManifestSlotCount)
+        return SaveReadResult_Corrupted;
+
+    if (manifest.Checksum != Checksum(manifest.Slots.data(), sizeof(manifest.Slots)))
+        return SaveReadResult_Corrupted;
+
+    return SaveReadResult_Ok;
+}
+
+bool WriteSaveManifest(const char* filepath, SaveManifest& manifest) noexcept
+{
+    manifest.Magic     = ManifestMagic;
+    manifest.Version   = ManifestVersion;
+    manifest.SlotCount = ManifestSlotCount;
+    manifest.Reserved  = 0;
+    manifest.Checksum  = Checksum(manifest.Slots.data(), sizeof(manifest.Slots));
+
+    return WriteFileAtomically(filepath, &manifest, sizeof(SaveManifest));
+}
+
+bool WriteFileAtomically(const char* filepath, const void* data, size_t size) noexcept
+{
+    std::string temp_filepath = filepath;
+    temp_filepath += ".tmp";
+    {
+        std::ofstream ofile(temp_filepath, std::ios::binary | std::ios::trunc);
+        if (!ofile.good())
+            return false;
+
+        ofile.write(static_cast<const char*>(data), size);
+        ofile.flush();
+        if (!ofile.good())
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_filepath, filepath, error);
+    if (error) {
+        std::filesystem::remove(temp_filepath, error);
+        return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed layout save record for sudoku progress.
+// The whole record is one plain struct, so a save is a single write and a load is a single read (or mmap) with
+// no parsing and no exceptions. Metadata only needs the header at the front of the file.
+// Multi-byte fields are stored in the native byte order, which is little endian on every platform we ship.
+// Version 2 appends the packed undo history after the record. Version 1 files are still read, just without a history.
+// Version 3 adds the play time to the end of the record. Older records are read as they are, with no play time.
+
+enum SaveReadResult_
+{
+    SaveReadResult_Ok        = 0,
+    SaveReadResult_NotFound  = 1,    // The file does not exist or can't be opened
+    SaveReadResult_Legacy    = 2,    // The file is not a save record. Possibly an old boost archive save
+    SaveReadResult_Corrupted = 3     // The header is ours but the size, version or checksum does not match
+};
+
+using SaveReadResult = int;
+
+namespace sdq::save
+{
+
+constexpr uint32_t SaveMagic   = 0x53514453; // "SDQS"
+constexpr uint16_t SaveVersion = 3;
+
+constexpr uint32_t ManifestMagic     = 0x4D514453; // "SDQM"
+constexpr uint16_t ManifestVersion   = 1;
+constexpr uint16_t ManifestSlotCount = 100;
+
+struct SaveHeader
+{
+    uint32_t Magic;
+    uint16_t Version;
+    uint8_t  Difficulty;
+    uint8_t  Reserved;
+    int64_t  Timestamp;    // Seconds since epoch of when the record was made
+    uint32_t Checksum;     // FNV-1a of everything after the header
+    uint32_t RecordSize;   // sizeof(SaveRecord) of the writer
+};
+
+struct SaveRecord
+{
+    SaveHeader                Header;
+    std::array<uint16_t, 81>  Pencilmarks;       // 9 bit pencilmark mask of each tile, row major
+    std::array<uint8_t, 41>   SolutionDigits;    // Two digits per byte, low nibble first, row major
+    std::array<uint8_t, 41>   PuzzleDigits;      // Same packing as the solution digits
+    std::array<uint8_t, 11>   PuzzleTileBitmap;  // Bit N is set if tile N is a tile the player fills in
+    uint8_t                   Padding;
+    uint32_t                  ElapsedSeconds;    // Play time of the game. Version 3 and up
+    uint32_t                  Reserved;
+};
+
+// Trailer of version 2 saves, followed by TurnCount packed turns
+struct TurnHistoryHeader
+{
+    uint32_t TurnCount;
+    uint32_t UndoPosition;
+    uint32_t Checksum;     // FNV-1a of the packed turns
+};
+
+struct TurnHistory
+{
+    std::vector<uint32_t> Turns;          // Packed turns, oldest first. See TurnLog for the layout
+    uint32_t              UndoPosition = 0;
+};
+
+// Metadata of every save slot kept in one small file, so listing the slots is a single read
+struct SaveSlotInfo
+{
+    uint8_t  Exists;
+    uint8_t  Difficulty;
+    uint8_t  Progress;         // Percentage of the puzzle tiles that are filled in
+    uint8_t  Reserved;
+    uint32_t ElapsedSeconds;   // Play time of the saved game
+    int64_t  Timestamp;        // Seconds since epoch of when the slot was saved
+};
+
+struct SaveManifest
+{
+    uint32_t Magic;
+    uint16_t Version;
+    uint16_t SlotCount;
+    uint32_t Checksum;         // FNV-1a of the slots
+    uint32_t Reserved;
+    std::array<SaveSlotInfo, ManifestSlotCount> Slots;
+};
+
+static_assert(sizeof(SaveHeader) == 24, "SaveHeader layout changed! Bump the save version.");
+static_assert(sizeof(SaveRecord) == 288, "SaveRecord layout changed! Bump the save version.");
+static_assert(sizeof(TurnHistoryHeader) == 12, "TurnHistoryHeader layout changed! Bump the save version.");
+static_assert(sizeof(SaveSlotInfo) == 16, "SaveSlotInfo layout changed! Bump the manifest version.");
+
+uint32_t       Checksum(const void* data, size_t size, uint32_t hash = 2166136261u) noexcept;
+// Fills the header fields and the checksum of a record whose payload is already set
+void           SealRecord(SaveRecord& record, int difficulty) noexcept;
+// The history is optional both ways. A missing or damaged history leaves it empty and still loads the record
+SaveReadResult ReadSaveRecord(const char* filepath, SaveRecord& record, TurnHistory* history = nullptr) noexcept;
+SaveReadResult ReadSaveHeader(const char* filepath, SaveHeader& header) noexcept;
+bool           WriteSaveRecord(const char* filepath, const SaveRecord& record, const TurnHistory* history = nullptr) noexcept;
+// Percentage of the puzzle tiles of a record that are filled in
+int            GetRecordProgress(const SaveRecord& record) noexcept;
+
+// Anything other than SaveReadResult_Ok means the manifest should be rebuilt from the save files
+SaveReadResult ReadSaveManifest(const char* filepath, SaveManifest& manifest) noexcept;
+bool           WriteSaveManifest(const char* filepath, SaveManifest& manifest) noexcept;
+// Writes into a temporary file first and renames it over the old file, so a crash never leaves a half written file
+bool           WriteFileAtomically(const char* filepath, const void* data, size_t size) noexcept;
+
+constexpr int GetPackedDigit(const std::array<uint8_t, 41>& digits, int tile_idx) noexcept
+{
+    return (tile_idx & 1) ? digits[tile_idx >> 1] >> 4 : digits[tile_idx >> 1] & 0x0F;
+}
+
+constexpr void SetPackedDigit(std::array<uint8_t, 41>& digits, int tile_idx, int digit) noexcept
+{
+    uint8_t& packed = digits[tile_idx >> 1];
+    packed = (tile_idx & 1) ? static_cast<uint8_t>((packed & 0x0F) | (digit << 4)) : static_cast<uint8_t>((packed & 0xF0) | digit);
+}
+
+constexpr bool IsBitmapSet(const std::array<uint8_t, 11>& bitmap, int tile_idx) noexcept
+{
+    return (bitmap[tile_idx >> 3] >> (tile_idx & 7)) & 1;
+}
+
+constexpr void SetBitmap(std::array<uint8_t, 11>& bitmap, int tile_idx) noexcept
+{
+    bitmap[tile_idx >> 3] |= static_cast<uint8_t>(1 << (tile_idx & 7));
+}
+
+}
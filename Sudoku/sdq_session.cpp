@@ -0,0 +1,453 @@
+#include "sdq_session.h"
+#include "sdq_trace.h"
+#include <algorithm>
+
+namespace sdq::session
+{
+
+// Session id layout. Bits 0-3 are the shard, 4-31 the record of the shard and 32-63 the generation of the record
+constexpr uint64_t ShardBits = 4;
+constexpr uint64_t SlotMask  = 0x0FFFFFFF;
+
+static_assert((size_t(1) << ShardBits) == ShardCount, "The shard bits of the session id don't match the shard count");
+
+static constexpr SessionId MakeSessionId(size_t shard_idx, uint32_t slot, uint32_t generation) noexcept
+{
+    return (static_cast<uint64_t>(generation) << 32) | (static_cast<uint64_t>(slot) << ShardBits) | shard_idx;
+}
+
+static uint32_t& GetRingTurn(SessionRecord& record, size_t turn_idx) noexcept
+{
+    return record.Turns[(record.FirstTurn + turn_idx) % SessionTurnCapacity];
+}
+
+static const uint32_t& GetRingTurn(const SessionRecord& record, size_t turn_idx) noexcept
+{
+    return record.Turns[(record.FirstTurn + turn_idx) % SessionTurnCapacity];
+}
+
+static bool IsPuzzleTile(const SessionRecord& record, int row, int col) noexcept
+{
+    return row >= 0 && row < 9 && col >= 0 && col < 9 && save::IsBitmapSet(record.Board.PuzzleTileBitmap, (row * 9) + col);
+}
+
+static uint16_t GetDigitBit(const SessionRecord& record, int tile_idx) noexcept
+{
+    const int digit = save::GetPackedDigit(record.Board.PuzzleDigits, tile_idx);
+    return digit == 0 ? 0 : static_cast<uint16_t>(1u << (digit - 1));
+}
+
+static void RebuildUnitNumbers(SessionRecord& record) noexcept
+{
+    record.UnitNumbers.fill(0);
+    for (int idx = 0; idx < 81; ++idx) {
+        const int row = idx / 9, col = idx % 9;
+        const uint16_t digit_bit = GetDigitBit(record, idx);
+        record.UnitNumbers[row] |= digit_bit;
+        record.UnitNumbers[9 + col] |= digit_bit;
+        record.UnitNumbers[18 + (row / 3) * 3 + col / 3] |= digit_bit;
+    }
+}
+
+// Rescans the three units of the tile only. A bit can't just be cleared, a number that breaks the rules can still be
+// in the unit twice
+static void UpdateUnitNumbers(SessionRecord& record, int tile_idx) noexcept
+{
+    const int row = tile_idx / 9, col = tile_idx % 9;
+    const int block_row = (row / 3) * 3, block_col = (col / 3) * 3;
+    uint16_t row_numbers = 0, col_numbers = 0, block_numbers = 0;
+    for (int idx = 0; idx < 9; ++idx) {
+        row_numbers   |= GetDigitBit(record, (row * 9) + idx);
+        col_numbers   |= GetDigitBit(record, (idx * 9) + col);
+        block_numbers |= GetDigitBit(record, ((block_row + idx / 3) * 9) + block_col + idx % 3);
+    }
+
+    record.UnitNumbers[row]                            = row_numbers;
+    record.UnitNumbers[9 + col]                        = col_numbers;
+    record.UnitNumbers[18 + block_row + block_col / 3] = block_numbers;
+}
+
+// Changes the number of a tile like GameBoard::UpdateTileNumber does. A set pencilmark bit rules the number out, so a
+// new number is ruled out in the empty peers, and a cleared tile and its empty peers get back what their units allow
+static void UpdateTileDigit(SessionRecord& record, int tile_idx, int number) noexcept
+{
+    const int prev_num = save::GetPackedDigit(record.Board.PuzzleDigits, tile_idx);
+    if (prev_num == number)
+        return;
+
+    save::SetPackedDigit(record.Board.PuzzleDigits, tile_idx, number);
+    UpdateUnitNumbers(record, tile_idx);
+
+    const auto get_unit_numbers = [&record](int idx) {
+        const int row = idx / 9, col = idx % 9;
+        return static_cast<uint16_t>(record.UnitNumbers[row] | record.UnitNumbers[9 + col] | record.UnitNumbers[18 + (row / 3) * 3 + col / 3]);
+    };
+
+    for (const auto peer_idx : sdq::helpers::GetPeers(tile_idx / 9, tile_idx % 9)) {
+        if (save::GetPackedDigit(record.Board.PuzzleDigits, peer_idx) != 0)
+            continue;
+
+        if (number != 0)
+            record.Board.Pencilmarks[peer_idx] |= get_unit_numbers(peer_idx);
+        else
+            record.Board.Pencilmarks[peer_idx] &= get_unit_numbers(peer_idx);
+    }
+
+    if (number == 0)
+        record.Board.Pencilmarks[tile_idx] &= get_unit_numbers(tile_idx);
+}
+
+// Puts a turn back on the board like Instance::ApplyUndoTurn and Instance::ApplyRedoTurn
+static void ApplyTurn(SessionRecord& record, const TurnLog::TurnTile& turn_tile, bool undo) noexcept
+{
+    const int tile_idx = (turn_tile.Row * 9) + turn_tile.Column;
+    if (undo) {
+        UpdateTileDigit(record, tile_idx, turn_tile.PreviousNumber);
+        record.Board.Pencilmarks[tile_idx] = static_cast<uint16_t>(turn_tile.PreviousPencilmark.to_ulong());
+    }
+    else if (save::GetPackedDigit(record.Board.PuzzleDigits, tile_idx) == turn_tile.NextNumber)
+        record.Board.Pencilmarks[tile_idx] = static_cast<uint16_t>(turn_tile.NextPencilmark.to_ulong());
+    else
+        UpdateTileDigit(record, tile_idx, turn_tile.NextNumber);
+}
+
+SessionManager::SessionManager() noexcept : NextShard(0)
+{}
+
+SessionId SessionManager::CreateSession(SudokuDifficulty difficulty, uint64_t seed) noexcept
+{
+    SDQ_TRACE_SCOPE("SessionManager::CreateSession");
+    save::SaveRecord record;
+    {
+        // Only lives while generating, the session keeps the packed record
+        Instance instance;
+        if (!instance.CreateSudoku(difficulty, seed))
+            return InvalidSessionId;
+
+        instance.CreateSaveRecord(record);
+    }
+
+    return this->OpenSession(record);
+}
+
+SessionId SessionManager::OpenSession(const save::SaveRecord& record, const save::TurnHistory* history) noexcept
+{
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        if (save::GetPackedDigit(record.SolutionDigits, tile_idx) > 9 || save::GetPackedDigit(record.PuzzleDigits, tile_idx) > 9 || record.Pencilmarks[tile_idx] > 0x1FF)
+            return InvalidSessionId;
+    }
+
+    const size_t shard_idx = NextShard.fetch_add(1, std::memory_order_relaxed) % ShardCount;
+    Shard& shard = Shards[shard_idx];
+    std::lock_guard shard_lock(shard.Mutex);
+    if (shard.FreeSlots.empty()) {
+        const size_t first_slot = shard.Slabs.size() * SlabSessions;
+        if (first_slot + SlabSessions > SlotMask + 1)
+            return InvalidSessionId;
+
+        // Value initialized, so every record starts inactive at generation 0. Pushed in reverse to hand out the low slots first
+        shard.Slabs.push_back(std::make_unique<SessionSlab>());
+        shard.FreeSlots.reserve(shard.FreeSlots.size() + SlabSessions);
+        for (size_t slot = first_slot + SlabSessions; slot-- > first_slot;)
+            shard.FreeSlots.push_back(static_cast<uint32_t>(slot));
+    }
+
+    const uint32_t slot = shard.FreeSlots.back();
+    shard.FreeSlots.pop_back();
+    ++shard.ActiveCount;
+
+    SessionRecord& session = (*shard.Slabs[slot / SlabSessions])[slot % SlabSessions];
+    session.Board        = record;
+    RebuildUnitNumbers(session);
+    session.Generation   = session.Generation == UINT32_MAX ? 1 : session.Generation + 1;
+    session.FirstTurn    = 0;
+    session.TurnCount    = 0;
+    session.UndoPosition = 0;
+    session.Active       = 1;
+
+    // Like a game load, a history that doesn't fit the board is dropped and the board still opens
+    if (history != nullptr && !ImportHistory(session, *history)) {
+        session.TurnCount    = 0;
+        session.UndoPosition = 0;
+    }
+
+    return MakeSessionId(shard_idx, slot, session.Generation);
+}
+
+SessionId SessionManager::LoadSession(const char* filepath) noexcept
+{
+    save::SaveRecord  record;
+    save::TurnHistory history;
+    if (save::ReadSaveRecord(filepath, record, &history) != SaveReadResult_Ok)
+        return InvalidSessionId;
+
+    return this->OpenSession(record, &history);
+}
+
+SessionResult SessionManager::CloseSession(SessionId id) noexcept
+{
+    Shard& shard = this->GetShard(id);
+    std::lock_guard shard_lock(shard.Mutex);
+    SessionRecord* record = this->FindRecord(id);
+    if (record == nullptr)
+        return SessionResult_NotFound;
+
+    record->Active = 0;
+    shard.FreeSlots.push_back(static_cast<uint32_t>((id >> ShardBits) & SlotMask));
+    --shard.ActiveCount;
+    return SessionResult_Ok;
+}
+
+SessionResult SessionManager::SetNumber(SessionId id, int row, int col, int number) noexcept
+{
+    Shard& shard = this->GetShard(id);
+    std::lock_guard shard_lock(shard.Mutex);
+    SessionRecord* record = this->FindRecord(id);
+    if (record == nullptr)
+        return SessionResult_NotFound;
+    if (!IsPuzzleTile(*record, row, col) || number < 0 || number > 9)
+        return SessionResult_InvalidMove;
+
+    const int tile_idx = (row * 9) + col;
+    const int prev_num = save::GetPackedDigit(record->Board.PuzzleDigits, tile_idx);
+    // Setting the number the tile already has is not a turn
+    if (prev_num == number)
+        return SessionResult_Ok;
+
+    const std::bitset<9> pencilmark = record->Board.Pencilmarks[tile_idx];
+    AddTurn(*record, TurnLog::TurnTile(row, col, prev_num, number, pencilmark, pencilmark));
+    UpdateTileDigit(*record, tile_idx, number);
+    return SessionResult_Ok;
+}
+
+SessionResult SessionManager::TogglePencilmark(SessionId id, int row, int col, int number) noexcept
+{
+    Shard& shard = this->GetShard(id);
+    std::lock_guard shard_lock(shard.Mutex);
+    SessionRecord* record = this->FindRecord(id);
+    if (record == nullptr)
+        return SessionResult_NotFound;
+    if (!IsPuzzleTile(*record, row, col) || number < 1 || number > 9)
+        return SessionResult_InvalidMove;
+
+    const int tile_idx = (row * 9) + col;
+    const std::bitset<9> prev_pm = record->Board.Pencilmarks[tile_idx];
+    const std::bitset<9> next_pm = prev_pm ^ std::bitset<9>(1u << (number - 1));
+    AddTurn(*record, TurnLog::TurnTile(row, col, save::GetPackedDigit(record->Board.PuzzleDigits, tile_idx), save::GetPackedDigit(record->Board.PuzzleDigits, tile_idx), prev_pm, next_pm));
+    record->Board.Pencilmarks[tile_idx] = static_cast<uint16_t>(next_pm.to_ulong());
+    return SessionResult_Ok;
+}
+
+SessionResult SessionManager::Undo(SessionId id) noexcept
+{
+    Shard& shard = this->GetShard(id);
+    std::lock_guard shard_lock(shard.Mutex);
+    SessionRecord* record = this->FindRecord(id);
+    if (record == nullptr)
+        return SessionResult_NotFound;
+    if (record->UndoPosition == 0)
+        return SessionResult_NoTurn;
+
+    // A group from a loaded game history is undone back to its first turn
+    while (record->UndoPosition > 0) {
+        const auto turn_tile = TurnLog::UnpackTurn(GetRingTurn(*record, --record->UndoPosition));
+        ApplyTurn(*record, turn_tile, true);
+        if (!turn_tile.Linked)
+            break;
+    }
+
+    return SessionResult_Ok;
+}
+
+SessionResult SessionManager::Redo(SessionId id) noexcept
+{
+    Shard& shard = this->GetShard(id);
+    std::lock_guard shard_lock(shard.Mutex);
+    SessionRecord* record = this->FindRecord(id);
+    if (record == nullptr)
+        return SessionResult_NotFound;
+    if (record->UndoPosition == record->TurnCount)
+        return SessionResult_NoTurn;
+
+    do {
+        ApplyTurn(*record, TurnLog::UnpackTurn(GetRingTurn(*record, record->UndoPosition++)), false);
+    } while (record->UndoPosition < record->TurnCount && TurnLog::UnpackTurn(GetRingTurn(*record, record->UndoPosition)).Linked);
+
+    return SessionResult_Ok;
+}
+
+SessionResult SessionManager::Validate(SessionId id, SessionState& state) const noexcept
+{
+    save::SaveRecord board;
+    {
+        const Shard& shard = this->GetShard(id);
+        std::lock_guard shard_lock(shard.Mutex);
+        const SessionRecord* record = this->FindRecord(id);
+        if (record == nullptr)
+            return SessionResult_NotFound;
+
+        board = record->Board;
+    }
+
+    // Digit counts of the rows, columns and blocks, counted on the copy so the shard is free again
+    std::array<std::array<uint8_t, 10>, 27> unit_counts = {};
+    std::array<int, 81> digits;
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        const int row = tile_idx / 9, col = tile_idx % 9, block = (row / 3) * 3 + col / 3;
+        digits[tile_idx] = save::GetPackedDigit(board.PuzzleDigits, tile_idx);
+        ++unit_counts[row][digits[tile_idx]];
+        ++unit_counts[9 + col][digits[tile_idx]];
+        ++unit_counts[18 + block][digits[tile_idx]];
+    }
+
+    state = {};
+    state.Solved = true;
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        const int row = tile_idx / 9, col = tile_idx % 9, block = (row / 3) * 3 + col / 3;
+        const int digit = digits[tile_idx];
+        const int solution_digit = save::GetPackedDigit(board.SolutionDigits, tile_idx);
+        if (save::IsBitmapSet(board.PuzzleTileBitmap, tile_idx)) {
+            ++state.PuzzleTiles;
+            state.FilledTiles += digit != 0;
+        }
+
+        state.Solved = state.Solved && solution_digit != 0 && digit == solution_digit;
+        if (digit != 0 && (unit_counts[row][digit] > 1 || unit_counts[9 + col][digit] > 1 || unit_counts[18 + block][digit] > 1))
+            ++state.ConflictTiles;
+    }
+
+    return SessionResult_Ok;
+}
+
+SessionResult SessionManager::SaveSession(SessionId id, const char* filepath) const noexcept
+{
+    save::SaveRecord  record;
+    save::TurnHistory history;
+    const SessionResult result = this->GetSaveRecord(id, record, &history);
+    if (result != SessionResult_Ok)
+        return result;
+
+    // Written without the shard lock, the other sessions of the shard don't wait on the disk
+    return save::WriteSaveRecord(filepath, record, &history) ? SessionResult_Ok : SessionResult_WriteFailed;
+}
+
+SessionResult SessionManager::GetSaveRecord(SessionId id, save::SaveRecord& record, save::TurnHistory* history) const noexcept
+{
+    {
+        const Shard& shard = this->GetShard(id);
+        std::lock_guard shard_lock(shard.Mutex);
+        const SessionRecord* session = this->FindRecord(id);
+        if (session == nullptr)
+            return SessionResult_NotFound;
+
+        record = session->Board;
+        if (history != nullptr)
+            ExportHistory(*session, *history);
+    }
+
+    save::SealRecord(record, record.Header.Difficulty);
+    return SessionResult_Ok;
+}
+
+size_t SessionManager::GetSessionCount() const noexcept
+{
+    size_t session_count = 0;
+    for (const auto& shard : Shards) {
+        std::lock_guard shard_lock(shard.Mutex);
+        session_count += shard.ActiveCount;
+    }
+
+    return session_count;
+}
+
+size_t SessionManager::GetSlabMemory() const noexcept
+{
+    size_t slab_memory = 0;
+    for (const auto& shard : Shards) {
+        std::lock_guard shard_lock(shard.Mutex);
+        slab_memory += shard.Slabs.size() * sizeof(SessionSlab) + shard.FreeSlots.capacity() * sizeof(uint32_t);
+    }
+
+    return slab_memory;
+}
+
+SessionRecord* SessionManager::FindRecord(SessionId id) noexcept
+{
+    return const_cast<SessionRecord*>(static_cast<const SessionManager*>(this)->FindRecord(id));
+}
+
+const SessionRecord* SessionManager::FindRecord(SessionId id) const noexcept
+{
+    const Shard&   shard = this->GetShard(id);
+    const uint64_t slot  = (id >> ShardBits) & SlotMask;
+    if (slot / SlabSessions >= shard.Slabs.size())
+        return nullptr;
+
+    const SessionRecord& record = (*shard.Slabs[slot / SlabSessions])[slot % SlabSessions];
+    if (!record.Active || record.Generation != static_cast<uint32_t>(id >> 32))
+        return nullptr;
+
+    return &record;
+}
+
+SessionManager::Shard& SessionManager::GetShard(SessionId id) noexcept
+{
+    return Shards[id & (ShardCount - 1)];
+}
+
+const SessionManager::Shard& SessionManager::GetShard(SessionId id) const noexcept
+{
+    return Shards[id & (ShardCount - 1)];
+}
+
+void SessionManager::AddTurn(SessionRecord& record, const TurnLog::TurnTile& turn_tile) noexcept
+{
+    // Adding a turn drops the redo tail. A full ring gives the slot of the oldest turn to the new one
+    record.TurnCount = record.UndoPosition;
+    if (record.TurnCount == SessionTurnCapacity) {
+        record.FirstTurn = static_cast<uint16_t>((record.FirstTurn + 1) % SessionTurnCapacity);
+        --record.TurnCount;
+    }
+
+    GetRingTurn(record, record.TurnCount) = TurnLog::PackTurn(turn_tile);
+    record.UndoPosition = ++record.TurnCount;
+}
+
+void SessionManager::ExportHistory(const SessionRecord& record, save::TurnHistory& history) noexcept
+{
+    history.Turns.resize(record.TurnCount);
+    for (size_t turn_idx = 0; turn_idx < record.TurnCount; ++turn_idx)
+        history.Turns[turn_idx] = GetRingTurn(record, turn_idx);
+    history.UndoPosition = record.UndoPosition;
+}
+
+bool SessionManager::ImportHistory(SessionRecord& record, const save::TurnHistory& history) noexcept
+{
+    if (history.UndoPosition > history.Turns.size())
+        return false;
+
+    // Undoing a turn on a given tile would change the puzzle itself
+    const bool valid_turns = std::all_of(history.Turns.begin(), history.Turns.end(), [&record](uint32_t packed_turn) {
+        if (!TurnLog::IsValidPackedTurn(packed_turn))
+            return false;
+
+        const auto turn_tile = TurnLog::UnpackTurn(packed_turn);
+        return IsPuzzleTile(record, turn_tile.Row, turn_tile.Column);
+    });
+    if (!valid_turns)
+        return false;
+
+    // Only the newest turns fit the ring
+    const size_t first_turn = history.Turns.size() > SessionTurnCapacity ? history.Turns.size() - SessionTurnCapacity : 0;
+    if (history.UndoPosition < first_turn)
+        return false;
+
+    for (size_t turn_idx = first_turn; turn_idx < history.Turns.size(); ++turn_idx)
+        record.Turns[turn_idx - first_turn] = history.Turns[turn_idx];
+    record.FirstTurn    = 0;
+    record.TurnCount    = static_cast<uint16_t>(history.Turns.size() - first_turn);
+    record.UndoPosition = static_cast<uint16_t>(history.UndoPosition - first_turn);
+    return true;
+}
+
+}
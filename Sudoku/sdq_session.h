@@ -0,0 +1,120 @@
+#pragma once
+
+#include "sdq.h"
+#include "sdq_save.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Headless host of many concurrent games.
+// An Instance is built for one player at a time: two GameBoards of pointer linked tiles, a heap turn log and the
+// generator state. A session only keeps what a game needs between moves, packed into one fixed size record: the save
+// record of the board and a small ring of packed turns. Records live in slabs that are never freed or moved, so a
+// session costs about 1 KB and opening one is a free list pop. The sessions are split over shards by id, and every
+// shard has its own lock, so players of different shards never wait on each other.
+
+enum SessionResult_
+{
+    SessionResult_Ok          = 0,
+    SessionResult_NotFound    = 1,    // The id is unknown or the session was closed
+    SessionResult_InvalidMove = 2,    // Out of the board, not a tile the player fills in, or not a digit
+    SessionResult_NoTurn      = 3,    // Nothing to undo or redo
+    SessionResult_WriteFailed = 4     // The save file couldn't be written
+};
+
+using SessionResult = int;
+
+namespace sdq::session
+{
+
+using SessionId = uint64_t;
+constexpr SessionId InvalidSessionId = 0;    // Generations start at 1, so no session ever gets this id
+
+constexpr size_t ShardCount          = 16;
+constexpr size_t SlabSessions        = 64;   // Records allocated at once when a shard runs out of free ones
+constexpr size_t SessionTurnCapacity = 160;  // The oldest turns are dropped past this, like TurnLog does at its cap
+
+// Everything a game needs between moves. The board is kept as a save record, so saving is a copy and a seal
+struct SessionRecord
+{
+    save::SaveRecord Board;
+    uint32_t         Generation;      // Bumped every time the record is reused, so the ids of closed sessions go stale
+    uint16_t         FirstTurn;       // Ring position of the oldest turn
+    uint16_t         TurnCount;
+    uint16_t         UndoPosition;
+    uint8_t          Active;
+    uint8_t          Reserved;
+    std::array<uint16_t, 27> UnitNumbers;    // Numbers in each row, column and block, bit N - 1 for number N
+    std::array<uint32_t, SessionTurnCapacity> Turns;    // Packed like the turns of TurnLog
+};
+
+static_assert(sizeof(SessionRecord) <= 1024, "SessionRecord grew past 1 KB per game!");
+
+struct SessionState
+{
+    int  FilledTiles;      // Puzzle tiles that have a number
+    int  PuzzleTiles;      // Tiles the player fills in
+    int  ConflictTiles;    // Tiles whose number is also in one of their units
+    bool Solved;           // Every puzzle tile matches the solution
+};
+
+// Thread safe. Calls on sessions of different shards run in parallel
+class SessionManager
+{
+private:
+    using SessionSlab = std::array<SessionRecord, SlabSessions>;
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex                        Mutex;
+        std::vector<std::unique_ptr<SessionSlab>> Slabs;
+        std::vector<uint32_t>                     FreeSlots;     // Closed records, reused before a new slab is made
+        size_t                                    ActiveCount = 0;
+    };
+
+    std::array<Shard, ShardCount> Shards;
+    std::atomic<size_t>           NextShard;     // Round robin over the shards for new sessions
+
+public:
+    SessionManager() noexcept;
+
+    SessionManager(const SessionManager&) = delete;
+    SessionManager& operator = (const SessionManager&) = delete;
+
+    // Generates the puzzle on the calling thread, outside of any shard lock. InvalidSessionId if generation failed
+    SessionId CreateSession(SudokuDifficulty difficulty, uint64_t seed) noexcept;
+    // Opens a game from a save record, with its undo history if there is one. InvalidSessionId if the record is damaged
+    SessionId OpenSession(const save::SaveRecord& record, const save::TurnHistory* history = nullptr) noexcept;
+    SessionId LoadSession(const char* filepath) noexcept;
+    SessionResult CloseSession(SessionId id) noexcept;
+
+    // The moves log a turn like the matching Instance calls. Number 0 clears the tile
+    SessionResult SetNumber(SessionId id, int row, int col, int number) noexcept;
+    SessionResult TogglePencilmark(SessionId id, int row, int col, int number) noexcept;
+    SessionResult Undo(SessionId id) noexcept;
+    SessionResult Redo(SessionId id) noexcept;
+
+    SessionResult Validate(SessionId id, SessionState& state) const noexcept;
+    // Writes the same file as Instance::SaveCurrentProgress, so a session can be continued in the game and the other way around
+    SessionResult SaveSession(SessionId id, const char* filepath) const noexcept;
+    SessionResult GetSaveRecord(SessionId id, save::SaveRecord& record, save::TurnHistory* history = nullptr) const noexcept;
+
+    size_t GetSessionCount() const noexcept;
+    // Bytes held by the slabs of every shard, used or free
+    size_t GetSlabMemory() const noexcept;
+
+private:
+    SessionRecord*       FindRecord(SessionId id) noexcept;
+    const SessionRecord* FindRecord(SessionId id) const noexcept;
+    Shard&               GetShard(SessionId id) noexcept;
+    const Shard&         GetShard(SessionId id) const noexcept;
+
+    static void          AddTurn(SessionRecord& record, const TurnLog::TurnTile& turn_tile) noexcept;
+    static void          ExportHistory(const SessionRecord& record, save::TurnHistory& history) noexcept;
+    static bool          ImportHistory(SessionRecord& record, const save::TurnHistory& history) noexcept;
+};
+
+}
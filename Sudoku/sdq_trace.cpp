@@ -0,0 +1,185 @@
+#include "sdq_trace.h"
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <cstdio>
+#include <fstream>
+
+namespace sdq::trace
+{
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// ThreadTraceBuffer CLASS
+//--------------------------------------------------------------------------------------------------------------------------------
+
+ThreadTraceBuffer::ThreadTraceBuffer() noexcept :
+    WriteIndex(0),
+    ClearIndex(0),
+    InUse(false)
+{
+    for (auto& event : Events) {
+        event.Name.store(nullptr, std::memory_order_relaxed);
+        event.StartNs.store(0, std::memory_order_relaxed);
+        event.DurationNs.store(0, std::memory_order_relaxed);
+        event.ThreadID.store(0, std::memory_order_relaxed);
+    }
+}
+
+void ThreadTraceBuffer::Push(const char* name, int64_t start_ns, int64_t duration_ns, uint32_t thread_id) noexcept
+{
+    const uint64_t index = WriteIndex.load(std::memory_order_relaxed);
+    auto& event = Events[index & (Capacity - 1)];
+    // Pairs with the fence in ForEachEvent. A reader that sees any of the new fields also sees the index that laps its slot
+    std::atomic_thread_fence(std::memory_order_release);
+    event.Name.store(name, std::memory_order_relaxed);
+    event.StartNs.store(start_ns, std::memory_order_relaxed);
+    event.DurationNs.store(duration_ns, std::memory_order_relaxed);
+    event.ThreadID.store(thread_id, std::memory_order_relaxed);
+    WriteIndex.store(index + 1, std::memory_order_release);
+}
+
+bool ThreadTraceBuffer::TryAcquire() noexcept
+{
+    bool expected = false;
+    return InUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel);
+}
+
+void ThreadTraceBuffer::Release() noexcept
+{
+    InUse.store(false, std::memory_order_release);
+}
+
+void ThreadTraceBuffer::Clear() noexcept
+{
+    // Resetting WriteIndex would race with the owner's Push, so the cleared events are skipped instead
+    const uint64_t end_index = WriteIndex.load(std::memory_order_acquire);
+    uint64_t clear_index = ClearIndex.load(std::memory_order_relaxed);
+    while (clear_index < end_index && !ClearIndex.compare_exchange_weak(clear_index, end_index, std::memory_order_acq_rel)) {}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// Buffer Registry
+//--------------------------------------------------------------------------------------------------------------------------------
+
+namespace
+{
+
+// Buffers are never freed. A thread that exits hands its buffer back so the next thread can reuse it,
+// which also keeps the spans of short lived generation threads around until they are dumped
+constexpr size_t MaxThreadBuffers = 64;
+
+std::array<std::atomic<ThreadTraceBuffer*>, MaxThreadBuffers> ThreadBuffers = {};
+std::atomic<size_t>   ThreadBufferCount = 0;
+std::atomic<uint32_t> NextThreadID      = 1;
+std::atomic<bool>     TraceEnabled      = true;
+
+const std::chrono::steady_clock::time_point TraceEpoch = std::chrono::steady_clock::now();
+
+ThreadTraceBuffer* AcquireBuffer() noexcept
+{
+    const size_t buffer_count = std::min(ThreadBufferCount.load(std::memory_order_acquire), MaxThreadBuffers);
+    for (size_t idx = 0; idx < buffer_count; ++idx) {
+        auto* buffer = ThreadBuffers[idx].load(std::memory_order_acquire);
+        if (buffer != nullptr && buffer->TryAcquire())
+            return buffer;
+    }
+
+    const size_t new_idx = ThreadBufferCount.fetch_add(1, std::memory_order_acq_rel);
+    if (new_idx >= MaxThreadBuffers)
+        return nullptr;
+
+    auto* buffer = new (std::nothrow) ThreadTraceBuffer();
+    if (buffer == nullptr)
+        return nullptr;
+
+    buffer->TryAcquire();
+    ThreadBuffers[new_idx].store(buffer, std::memory_order_release);
+    return buffer;
+}
+
+struct ThreadTraceState
+{
+    ThreadTraceBuffer* Buffer;
+    uint32_t           ThreadID;
+
+    ThreadTraceState() noexcept : Buffer(AcquireBuffer()), ThreadID(NextThreadID.fetch_add(1, std::memory_order_relaxed)) {}
+    ~ThreadTraceState() noexcept
+    {
+        if (Buffer != nullptr)
+            Buffer->Release();
+    }
+};
+
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+// Trace Functions
+//--------------------------------------------------------------------------------------------------------------------------------
+
+int64_t NowNs() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - TraceEpoch).count();
+}
+
+void SetEnabled(bool enabled) noexcept
+{
+    TraceEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool IsEnabled() noexcept
+{
+    return TraceEnabled.load(std::memory_order_relaxed);
+}
+
+void RecordSpan(const char* name, int64_t start_ns, int64_t duration_ns) noexcept
+{
+    thread_local ThreadTraceState thread_state;
+    if (thread_state.Buffer == nullptr)
+        return;
+
+    thread_state.Buffer->Push(name, start_ns, duration_ns, thread_state.ThreadID);
+}
+
+bool DumpChromeTrace(const char* filepath) noexcept
+{
+    std::ofstream ofile(filepath, std::ios::out | std::ios::trunc);
+    if (!ofile.good())
+        return false;
+
+    ofile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first_event = true;
+    char event_text[256];
+    const size_t buffer_count = std::min(ThreadBufferCount.load(std::memory_order_acquire), MaxThreadBuffers);
+    for (size_t idx = 0; idx < buffer_count; ++idx) {
+        const auto* buffer = ThreadBuffers[idx].load(std::memory_order_acquire);
+        if (buffer == nullptr)
+            continue;
+
+        buffer->ForEachEvent([&](const char* name, int64_t start_ns, int64_t duration_ns, uint32_t thread_id) {
+            if (name == nullptr)
+                return;
+
+            // Chrome expects microseconds
+            const int written = std::snprintf(event_text, sizeof(event_text),
+                                              "%s\n{\"name\":\"%s\",\"cat\":\"sdq\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                                              first_event ? "" : ",", name, start_ns / 1000.0, duration_ns / 1000.0, thread_id);
+            if (written > 0) {
+                ofile.write(event_text, std::min<size_t>(written, sizeof(event_text) - 1));
+                first_event = false;
+            }
+        });
+    }
+    ofile << "\n]}\n";
+
+    return ofile.good();
+}
+
+void ClearAll() noexcept
+{
+    const size_t buffer_count = std::min(ThreadBufferCount.load(std::memory_order_acquire), MaxThreadBuffers);
+    for (size_t idx = 0; idx < buffer_count; ++idx)
+        if (auto* buffer = ThreadBuffers[idx].load(std::memory_order_acquire))
+            buffer->Clear();
+}
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Scoped timing spans for the puzzle generation pipeline.
+// Every thread records into its own fixed ring buffer, so recording never locks and never allocates after the
+// first span of a thread. The buffers can be dumped at any time as Chrome trace-event JSON (chrome://tracing or Perfetto).
+// Define SDQ_DISABLE_TRACE to compile the spans out completely.
+
+namespace sdq::trace
+{
+
+struct TraceEvent
+{
+    std::atomic<const char*> Name;
+    std::atomic<int64_t>     StartNs;
+    std::atomic<int64_t>     DurationNs;
+    std::atomic<uint32_t>    ThreadID;
+};
+
+class ThreadTraceBuffer
+{
+public:
+    static constexpr size_t Capacity = 1 << 14; // Must be a power of two
+
+private:
+    std::array<TraceEvent, Capacity> Events;
+    std::atomic<uint64_t>            WriteIndex;    // Only ever grows, so a reader can tell which slots were overwritten
+    std::atomic<uint64_t>            ClearIndex;    // Events before it were cleared
+    std::atomic<bool>                InUse;
+
+public:
+    ThreadTraceBuffer() noexcept;
+
+    // Only called by the thread that owns the buffer
+    void Push(const char* name, int64_t start_ns, int64_t duration_ns, uint32_t thread_id) noexcept;
+    bool TryAcquire() noexcept;
+    void Release() noexcept;
+
+    // Copies the events that are still alive in the ring. Safe to call from any thread
+    template<typename Func>
+    void ForEachEvent(Func&& func) const noexcept
+    {
+        const uint64_t end_index   = WriteIndex.load(std::memory_order_acquire);
+        const uint64_t begin_index = std::max(end_index > Capacity ? end_index - Capacity : 0, ClearIndex.load(std::memory_order_acquire));
+        for (uint64_t idx = begin_index; idx < end_index; ++idx) {
+            const auto& event   = Events[idx & (Capacity - 1)];
+            const char* name    = event.Name.load(std::memory_order_relaxed);
+            const int64_t start = event.StartNs.load(std::memory_order_relaxed);
+            const int64_t dur   = event.DurationNs.load(std::memory_order_relaxed);
+            const uint32_t tid  = event.ThreadID.load(std::memory_order_relaxed);
+
+            // The owner may have lapped us while reading. The slot is rewritten by the push of idx + Capacity, which
+            // only publishes its index once it is done, so the slot is already unsafe when that index is the end
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (idx + Capacity <= WriteIndex.load(std::memory_order_relaxed))
+                continue;
+
+            func(name, start, dur, tid);
+        }
+    }
+
+    // Safe to call from any thread, also while the owner pushes
+    void Clear() noexcept;
+};
+
+// Nanoseconds since the first trace call of the process
+int64_t NowNs() noexcept;
+// Globally turns span recording on or off. Recording is on by default
+void SetEnabled(bool enabled) noexcept;
+bool IsEnabled() noexcept;
+// Records a finished span into the calling thread's buffer
+void RecordSpan(const char* name, int64_t start_ns, int64_t duration_ns) noexcept;
+// Writes every recorded span of every thread as Chrome trace-event JSON
+bool DumpChromeTrace(const char* filepath) noexcept;
+// Drops every recorded span
+void ClearAll() noexcept;
+
+class ScopedSpan
+{
+private:
+    const char* Name;
+    int64_t     StartNs;
+
+public:
+    explicit ScopedSpan(const char* name) noexcept : Name(name), StartNs(IsEnabled() ? NowNs() : -1) {}
+    ~ScopedSpan() noexcept
+    {
+        if (StartNs >= 0)
+            RecordSpan(Name, StartNs, NowNs() - StartNs);
+    }
+
+    ScopedSpan(const ScopedSpan&) = delete;
+    ScopedSpan& operator = (const ScopedSpan&) = delete;
+};
+
+}
+
+#define SDQ_TRACE_CONCAT_INNER(a, b) a##b
+#define SDQ_TRACE_CONCAT(a, b) SDQ_TRACE_CONCAT_INNER(a, b)
+
+#ifndef SDQ_DISABLE_TRACE
+#define SDQ_TRACE_SCOPE(name) ::sdq::trace::ScopedSpan SDQ_TRACE_CONCAT(sdq_trace_span_, __LINE__)(name)
+#else
+#define SDQ_TRACE_SCOPE(name) ((void)0)
+#endif
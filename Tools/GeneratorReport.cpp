@@ -0,0 +1,235 @@
+// Acceptance rate and latency report of the puzzle generator.
+// Runs seeded generations for every difficulty and reports how many complete boards each accepted puzzle took, how
+// many clues were removed against MaxRemovedTiles, the IsUniqueBoard calls, the grader scores of every attempt and the
+// wall time percentiles of CreateSudoku. The seeds are fixed, so two runs of the same build generate the same puzzles
+// and only the times change, which is what makes the report usable to judge a generator change.
+//
+// Build it with the sdq sources only, e.g.
+//     g++ -std=c++20 -O2 -fpermissive -ISudoku -ILibraries/include Tools/GeneratorReport.cpp Sudoku/*.cpp -lboost_serialization -lpthread
+// Usage: GeneratorReport [generations per difficulty] [first seed] [report path without extension] [workers]
+// Writes <report path>.csv with one row per generation and <report path>.json with the summary of every difficulty.
+// With workers the generator tests clue removals speculatively on a job system of that size. The puzzles are the same,
+// only the times and the speculative checks change.
+
+#include "sdq.h"
+#include "sdq_jobs.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr int      DefaultGenerations = 50;
+constexpr uint64_t DefaultFirstSeed   = 1;
+constexpr uint32_t ScoreBinSize       = 2000;    // Width of a grader score histogram bin
+constexpr size_t   ScoreBinCount      = 16;      // The last bin also counts every score past it
+
+constexpr std::array<SudokuDifficulty, 5> ReportDifficulties = { SudokuDifficulty_Easy, SudokuDifficulty_Normal, SudokuDifficulty_Insane,
+                                                                 SudokuDifficulty_Diabolical, SudokuDifficulty_Random };
+constexpr std::array<const char*, 5>      DifficultyNames    = { "Random", "Easy", "Normal", "Insane", "Diabolical" };
+
+using ScoreHistogram = std::array<uint64_t, ScoreBinCount>;
+
+struct GenerationSample
+{
+    uint64_t             Seed;
+    bool                 Success;
+    double               WallMs;
+    sdq::GenerationStats Stats;
+};
+
+struct DifficultySummary
+{
+    SudokuDifficulty Difficulty;
+    size_t           Generations;
+    size_t           Failures;
+    uint64_t         TotalAttempts;
+    double           MeanAttempts;
+    uint32_t         MaxAttempts;
+    double           MeanRemovedTiles;
+    double           MeanMaxRemovedTiles;    // Varies per seed for the random difficulty
+    double           MeanUniquenessChecks;
+    double           MeanSpeculativeChecks;
+    double           WallMsMean;
+    double           WallMsP50;
+    double           WallMsP90;
+    double           WallMsP99;
+    double           WallMsMax;
+    ScoreHistogram   AcceptedScores;
+    ScoreHistogram   RejectedScores;
+};
+
+double Percentile(const std::vector<double>& sorted_values, double percentile)
+{
+    if (sorted_values.empty())
+        return 0.0;
+
+    const size_t idx = static_cast<size_t>(percentile * static_cast<double>(sorted_values.size() - 1) + 0.5);
+    return sorted_values[std::min(idx, sorted_values.size() - 1)];
+}
+
+void AddScore(ScoreHistogram& histogram, uint32_t score)
+{
+    ++histogram[std::min<size_t>(score / ScoreBinSize, ScoreBinCount - 1)];
+}
+
+DifficultySummary Summarize(SudokuDifficulty difficulty, const std::vector<GenerationSample>& samples)
+{
+    DifficultySummary summary = {};
+    summary.Difficulty  = difficulty;
+    summary.Generations = samples.size();
+
+    std::vector<double> wall_ms;
+    uint64_t removed_tiles = 0, max_removed_tiles = 0, uniqueness_checks = 0, speculative_checks = 0;
+    for (const auto& sample : samples) {
+        if (!sample.Success) {
+            ++summary.Failures;
+            continue;
+        }
+
+        wall_ms.push_back(sample.WallMs);
+        summary.TotalAttempts += sample.Stats.Attempts;
+        summary.MaxAttempts    = std::max(summary.MaxAttempts, sample.Stats.Attempts);
+        removed_tiles         += sample.Stats.RemovedTiles;
+        uniqueness_checks     += sample.Stats.UniquenessChecks;
+        speculative_checks    += sample.Stats.SpeculativeChecks;
+        max_removed_tiles     += sample.Stats.MaxRemovedTiles;
+        for (size_t idx = 0; idx < sample.Stats.GraderScores.size(); ++idx)
+            AddScore(idx + 1 == sample.Stats.GraderScores.size() ? summary.AcceptedScores : summary.RejectedScores, sample.Stats.GraderScores[idx]);
+    }
+
+    if (wall_ms.empty())
+        return summary;
+
+    const double accepted = static_cast<double>(wall_ms.size());
+    summary.MeanAttempts         = static_cast<double>(summary.TotalAttempts) / accepted;
+    summary.MeanRemovedTiles     = static_cast<double>(removed_tiles) / accepted;
+    summary.MeanMaxRemovedTiles  = static_cast<double>(max_removed_tiles) / accepted;
+    summary.MeanUniquenessChecks  = static_cast<double>(uniqueness_checks) / accepted;
+    summary.MeanSpeculativeChecks = static_cast<double>(speculative_checks) / accepted;
+
+    std::sort(wall_ms.begin(), wall_ms.end());
+    for (const double ms : wall_ms)
+        summary.WallMsMean += ms / accepted;
+    summary.WallMsP50 = Percentile(wall_ms, 0.50);
+    summary.WallMsP90 = Percentile(wall_ms, 0.90);
+    summary.WallMsP99 = Percentile(wall_ms, 0.99);
+    summary.WallMsMax = wall_ms.back();
+    return summary;
+}
+
+bool WriteCsv(const std::string& filepath, const std::vector<std::pair<SudokuDifficulty, std::vector<GenerationSample>>>& runs)
+{
+    FILE* file = std::fopen(filepath.c_str(), "w");
+    if (file == nullptr)
+        return false;
+
+    std::fprintf(file, "difficulty,seed,success,wall_ms,attempts,uniqueness_checks,speculative_checks,removed_tiles,max_removed_tiles,accepted_score,rejected_scores\n");
+    for (const auto& [difficulty, samples] : runs) {
+        for (const auto& sample : samples) {
+            const auto& scores = sample.Stats.GraderScores;
+            std::fprintf(file, "%s,%" PRIu64 ",%d,%.3f,%u,%u,%u,%u,%u,%u,", DifficultyNames[difficulty], sample.Seed, sample.Success ? 1 : 0, sample.WallMs,
+                         sample.Stats.Attempts, sample.Stats.UniquenessChecks, sample.Stats.SpeculativeChecks, sample.Stats.RemovedTiles, sample.Stats.MaxRemovedTiles,
+                         scores.empty() ? 0u : scores.back());
+            // Rejected scores are one field, separated by spaces
+            for (size_t idx = 0; idx + 1 < scores.size(); ++idx)
+                std::fprintf(file, idx == 0 ? "%u" : " %u", scores[idx]);
+            std::fprintf(file, "\n");
+        }
+    }
+
+    return std::fclose(file) == 0;
+}
+
+void WriteHistogram(FILE* file, const char* name, const ScoreHistogram& histogram)
+{
+    std::fprintf(file, "      \"%s\": [", name);
+    for (size_t idx = 0; idx < histogram.size(); ++idx)
+        std::fprintf(file, idx == 0 ? "%" PRIu64 : ", %" PRIu64, histogram[idx]);
+    std::fprintf(file, "]");
+}
+
+bool WriteJson(const std::string& filepath, int generations, uint64_t first_seed, size_t workers, const std::vector<DifficultySummary>& summaries)
+{
+    FILE* file = std::fopen(filepath.c_str(), "w");
+    if (file == nullptr)
+        return false;
+
+    std::fprintf(file, "{\n  \"generations_per_difficulty\": %d,\n  \"first_seed\": %" PRIu64 ",\n  \"workers\": %zu,\n", generations, first_seed, workers);
+    std::fprintf(file, "  \"score_bin_size\": %u,\n  \"difficulties\": [\n", ScoreBinSize);
+    for (size_t idx = 0; idx < summaries.size(); ++idx) {
+        const auto& summary = summaries[idx];
+        const double acceptance_rate = summary.TotalAttempts > 0 ? static_cast<double>(summary.Generations - summary.Failures) / static_cast<double>(summary.TotalAttempts) : 0.0;
+        std::fprintf(file, "    {\n      \"difficulty\": \"%s\",\n      \"generations\": %zu,\n      \"failures\": %zu,\n", DifficultyNames[summary.Difficulty], summary.Generations, summary.Failures);
+        std::fprintf(file, "      \"acceptance_rate\": %.4f,\n      \"attempts_mean\": %.3f,\n      \"attempts_max\": %u,\n", acceptance_rate, summary.MeanAttempts, summary.MaxAttempts);
+        std::fprintf(file, "      \"removed_tiles_mean\": %.3f,\n      \"max_removed_tiles_mean\": %.3f,\n", summary.MeanRemovedTiles, summary.MeanMaxRemovedTiles);
+        std::fprintf(file, "      \"uniqueness_checks_mean\": %.3f,\n      \"speculative_checks_mean\": %.3f,\n", summary.MeanUniquenessChecks, summary.MeanSpeculativeChecks);
+        std::fprintf(file, "      \"wall_ms\": { \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n",
+                     summary.WallMsMean, summary.WallMsP50, summary.WallMsP90, summary.WallMsP99, summary.WallMsMax);
+        WriteHistogram(file, "accepted_scores", summary.AcceptedScores);
+        std::fprintf(file, ",\n");
+        WriteHistogram(file, "rejected_scores", summary.RejectedScores);
+        std::fprintf(file, "\n    }%s\n", idx + 1 < summaries.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+
+    return std::fclose(file) == 0;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const int         generations = argc > 1 ? std::max(1, std::atoi(argv[1])) : DefaultGenerations;
+    const uint64_t    first_seed  = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : DefaultFirstSeed;
+    const std::string report_path = argc > 3 ? argv[3] : "generator report";
+    const size_t      workers     = argc > 4 ? static_cast<size_t>(std::max(0, std::atoi(argv[4]))) : 0;
+
+    std::unique_ptr<sdq::jobs::JobSystem> job_system;
+    if (workers > 0)
+        job_system = std::make_unique<sdq::jobs::JobSystem>(workers);
+
+    std::vector<std::pair<SudokuDifficulty, std::vector<GenerationSample>>> runs;
+    std::vector<DifficultySummary> summaries;
+    std::printf("%-11s %6s %9s %9s %8s %9s %9s %9s %9s %9s\n", "difficulty", "gens", "accept %", "attempts", "removed", "unique", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    for (const SudokuDifficulty difficulty : ReportDifficulties) {
+        std::vector<GenerationSample> samples;
+        samples.reserve(generations);
+        for (int idx = 0; idx < generations; ++idx) {
+            GenerationSample sample = {};
+            sample.Seed = first_seed + static_cast<uint64_t>(idx);
+
+            sdq::Instance instance;
+            instance.SetJobSystem(job_system.get());
+            const auto start = std::chrono::steady_clock::now();
+            sample.Success = instance.CreateSudoku(difficulty, sample.Seed);
+            sample.WallMs  = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            sample.Stats   = instance.GetGenerationStats();
+            samples.push_back(std::move(sample));
+        }
+
+        const auto summary = Summarize(difficulty, samples);
+        std::printf("%-11s %6zu %9.2f %9.2f %8.2f %9.1f %9.2f %9.2f %9.2f %9.2f\n", DifficultyNames[difficulty], summary.Generations,
+                    summary.MeanAttempts > 0.0 ? 100.0 / summary.MeanAttempts : 0.0, summary.MeanAttempts, summary.MeanRemovedTiles,
+                    summary.MeanUniquenessChecks, summary.WallMsP50, summary.WallMsP90, summary.WallMsP99, summary.WallMsMax);
+        summaries.push_back(summary);
+        runs.emplace_back(difficulty, std::move(samples));
+    }
+
+    const bool csv_written  = WriteCsv(report_path + ".csv", runs);
+    const bool json_written = WriteJson(report_path + ".json", generations, first_seed, workers, summaries);
+    if (!csv_written || !json_written) {
+        std::printf("FAILED: couldn't write the report to %s.csv/.json\n", report_path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::printf("Report written to %s.csv and %s.json\n", report_path.c_str(), report_path.c_str());
+    return EXIT_SUCCESS;
+}
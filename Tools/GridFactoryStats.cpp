@@ -0,0 +1,250 @@
+// Speed and bias report of the grid factory.
+// Times the factory against the backtracking filler it replaces, then draws seeded grids from it and runs chi-square
+// tests that would catch a broken transform or an unfair pool:
+//   - every grid is valid and no grid comes out twice
+//   - every tile holds every digit equally often
+//   - the digit of the top left tile is equally likely on every column of row 2 and every row of column 2 it can be on
+//   - the aligned minirows, a count that no transform changes and so only depends on the base grid, are spread like
+//     the ones of grids straight from the filler. The factory side is weighted as a sample of its pool size
+// A test fails below a p-value of 0.001, split over the tiles for the per tile test.
+//
+// Build it with the sdq sources only, e.g.
+//     g++ -std=c++20 -O2 -fpermissive -ISudoku -ILibraries/include Tools/GridFactoryStats.cpp Sudoku/*.cpp -lboost_serialization -lpthread
+// Usage: GridFactoryStats [grids] [filler grids] [seed] [pool size]
+
+#include "sdq_grids.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+constexpr int      DefaultGrids       = 1000000;
+constexpr int      DefaultFillerGrids = 20000;
+constexpr uint64_t DefaultSeed        = 1;
+constexpr double   FailPValue         = 0.001;
+constexpr int      MinirowBins        = 19;       // 0 to 18 aligned box pairs
+
+struct TestResult
+{
+    double ChiSquare;
+    int    Freedom;
+    double PValue;
+};
+
+// Upper tail of the chi-square distribution with the Wilson-Hilferty approximation, close enough for a pass/fail test
+double ChiSquarePValue(double chi_square, int freedom)
+{
+    if (freedom <= 0)
+        return 1.0;
+
+    const double k = static_cast<double>(freedom);
+    const double z = (std::cbrt(chi_square / k) - (1.0 - 2.0 / (9.0 * k))) / std::sqrt(2.0 / (9.0 * k));
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+TestResult UniformTest(const uint64_t* counts, int bins)
+{
+    uint64_t total = 0;
+    for (int bin = 0; bin < bins; ++bin)
+        total += counts[bin];
+
+    const double expected   = static_cast<double>(total) / bins;
+    double       chi_square = 0.0;
+    for (int bin = 0; bin < bins; ++bin)
+        chi_square += (static_cast<double>(counts[bin]) - expected) * (static_cast<double>(counts[bin]) - expected) / expected;
+
+    return { chi_square, bins - 1, ChiSquarePValue(chi_square, bins - 1) };
+}
+
+// Two sample test of the same distribution. Bins are merged from the top until both samples expect at least 5 in each
+TestResult HomogeneityTest(std::array<double, MinirowBins> first, double first_size, std::array<double, MinirowBins> second, double second_size)
+{
+    const double first_total  = std::max(1.0, [&] { double sum = 0.0; for (double count : first) sum += count; return sum; }());
+    const double second_total = std::max(1.0, [&] { double sum = 0.0; for (double count : second) sum += count; return sum; }());
+    for (auto& count : first)
+        count *= first_size / first_total;
+    for (auto& count : second)
+        count *= second_size / second_total;
+
+    int bins = MinirowBins;
+    while (bins > 1) {
+        const double pooled = (first[bins - 1] + second[bins - 1]) / (first_size + second_size);
+        if (pooled * std::min(first_size, second_size) >= 5.0)
+            break;
+        first[bins - 2] += first[bins - 1];
+        second[bins - 2] += second[bins - 1];
+        --bins;
+    }
+
+    const double first_weight  = std::sqrt(second_size / first_size);
+    const double second_weight = std::sqrt(first_size / second_size);
+    double chi_square = 0.0;
+    for (int bin = 0; bin < bins; ++bin) {
+        if (first[bin] + second[bin] > 0.0) {
+            const double diff = first_weight * first[bin] - second_weight * second[bin];
+            chi_square += diff * diff / (first[bin] + second[bin]);
+        }
+    }
+
+    return { chi_square, bins - 1, ChiSquarePValue(chi_square, bins - 1) };
+}
+
+uint16_t MinirowSet(const sdq::grids::Grid& grid, int line, int block, bool columns)
+{
+    uint16_t digits = 0;
+    for (int idx = 0; idx < 3; ++idx)
+        digits |= static_cast<uint16_t>(1u << (columns ? grid[(block * 3 + idx) * 9 + line] : grid[line * 9 + block * 3 + idx]));
+    return digits;
+}
+
+// Box pairs of the same band or stack whose minirows hold the same three digit sets. Unchanged by every transform
+int CountAlignedMinirows(const sdq::grids::Grid& grid)
+{
+    int aligned = 0;
+    for (const bool columns : { false, true }) {
+        for (int band = 0; band < 3; ++band) {
+            std::array<std::array<uint16_t, 3>, 3> box_sets;
+            for (int box = 0; box < 3; ++box) {
+                for (int idx = 0; idx < 3; ++idx)
+                    box_sets[box][idx] = MinirowSet(grid, band * 3 + idx, box, columns);
+                std::sort(box_sets[box].begin(), box_sets[box].end());
+            }
+
+            aligned += (box_sets[0] == box_sets[1]) + (box_sets[0] == box_sets[2]) + (box_sets[1] == box_sets[2]);
+        }
+    }
+
+    return aligned;
+}
+
+uint64_t GridKey(const sdq::grids::Grid& grid)
+{
+    return (static_cast<uint64_t>(sdq::save::Checksum(grid.data(), grid.size())) << 32) | sdq::save::Checksum(grid.data(), grid.size(), 0x9E3779B9u);
+}
+
+bool PrintResult(const char* name, const TestResult& result, double fail_p_value)
+{
+    if (result.Freedom == 0) {
+        std::printf("%-34s %12s %6d %10s  skipped, too few grids to compare\n", name, "", 0, "");
+        return true;
+    }
+
+    const bool passed = result.PValue >= fail_p_value;
+    std::printf("%-34s %12.2f %6d %10.4f  %s\n", name, result.ChiSquare, result.Freedom, result.PValue, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const int      grid_count   = argc > 1 ? std::max(1000, std::atoi(argv[1])) : DefaultGrids;
+    const int      filler_count = argc > 2 ? std::max(100, std::atoi(argv[2])) : DefaultFillerGrids;
+    const uint64_t seed         = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : DefaultSeed;
+    const size_t   pool_size    = argc > 4 ? std::max(1, std::atoi(argv[4])) : sdq::grids::GridFactory::DefaultPoolSize;
+
+    const auto pool_start = std::chrono::steady_clock::now();
+    const sdq::grids::GridFactory factory(pool_size);
+    factory.FillPool();
+    const double pool_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pool_start).count();
+
+    // Grids straight from the filler, for its speed and as the reference of the aligned minirows
+    sdq::Xoshiro256 filler_rng(seed);
+    sdq::GameBoard  board;
+    sdq::grids::Grid grid;
+    std::array<double, MinirowBins> filler_minirows = {};
+    const auto filler_start = std::chrono::steady_clock::now();
+    for (int idx = 0; idx < filler_count; ++idx) {
+        sdq::grids::FillRandomBoard(board, filler_rng);
+        sdq::grids::BoardToGrid(board, grid);
+        filler_minirows[CountAlignedMinirows(grid)] += 1.0;
+    }
+    const double filler_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - filler_start).count() / filler_count;
+
+    // Timed alone, without the counting of the tests. The board is what the generator fills, so it is timed too
+    sdq::Xoshiro256 factory_rng(seed);
+    uint64_t checksum = 0;
+    const auto factory_start = std::chrono::steady_clock::now();
+    for (int idx = 0; idx < grid_count; ++idx) {
+        factory.CreateGrid(factory_rng, grid);
+        checksum += grid[idx % 81];
+    }
+    const double factory_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - factory_start).count() / grid_count;
+
+    const auto board_start = std::chrono::steady_clock::now();
+    for (int idx = 0; idx < filler_count; ++idx) {
+        factory.CreateGrid(factory_rng, grid);
+        sdq::grids::GridToBoard(grid, board);
+    }
+    const double board_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - board_start).count() / filler_count;
+
+    std::printf("pool of %zu base grids built in %.2f ms\n", factory.GetPoolSize(), pool_ms);
+    std::printf("filler  %10.1f ns per grid\n", filler_ns);
+    std::printf("factory %10.1f ns per grid, %.1f ns with the board it fills (%.0fx faster than the filler)   [%llu]\n", factory_ns, board_ns,
+                filler_ns / board_ns, static_cast<unsigned long long>(checksum));
+
+    factory_rng.Seed(seed);
+    std::vector<std::array<uint64_t, 9>> tile_digits(81, std::array<uint64_t, 9>{});
+    std::array<uint64_t, 6> row_positions    = {};
+    std::array<uint64_t, 6> column_positions = {};
+    std::array<double, MinirowBins> factory_minirows = {};
+    std::vector<uint64_t> keys;
+    keys.reserve(grid_count);
+    int invalid_grids = 0;
+    for (int idx = 0; idx < grid_count; ++idx) {
+        factory.CreateGrid(factory_rng, grid);
+        if (!sdq::grids::IsValidGrid(grid)) {
+            ++invalid_grids;
+            continue;
+        }
+
+        for (int tile = 0; tile < 81; ++tile)
+            ++tile_digits[tile][grid[tile] - 1];
+
+        // Row 2 can only have it past the first cell, and column 2 past the first band
+        for (int pos = 3; pos < 9; ++pos) {
+            row_positions[pos - 3]    += grid[9 + pos] == grid[0];
+            column_positions[pos - 3] += grid[pos * 9 + 1] == grid[0];
+        }
+
+        factory_minirows[CountAlignedMinirows(grid)] += 1.0;
+        keys.push_back(GridKey(grid));
+    }
+
+    std::sort(keys.begin(), keys.end());
+    const size_t duplicates = keys.size() - static_cast<size_t>(std::unique(keys.begin(), keys.end()) - keys.begin());
+
+    double worst_tile_p = 1.0;
+    double tile_chi_square = 0.0;
+    for (const auto& digits : tile_digits) {
+        const auto result = UniformTest(digits.data(), 9);
+        if (result.PValue < worst_tile_p) {
+            worst_tile_p    = result.PValue;
+            tile_chi_square = result.ChiSquare;
+        }
+    }
+
+    std::printf("\n%d grids, seed %llu: %d invalid, %zu duplicates\n\n", grid_count, static_cast<unsigned long long>(seed), invalid_grids, duplicates);
+    std::printf("%-34s %12s %6s %10s\n", "test", "chi-square", "dof", "p-value");
+    bool passed = invalid_grids == 0 && duplicates == 0;
+    passed &= PrintResult("digits of the worst tile", { tile_chi_square, 8, worst_tile_p }, FailPValue / 81.0);
+    passed &= PrintResult("top left digit on row 2", UniformTest(row_positions.data(), 6), FailPValue);
+    passed &= PrintResult("top left digit on column 2", UniformTest(column_positions.data(), 6), FailPValue);
+    passed &= PrintResult("aligned minirows against filler", HomogeneityTest(factory_minirows, static_cast<double>(factory.GetPoolSize()),
+                                                                             filler_minirows, static_cast<double>(filler_count)), FailPValue);
+
+    std::printf("\n%-16s %10s %10s\n", "aligned minirows", "factory %", "filler %");
+    for (int bin = 0; bin < MinirowBins; ++bin) {
+        if (factory_minirows[bin] + filler_minirows[bin] > 0.0)
+            std::printf("%-16d %10.3f %10.3f\n", bin, 100.0 * factory_minirows[bin] / (grid_count - invalid_grids), 100.0 * filler_minirows[bin] / filler_count);
+    }
+
+    std::printf("\n%s\n", passed ? "No bias found" : "FAILED: the grids of the factory are biased");
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,498 @@
+// Headless puzzle service over a Unix domain socket.
+// One thread runs an epoll loop that accepts clients, cuts their byte streams into requests and writes the responses
+// back. Every request runs as one job on the sdq job system. The job builds the whole response, and its completion
+// goes back to the loop through an eventfd, so the loop thread never runs the engine and the workers never touch a socket.
+// A client stops being read while it has MaxInFlight requests running or MaxPendingOutput bytes it hasn't read yet,
+// so a fast writer can't grow the daemon's buffers without limit. See PuzzleProtocol.h for the wire format.
+//
+// Linux only. Build it with the sdq sources, e.g.
+//     g++ -std=c++20 -O2 -fpermissive -ISudoku -ILibraries/include Tools/PuzzleDaemon.cpp Sudoku/*.cpp -lboost_serialization -lpthread
+// Usage: PuzzleDaemon [socket path] [workers] [grade cache path] [seeds per difficulty]
+// Stops on SIGINT or SIGTERM, and saves the grade cache if one was given.
+// With seeds per difficulty, GetPuzzle derives its puzzles from that many generated puzzles of the difficulty once it
+// has them, in microseconds instead of milliseconds. A request seed then only gives the same puzzle for the same seeds.
+
+#if !defined(__linux__)
+#error "PuzzleDaemon uses epoll and eventfd, it only builds on Linux"
+#endif
+
+#include "PuzzleProtocol.h"
+#include "sdq.h"
+#include "sdq_grading.h"
+#include "sdq_grids.h"
+#include "sdq_jobs.h"
+#include "sdq_save.h"
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+
+constexpr int      ListenBacklog    = 128;
+constexpr int      MaxEpollEvents   = 64;
+constexpr size_t   ReadChunkSize    = 64 * 1024;
+constexpr uint32_t MaxInFlight      = 64;                 // Requests of one client running at once
+constexpr size_t   MaxPendingOutput = 4 * 1024 * 1024;    // Response bytes of one client waiting for it to read them
+
+int WakeupFd = -1;    // eventfd, written by the completion notifier and the signal handler
+volatile std::sig_atomic_t StopRequested = 0;
+
+using namespace sdq::service;
+
+struct Connection
+{
+    int                  Fd;
+    uint64_t             Serial;        // Tells a reused fd apart from the client a completion was made for
+    std::vector<uint8_t> Input;
+    size_t               InputOffset;   // Start of the first request not yet submitted
+    std::vector<uint8_t> Output;
+    size_t               OutputOffset;  // Start of the first byte not yet written
+    uint32_t             InFlight;
+    uint32_t             EpollEvents;   // What the fd is registered for right now
+    bool                 PeerClosed;    // The client shut down its side, close once its responses are written
+};
+
+sdq::grading::DigitGrid UnpackBoard(const PackedBoard& packed) noexcept
+{
+    sdq::grading::DigitGrid grid;
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx)
+        grid[tile_idx / 9][tile_idx % 9] = sdq::save::GetPackedDigit(packed, tile_idx);
+
+    return grid;
+}
+
+PackedBoard PackBoard(const sdq::GameBoard& board) noexcept
+{
+    PackedBoard packed = {};
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx)
+        sdq::save::SetPackedDigit(packed, tile_idx, board.GetTile(tile_idx / 9, tile_idx % 9).TileNumber);
+
+    return packed;
+}
+
+bool IsValidRequest(const RequestHeader& header) noexcept
+{
+    if (header.ItemCount == 0 || header.ItemCount > MaxBatchItems)
+        return false;
+
+    switch (header.Op) {
+    case PuzzleOp_GetPuzzle:   return header.PayloadSize == 0 && header.Difficulty <= SudokuDifficulty_Diabolical;
+    case PuzzleOp_Solve:
+    case PuzzleOp_Grade:
+    case PuzzleOp_CheckUnique: return header.PayloadSize == header.ItemCount * sizeof(PackedBoard);
+    default:                   return false;
+    }
+}
+
+template<typename Item>
+Item* GetItems(std::vector<uint8_t>& response) noexcept
+{
+    return reinterpret_cast<Item*>(response.data() + sizeof(ResponseHeader));
+}
+
+// Runs on a worker. Builds the whole response, header included
+std::vector<uint8_t> ProcessRequest(const RequestHeader& header, const std::vector<uint8_t>& payload, sdq::grading::GradeCache& grade_cache,
+                                    sdq::grids::PuzzleSeedSet* puzzle_seeds, std::atomic<uint64_t>& next_seed)
+{
+    ResponseHeader response_header = {};
+    response_header.RequestId = header.RequestId;
+    response_header.Op        = header.Op;
+    if (!IsValidRequest(header)) {
+        response_header.Status = PuzzleStatus_BadRequest;
+        std::vector<uint8_t> response(sizeof(ResponseHeader));
+        std::memcpy(response.data(), &response_header, sizeof(ResponseHeader));
+        return response;
+    }
+
+    response_header.ItemCount   = header.ItemCount;
+    response_header.PayloadSize = static_cast<uint32_t>(header.ItemCount * GetResponseItemSize(header.Op));
+    std::vector<uint8_t> response(sizeof(ResponseHeader) + response_header.PayloadSize);
+    std::memcpy(response.data(), &response_header, sizeof(ResponseHeader));
+
+    const auto get_board = [&payload](size_t item_idx) {
+        PackedBoard packed;
+        std::memcpy(packed.data(), payload.data() + item_idx * sizeof(PackedBoard), sizeof(PackedBoard));
+        return UnpackBoard(packed);
+    };
+
+    for (size_t item_idx = 0; item_idx < header.ItemCount; ++item_idx) {
+        switch (header.Op) {
+        case PuzzleOp_GetPuzzle: {
+            PuzzleItem item = {};
+            const uint64_t seed = header.Seed != 0 ? header.Seed + item_idx : next_seed.fetch_add(1, std::memory_order_relaxed);
+            sdq::Instance instance;
+            instance.SetGradeCache(&grade_cache);
+            instance.SetPuzzleSeeds(puzzle_seeds);
+            if (instance.CreateSudoku(static_cast<SudokuDifficulty>(header.Difficulty), seed)) {
+                sdq::save::SaveRecord record;
+                instance.CreateSaveRecord(record);
+                item.Puzzle     = record.PuzzleDigits;
+                item.Solution   = record.SolutionDigits;
+                item.Difficulty = record.Header.Difficulty;
+            }
+            else
+                item.Status = PuzzleStatus_Failed;
+            std::memcpy(GetItems<PuzzleItem>(response) + item_idx, &item, sizeof(PuzzleItem));
+            break;
+        }
+        case PuzzleOp_Solve: {
+            SolveItem item = {};
+            sdq::GameBoard board;
+            if (!board.CreateSudokuBoard(get_board(item_idx)))
+                item.Status = PuzzleStatus_InvalidBoard;
+            else if (!sdq::solvers::SolveMRV(board))
+                item.Status = PuzzleStatus_Unsolvable;
+            else
+                item.Solution = PackBoard(board);
+            std::memcpy(GetItems<SolveItem>(response) + item_idx, &item, sizeof(SolveItem));
+            break;
+        }
+        case PuzzleOp_Grade: {
+            GradeItem item = {};
+            const auto grade = sdq::grading::GradePuzzle(get_board(item_idx), &grade_cache);
+            item.Score          = grade.Score;
+            item.UsedTechniques = static_cast<uint16_t>(grade.UsedTechniques);
+            item.Difficulty     = static_cast<uint8_t>(grade.Difficulty);
+            item.Status         = grade.Difficulty == SudokuDifficulty_Random ? PuzzleStatus_InvalidBoard : PuzzleStatus_Ok;
+            std::memcpy(GetItems<GradeItem>(response) + item_idx, &item, sizeof(GradeItem));
+            break;
+        }
+        default: {
+            UniqueItem item = {};
+            sdq::GameBoard board;
+            if (board.CreateSudokuBoard(get_board(item_idx)))
+                item.Unique = sdq::utils::IsUniqueBoard(board) ? 1 : 0;
+            else
+                item.Status = PuzzleStatus_InvalidBoard;
+            std::memcpy(GetItems<UniqueItem>(response) + item_idx, &item, sizeof(UniqueItem));
+            break;
+        }
+        }
+    }
+
+    return response;
+}
+
+class PuzzleDaemon
+{
+private:
+    int                                 ListenFd;
+    int                                 EpollFd;
+    sdq::grading::GradeCache&           Cache;
+    sdq::grids::PuzzleSeedSet*          Seeds;
+    std::atomic<uint64_t>               NextSeed;
+    std::unordered_map<int, Connection> Connections;
+    uint64_t                            NextSerial;
+    sdq::jobs::JobSystem                Jobs;       // Last, so the running jobs are done before what they use is destroyed
+
+public:
+    PuzzleDaemon(int listen_fd, int epoll_fd, size_t worker_count, sdq::grading::GradeCache& cache, sdq::grids::PuzzleSeedSet* seeds) :
+        ListenFd(listen_fd), EpollFd(epoll_fd), Cache(cache), Seeds(seeds), NextSeed(std::random_device()() | 1ull), NextSerial(1), Jobs(worker_count)
+    {
+        Jobs.SetCompletionNotifier([]() {
+            const uint64_t one = 1;
+            [[maybe_unused]] const ssize_t written = write(WakeupFd, &one, sizeof(one));
+        });
+    }
+
+    ~PuzzleDaemon()
+    {
+        for (const auto& [fd, connection] : Connections)
+            close(fd);
+    }
+
+    void Run()
+    {
+        std::array<epoll_event, MaxEpollEvents> events;
+        while (!StopRequested) {
+            const int event_count = epoll_wait(EpollFd, events.data(), MaxEpollEvents, -1);
+            if (event_count < 0 && errno != EINTR) {
+                std::perror("epoll_wait");
+                return;
+            }
+
+            for (int event_idx = 0; event_idx < event_count; ++event_idx) {
+                const int fd = events[event_idx].data.fd;
+                if (fd == ListenFd)
+                    this->AcceptClients();
+                else if (fd == WakeupFd) {
+                    uint64_t wakeups;
+                    [[maybe_unused]] const ssize_t read_size = read(WakeupFd, &wakeups, sizeof(wakeups));
+                    Jobs.RunCompletions();
+                }
+                else
+                    this->HandleClientEvent(fd, events[event_idx].events);
+            }
+        }
+    }
+
+private:
+    void AcceptClients()
+    {
+        while (true) {
+            const int fd = accept4(ListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    std::perror("accept4");
+                return;
+            }
+
+            epoll_event event = {};
+            event.events  = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(EpollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+                close(fd);
+                continue;
+            }
+
+            Connection& connection = Connections[fd];
+            connection = {};
+            connection.Fd          = fd;
+            connection.Serial      = NextSerial++;
+            connection.EpollEvents = EPOLLIN;
+        }
+    }
+
+    void HandleClientEvent(int fd, uint32_t events)
+    {
+        const auto found = Connections.find(fd);
+        if (found == Connections.end())
+            return;
+
+        Connection& connection = found->second;
+        if (events & (EPOLLERR | EPOLLHUP) && !(events & EPOLLIN)) {
+            this->CloseConnection(connection);
+            return;
+        }
+        if ((events & EPOLLOUT) && !this->FlushOutput(connection))
+            return;
+        if ((events & EPOLLIN) && !this->ReadInput(connection))
+            return;
+
+        this->SubmitRequests(connection);
+        this->UpdateConnection(connection);
+    }
+
+    // False if the connection was closed
+    bool ReadInput(Connection& connection)
+    {
+        std::array<uint8_t, ReadChunkSize> chunk;
+        while (true) {
+            const ssize_t read_size = read(connection.Fd, chunk.data(), chunk.size());
+            if (read_size > 0) {
+                connection.Input.insert(connection.Input.end(), chunk.begin(), chunk.begin() + read_size);
+                if (static_cast<size_t>(read_size) < chunk.size())
+                    return true;
+                continue;
+            }
+            if (read_size == 0) {
+                connection.PeerClosed = true;
+                return true;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            if (errno != EINTR) {
+                this->CloseConnection(connection);
+                return false;
+            }
+        }
+    }
+
+    bool CanTakeRequests(const Connection& connection) const noexcept
+    {
+        return connection.InFlight < MaxInFlight && connection.Output.size() - connection.OutputOffset < MaxPendingOutput;
+    }
+
+    void SubmitRequests(Connection& connection)
+    {
+        while (this->CanTakeRequests(connection) && connection.Input.size() - connection.InputOffset >= sizeof(RequestHeader)) {
+            RequestHeader header;
+            std::memcpy(&header, connection.Input.data() + connection.InputOffset, sizeof(RequestHeader));
+            // Past the biggest valid payload the stream can't be framed anymore
+            if (header.PayloadSize > MaxRequestPayload) {
+                connection.PeerClosed = true;
+                connection.Input.clear();
+                connection.InputOffset = 0;
+                return;
+            }
+            if (connection.Input.size() - connection.InputOffset < sizeof(RequestHeader) + header.PayloadSize)
+                break;
+
+            const auto payload_start = connection.Input.begin() + connection.InputOffset + sizeof(RequestHeader);
+            std::vector<uint8_t> payload(payload_start, payload_start + header.PayloadSize);
+            connection.InputOffset += sizeof(RequestHeader) + header.PayloadSize;
+            ++connection.InFlight;
+
+            // Generation takes milliseconds, the other ops microseconds, so generation doesn't hold them up
+            const JobPriority priority = header.Op == PuzzleOp_GetPuzzle ? JobPriority_Normal : JobPriority_High;
+            Jobs.Submit(priority,
+                [this, header, payload = std::move(payload)]() { return ProcessRequest(header, payload, Cache, Seeds, NextSeed); },
+                [this, fd = connection.Fd, serial = connection.Serial](std::vector<uint8_t> response) { this->CompleteRequest(fd, serial, response); });
+        }
+
+        // Drops the submitted requests once they are a good part of the buffer, instead of on every request
+        if (connection.InputOffset > 0 && connection.InputOffset * 2 >= connection.Input.size()) {
+            connection.Input.erase(connection.Input.begin(), connection.Input.begin() + connection.InputOffset);
+            connection.InputOffset = 0;
+        }
+    }
+
+    void CompleteRequest(int fd, uint64_t serial, const std::vector<uint8_t>& response)
+    {
+        const auto found = Connections.find(fd);
+        if (found == Connections.end() || found->second.Serial != serial)
+            return;
+
+        Connection& connection = found->second;
+        --connection.InFlight;
+        connection.Output.insert(connection.Output.end(), response.begin(), response.end());
+        if (!this->FlushOutput(connection))
+            return;
+
+        this->SubmitRequests(connection);
+        this->UpdateConnection(connection);
+    }
+
+    // False if the connection was closed
+    bool FlushOutput(Connection& connection)
+    {
+        while (connection.OutputOffset < connection.Output.size()) {
+            const ssize_t written = send(connection.Fd, connection.Output.data() + connection.OutputOffset,
+                                         connection.Output.size() - connection.OutputOffset, MSG_NOSIGNAL);
+            if (written >= 0) {
+                connection.OutputOffset += static_cast<size_t>(written);
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            if (errno != EINTR) {
+                this->CloseConnection(connection);
+                return false;
+            }
+        }
+
+        connection.Output.clear();
+        connection.OutputOffset = 0;
+        return true;
+    }
+
+    // Registers the fd for what the connection can do now, or closes it once a closed client got all its responses
+    void UpdateConnection(Connection& connection)
+    {
+        const bool output_pending = connection.OutputOffset < connection.Output.size();
+        if (connection.PeerClosed && connection.InFlight == 0 && !output_pending) {
+            this->CloseConnection(connection);
+            return;
+        }
+
+        const uint32_t events = (!connection.PeerClosed && this->CanTakeRequests(connection) ? EPOLLIN : 0u) | (output_pending ? EPOLLOUT : 0u);
+        if (events == connection.EpollEvents)
+            return;
+
+        epoll_event event = {};
+        event.events  = events;
+        event.data.fd = connection.Fd;
+        epoll_ctl(EpollFd, EPOLL_CTL_MOD, connection.Fd, &event);
+        connection.EpollEvents = events;
+    }
+
+    // The jobs still running for the connection finish, and their completions find no connection with their serial
+    void CloseConnection(Connection& connection)
+    {
+        const int fd = connection.Fd;
+        epoll_ctl(EpollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        Connections.erase(fd);
+    }
+};
+
+void OnStopSignal(int)
+{
+    StopRequested = 1;
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t written = write(WakeupFd, &one, sizeof(one));
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const std::string socket_path   = argc > 1 ? argv[1] : DefaultSocketPath;
+    const size_t      worker_count  = argc > 2 ? std::max(1, std::atoi(argv[2])) : sdq::jobs::JobSystem::GetDefaultWorkerCount();
+    const char*       cache_path    = argc > 3 ? argv[3] : nullptr;
+    const int         seed_count    = argc > 4 ? std::max(0, std::atoi(argv[4])) : 0;
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::printf("FAILED: socket path is longer than %zu bytes\n", sizeof(address.sun_path) - 1);
+        return EXIT_FAILURE;
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(socket_path.c_str());
+    if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd, ListenBacklog) != 0) {
+        std::perror("FAILED: couldn't listen on the socket");
+        return EXIT_FAILURE;
+    }
+
+    WakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (WakeupFd < 0 || epoll_fd < 0) {
+        std::perror("FAILED: couldn't create the event loop");
+        return EXIT_FAILURE;
+    }
+
+    for (const int fd : { listen_fd, WakeupFd }) {
+        epoll_event event = {};
+        event.events  = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    struct sigaction stop_action = {};
+    stop_action.sa_handler = OnStopSignal;
+    sigaction(SIGINT, &stop_action, nullptr);
+    sigaction(SIGTERM, &stop_action, nullptr);
+
+    sdq::grading::GradeCache grade_cache;
+    if (cache_path != nullptr)
+        grade_cache.Load(cache_path);
+
+    std::unique_ptr<sdq::grids::PuzzleSeedSet> puzzle_seeds;
+    if (seed_count > 0)
+        puzzle_seeds = std::make_unique<sdq::grids::PuzzleSeedSet>(static_cast<size_t>(seed_count));
+
+    {
+        PuzzleDaemon daemon(listen_fd, epoll_fd, worker_count, grade_cache, puzzle_seeds.get());
+        std::printf("Listening on %s with %zu workers%s\n", socket_path.c_str(), worker_count, puzzle_seeds ? ", deriving puzzles from seeds" : "");
+        std::fflush(stdout);
+        daemon.Run();
+    }
+
+    if (cache_path != nullptr)
+        grade_cache.Save(cache_path);
+
+    close(epoll_fd);
+    close(listen_fd);
+    close(WakeupFd);
+    unlink(socket_path.c_str());
+    std::printf("Stopped\n");
+    return EXIT_SUCCESS;
+}
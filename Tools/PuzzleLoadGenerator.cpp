@@ -0,0 +1,293 @@
+// Load generator for the puzzle daemon.
+// Fetches a pool of puzzles from the daemon, then every connection thread keeps a fixed number of pipelined requests
+// in flight for the given time, with a random mix of solve, grade, uniqueness and generation requests of the same
+// batch size. Checks every response, and reports the requests and boards per second and the latency percentiles of
+// each op, measured from the send of a request to the end of its response.
+//
+// Linux only. Build it with the sdq sources, e.g.
+//     g++ -std=c++20 -O2 -fpermissive -ISudoku -ILibraries/include Tools/PuzzleLoadGenerator.cpp Sudoku/*.cpp -lboost_serialization -lpthread
+// Usage: PuzzleLoadGenerator [socket path] [connections] [pipeline depth] [batch items] [seconds]
+
+#if !defined(__linux__)
+#error "PuzzleLoadGenerator uses Unix domain sockets, it only builds on Linux"
+#endif
+
+#include "PuzzleProtocol.h"
+#include "sdq.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+
+constexpr int      DefaultConnections   = 4;
+constexpr int      DefaultPipelineDepth = 16;
+constexpr int      DefaultBatchItems    = 1;
+constexpr double   DefaultSeconds       = 5.0;
+constexpr int      PoolPuzzles          = 64;
+constexpr uint64_t PoolFirstSeed        = 1;
+constexpr size_t   SendTimeSlots        = 1 << 16;    // Ring of send times by request id, must be bigger than the pipeline depth
+
+using namespace sdq::service;
+using Clock = std::chrono::steady_clock;
+
+constexpr std::array<const char*, PuzzleOp_COUNT> OpNames   = { "", "get puzzle", "solve", "grade", "check unique" };
+constexpr std::array<int, PuzzleOp_COUNT>         OpWeights = { 0, 5, 40, 30, 25 };    // Out of 100
+
+struct ClientStats
+{
+    uint64_t                                      Requests = 0;
+    uint64_t                                      Items    = 0;
+    uint64_t                                      Errors   = 0;
+    std::array<std::vector<double>, PuzzleOp_COUNT> LatencyUs;
+};
+
+double Percentile(const std::vector<double>& sorted_values, double percentile)
+{
+    if (sorted_values.empty())
+        return 0.0;
+
+    const size_t idx = static_cast<size_t>(percentile * static_cast<double>(sorted_values.size() - 1) + 0.5);
+    return sorted_values[std::min(idx, sorted_values.size() - 1)];
+}
+
+int Connect(const std::string& socket_path)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+        return -1;
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+void AppendRequest(std::vector<uint8_t>& buffer, PuzzleOp op, uint32_t request_id, uint16_t item_count, const std::vector<PackedBoard>& pool,
+                   sdq::Xoshiro256& rng, uint64_t seed = 0)
+{
+    RequestHeader header = {};
+    header.RequestId   = request_id;
+    header.Op          = static_cast<uint8_t>(op);
+    header.ItemCount   = item_count;
+    header.Seed        = seed;
+    header.Difficulty  = SudokuDifficulty_Easy;
+    header.PayloadSize = op == PuzzleOp_GetPuzzle ? 0u : static_cast<uint32_t>(item_count * sizeof(PackedBoard));
+
+    const size_t offset = buffer.size();
+    buffer.resize(offset + sizeof(RequestHeader) + header.PayloadSize);
+    std::memcpy(buffer.data() + offset, &header, sizeof(RequestHeader));
+    for (size_t item_idx = 0; op != PuzzleOp_GetPuzzle && item_idx < item_count; ++item_idx)
+        std::memcpy(buffer.data() + offset + sizeof(RequestHeader) + item_idx * sizeof(PackedBoard), pool[rng.NextBounded(pool.size())].data(), sizeof(PackedBoard));
+}
+
+// True if the response has every item it should and every item is fine
+bool CheckResponse(const ResponseHeader& header, const uint8_t* payload, uint16_t expected_items)
+{
+    if (header.Status != PuzzleStatus_Ok || header.ItemCount != expected_items || header.PayloadSize != expected_items * GetResponseItemSize(header.Op))
+        return false;
+
+    for (size_t item_idx = 0; item_idx < header.ItemCount; ++item_idx) {
+        const uint8_t* item = payload + item_idx * GetResponseItemSize(header.Op);
+        // The status is the last byte of every item, and the pool boards are all unique puzzles
+        if (item[GetResponseItemSize(header.Op) - 1] != PuzzleStatus_Ok)
+            return false;
+        if (header.Op == PuzzleOp_CheckUnique && item[0] != 1)
+            return false;
+    }
+
+    return true;
+}
+
+// Blocking exchange of one batch, for the puzzle pool
+bool FetchPool(const std::string& socket_path, std::vector<PackedBoard>& pool)
+{
+    const int fd = Connect(socket_path);
+    if (fd < 0)
+        return false;
+
+    std::vector<uint8_t> request;
+    sdq::Xoshiro256 rng;
+    AppendRequest(request, PuzzleOp_GetPuzzle, 0, PoolPuzzles, pool, rng, PoolFirstSeed);
+    bool fetched = send(fd, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size());
+
+    std::vector<uint8_t> response(sizeof(ResponseHeader) + PoolPuzzles * sizeof(PuzzleItem));
+    size_t received = 0;
+    while (fetched && received < response.size()) {
+        const ssize_t read_size = recv(fd, response.data() + received, response.size() - received, 0);
+        fetched = read_size > 0;
+        received += fetched ? static_cast<size_t>(read_size) : 0;
+    }
+    close(fd);
+
+    ResponseHeader header;
+    std::memcpy(&header, response.data(), sizeof(ResponseHeader));
+    if (!fetched || !CheckResponse(header, response.data() + sizeof(ResponseHeader), PoolPuzzles))
+        return false;
+
+    for (size_t item_idx = 0; item_idx < PoolPuzzles; ++item_idx) {
+        PuzzleItem item;
+        std::memcpy(&item, response.data() + sizeof(ResponseHeader) + item_idx * sizeof(PuzzleItem), sizeof(PuzzleItem));
+        pool.push_back(item.Puzzle);
+    }
+
+    return true;
+}
+
+PuzzleOp PickOp(uint64_t roll)
+{
+    for (PuzzleOp op = PuzzleOp_GetPuzzle; op < PuzzleOp_COUNT; ++op) {
+        if (roll < static_cast<uint64_t>(OpWeights[op]))
+            return op;
+        roll -= OpWeights[op];
+    }
+
+    return PuzzleOp_Solve;
+}
+
+void RunClient(const std::string& socket_path, const std::vector<PackedBoard>& pool, int pipeline_depth, uint16_t batch_items,
+               Clock::time_point deadline, uint64_t seed, ClientStats& stats)
+{
+    const int fd = Connect(socket_path);
+    if (fd < 0) {
+        ++stats.Errors;
+        return;
+    }
+
+    sdq::Xoshiro256 rng(seed);
+    std::vector<Clock::time_point> send_times(SendTimeSlots);
+    std::vector<uint8_t> output, input;
+    size_t output_offset = 0;
+    uint32_t next_request_id = 0;
+    int in_flight = 0;
+    bool failed = false;
+    while (!failed) {
+        const bool sending = Clock::now() < deadline;
+        for (; sending && in_flight < pipeline_depth; ++in_flight) {
+            const PuzzleOp op = PickOp(rng.NextBounded(100));
+            send_times[next_request_id % SendTimeSlots] = Clock::now();
+            AppendRequest(output, op, next_request_id++, batch_items, pool, rng);
+        }
+        if (!sending && in_flight == 0)
+            break;
+
+        pollfd poll_fd = { fd, static_cast<short>(POLLIN | (output_offset < output.size() ? POLLOUT : 0)), 0 };
+        if (poll(&poll_fd, 1, 100) < 0 && errno != EINTR)
+            break;
+
+        if (poll_fd.revents & POLLOUT) {
+            const ssize_t written = send(fd, output.data() + output_offset, output.size() - output_offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+            failed = written < 0 && errno != EAGAIN && errno != EINTR;
+            output_offset += written > 0 ? static_cast<size_t>(written) : 0;
+            if (output_offset == output.size()) {
+                output.clear();
+                output_offset = 0;
+            }
+        }
+        if (poll_fd.revents & (POLLIN | POLLHUP | POLLERR)) {
+            std::array<uint8_t, 64 * 1024> chunk;
+            const ssize_t read_size = recv(fd, chunk.data(), chunk.size(), MSG_DONTWAIT);
+            if (read_size <= 0) {
+                failed = read_size == 0 || (errno != EAGAIN && errno != EINTR);
+                continue;
+            }
+            input.insert(input.end(), chunk.begin(), chunk.begin() + read_size);
+
+            const auto received = Clock::now();
+            size_t offset = 0;
+            while (input.size() - offset >= sizeof(ResponseHeader)) {
+                ResponseHeader header;
+                std::memcpy(&header, input.data() + offset, sizeof(ResponseHeader));
+                if (input.size() - offset < sizeof(ResponseHeader) + header.PayloadSize)
+                    break;
+
+                const bool valid_op = header.Op > 0 && header.Op < PuzzleOp_COUNT;
+                if (!valid_op || !CheckResponse(header, input.data() + offset + sizeof(ResponseHeader), batch_items))
+                    ++stats.Errors;
+                if (valid_op)
+                    stats.LatencyUs[header.Op].push_back(std::chrono::duration<double, std::micro>(received - send_times[header.RequestId % SendTimeSlots]).count());
+                ++stats.Requests;
+                stats.Items += header.ItemCount;
+                --in_flight;
+                offset += sizeof(ResponseHeader) + header.PayloadSize;
+            }
+            input.erase(input.begin(), input.begin() + offset);
+        }
+    }
+
+    stats.Errors += failed ? in_flight : 0;
+    close(fd);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const std::string socket_path    = argc > 1 ? argv[1] : DefaultSocketPath;
+    const int         connections    = argc > 2 ? std::max(1, std::atoi(argv[2])) : DefaultConnections;
+    const int         pipeline_depth = argc > 3 ? std::clamp(std::atoi(argv[3]), 1, static_cast<int>(SendTimeSlots / 2)) : DefaultPipelineDepth;
+    const uint16_t    batch_items    = static_cast<uint16_t>(argc > 4 ? std::clamp(std::atoi(argv[4]), 1, static_cast<int>(MaxBatchItems)) : DefaultBatchItems);
+    const double      seconds        = argc > 5 ? std::max(0.1, std::atof(argv[5])) : DefaultSeconds;
+
+    std::vector<PackedBoard> pool;
+    if (!FetchPool(socket_path, pool)) {
+        std::printf("FAILED: couldn't get the puzzle pool from %s. Is the daemon running?\n", socket_path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    const auto start    = Clock::now();
+    const auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    std::vector<ClientStats> stats(connections);
+    std::vector<std::thread> clients;
+    for (int idx = 0; idx < connections; ++idx)
+        clients.emplace_back(RunClient, std::cref(socket_path), std::cref(pool), pipeline_depth, batch_items, deadline, static_cast<uint64_t>(idx + 1), std::ref(stats[idx]));
+    for (auto& client : clients)
+        client.join();
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    ClientStats total;
+    for (const auto& client_stats : stats) {
+        total.Requests += client_stats.Requests;
+        total.Items    += client_stats.Items;
+        total.Errors   += client_stats.Errors;
+        for (PuzzleOp op = 0; op < PuzzleOp_COUNT; ++op)
+            total.LatencyUs[op].insert(total.LatencyUs[op].end(), client_stats.LatencyUs[op].begin(), client_stats.LatencyUs[op].end());
+    }
+
+    std::printf("%d connections, depth %d, %u boards per request, %.2f s\n", connections, pipeline_depth, batch_items, elapsed);
+    std::printf("%llu requests, %.0f requests/s, %.0f boards/s, %llu errors\n", static_cast<unsigned long long>(total.Requests),
+                static_cast<double>(total.Requests) / elapsed, static_cast<double>(total.Items) / elapsed, static_cast<unsigned long long>(total.Errors));
+    std::printf("%-13s %9s %9s %9s %9s %9s %9s\n", "op", "requests", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+    std::vector<double> all_latencies;
+    for (PuzzleOp op = PuzzleOp_GetPuzzle; op < PuzzleOp_COUNT; ++op) {
+        auto& latencies = total.LatencyUs[op];
+        std::sort(latencies.begin(), latencies.end());
+        all_latencies.insert(all_latencies.end(), latencies.begin(), latencies.end());
+        std::printf("%-13s %9zu %9.1f %9.1f %9.1f %9.1f %9.1f\n", OpNames[op], latencies.size(), Percentile(latencies, 0.50), Percentile(latencies, 0.90),
+                    Percentile(latencies, 0.99), Percentile(latencies, 0.999), latencies.empty() ? 0.0 : latencies.back());
+    }
+    std::sort(all_latencies.begin(), all_latencies.end());
+    std::printf("%-13s %9zu %9.1f %9.1f %9.1f %9.1f %9.1f\n", "all", all_latencies.size(), Percentile(all_latencies, 0.50), Percentile(all_latencies, 0.90),
+                Percentile(all_latencies, 0.99), Percentile(all_latencies, 0.999), all_latencies.empty() ? 0.0 : all_latencies.back());
+
+    return total.Errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Wire format of the puzzle daemon.
+// Every message is a fixed size header followed by PayloadSize bytes, in the native byte order like the save files,
+// so both sides read a message with two memcpys and no parsing. Boards are 81 digits packed two per byte, the same
+// packing as the digits of a save record, with 0 for a blank tile.
+// Pipelining: a client may keep sending requests without waiting for the responses. Responses carry the RequestId of
+// their request and come back in the order they finish, not in the order they were sent.
+// Batching: one request carries ItemCount boards, or asks for ItemCount puzzles, and its response carries one item per
+// board in the same order, so a client pays the round trip once for the whole batch.
+
+enum PuzzleOp_
+{
+    PuzzleOp_GetPuzzle   = 1,    // No payload. Generates ItemCount puzzles of the Difficulty of the request
+    PuzzleOp_Solve       = 2,    // Payload is ItemCount boards
+    PuzzleOp_Grade       = 3,    // Payload is ItemCount boards
+    PuzzleOp_CheckUnique = 4,    // Payload is ItemCount boards
+    PuzzleOp_COUNT
+};
+
+using PuzzleOp = int;
+
+enum PuzzleStatus_
+{
+    PuzzleStatus_Ok           = 0,
+    PuzzleStatus_BadRequest   = 1,    // Unknown op or difficulty, too many items, or a payload that doesn't match them. The response has no items
+    PuzzleStatus_InvalidBoard = 2,    // A digit past 9, or the same digit twice in a unit
+    PuzzleStatus_Unsolvable   = 3,
+    PuzzleStatus_Failed       = 4     // The generator gave up on the puzzle
+};
+
+using PuzzleStatus = int;
+
+namespace sdq::service
+{
+
+constexpr const char* DefaultSocketPath = "/tmp/sdq-puzzle.sock";
+constexpr uint16_t    MaxBatchItems     = 256;
+
+using PackedBoard = std::array<uint8_t, 41>;
+
+struct RequestHeader
+{
+    uint32_t PayloadSize;
+    uint32_t RequestId;     // Chosen by the client, sent back in the response
+    uint64_t Seed;          // GetPuzzle only. Item N is generated with Seed + N, 0 lets the daemon pick the seeds
+    uint8_t  Op;
+    uint8_t  Difficulty;    // GetPuzzle only
+    uint16_t ItemCount;
+    uint32_t Reserved;
+};
+
+struct ResponseHeader
+{
+    uint32_t PayloadSize;
+    uint32_t RequestId;
+    uint8_t  Op;
+    uint8_t  Status;        // PuzzleStatus_Ok or PuzzleStatus_BadRequest. Every item has its own status too
+    uint16_t ItemCount;
+};
+
+struct PuzzleItem
+{
+    PackedBoard Puzzle;
+    PackedBoard Solution;
+    uint8_t     Difficulty;
+    uint8_t     Status;
+};
+
+struct SolveItem
+{
+    PackedBoard Solution;
+    uint8_t     Status;
+};
+
+struct GradeItem
+{
+    uint32_t Score;
+    uint16_t UsedTechniques;
+    uint8_t  Difficulty;
+    uint8_t  Status;
+};
+
+struct UniqueItem
+{
+    uint8_t Unique;
+    uint8_t Status;
+};
+
+static_assert(sizeof(RequestHeader) == 24, "RequestHeader layout changed! Update the clients.");
+static_assert(sizeof(ResponseHeader) == 12, "ResponseHeader layout changed! Update the clients.");
+static_assert(sizeof(PuzzleItem) == 84, "PuzzleItem layout changed! Update the clients.");
+static_assert(sizeof(SolveItem) == 42, "SolveItem layout changed! Update the clients.");
+static_assert(sizeof(GradeItem) == 8, "GradeItem layout changed! Update the clients.");
+static_assert(sizeof(UniqueItem) == 2, "UniqueItem layout changed! Update the clients.");
+
+constexpr uint32_t MaxRequestPayload = MaxBatchItems * sizeof(PackedBoard);
+
+constexpr std::size_t GetResponseItemSize(PuzzleOp op) noexcept
+{
+    switch (op) {
+    case PuzzleOp_GetPuzzle:   return sizeof(PuzzleItem);
+    case PuzzleOp_Solve:       return sizeof(SolveItem);
+    case PuzzleOp_Grade:       return sizeof(GradeItem);
+    case PuzzleOp_CheckUnique: return sizeof(UniqueItem);
+    default:                   return 0;
+    }
+}
+
+}
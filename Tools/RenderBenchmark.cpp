@@ -0,0 +1,244 @@
+// Headless frame time benchmark for GameWindow::RenderWindow.
+// Runs scripted scenarios against an ImGui context without a renderer backend, so no GPU or window is needed,
+// and reports the CPU time of each frame together with the vertex/index counts of its draw data.
+//
+// Build it with the same sources as the game minus main.cpp, glad.c, ImGuiFunctions.cpp and the imgui backends, e.g.
+//     g++ -std=c++20 -O2 -fpermissive -Iimgui -I"Window Helpers" -ISudoku -IFonts -ILibraries/include Tools/RenderBenchmark.cpp
+//         "Window Helpers/GameWindow.cpp" "Window Helpers/ImFunks.cpp" "Window Helpers/DirectoryScanner.cpp"
+//         Sudoku/*.cpp imgui/imgui.cpp imgui/imgui_draw.cpp imgui/imgui_tables.cpp imgui/imgui_widgets.cpp
+//         -lboost_serialization -lpthread
+// Usage: RenderBenchmark [frames per scenario]
+// The scenarios create their files in a scratch folder under the temp directory, never in the working directory.
+
+#include "GameWindow.h"
+#include "imgui_internal.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr ImVec2 DisplaySize     = ImVec2(785.0f, 507.0f);   // Same as the game window
+constexpr float  FrameDeltaTime  = 1.0f / 60.0f;
+constexpr int    WarmupFrames    = 10;
+constexpr int    DefaultFrames   = 500;
+constexpr int    SaveSlotFiles   = 100;
+constexpr int    SudokuFileCount = 2000;
+constexpr int    ScanWaitFrames  = 10000;
+
+struct FrameStats
+{
+    double FrameMs;
+    int    VertexCount;
+    int    IndexCount;
+    int    CommandCount;
+};
+
+void CreateFonts(ImGuiIO& io)
+{
+    // GameWindow pushes Fonts[0] to Fonts[3]. The real fonts are used if the Fonts folder is next to us
+    const std::string font_filepath = (std::filesystem::path("Fonts") / "Quicksand-Medium.ttf").string();
+    const bool        font_exists   = std::filesystem::exists(font_filepath);
+    for (const float font_size : { 15.0f, 18.0f, 22.0f }) {
+        if (font_exists)
+            io.Fonts->AddFontFromFileTTF(font_filepath.c_str(), font_size);
+        else
+            io.Fonts->AddFontDefault();
+    }
+    io.Fonts->AddFontDefault();
+
+    // No backend uploads the atlas, it only has to be built and have a texture id
+    unsigned char* pixels = nullptr;
+    int width = 0, height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    io.Fonts->SetTexID(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(1)));
+}
+
+}
+
+// Friend of GameWindow, drives its private state the same way the menus do
+class RenderBenchmark
+{
+private:
+    int                      FrameCount;
+    std::filesystem::path    ScratchDirectory;
+    std::filesystem::path    StartDirectory;
+    std::vector<std::string> Failures;
+
+public:
+    explicit RenderBenchmark(int frame_count) :
+        FrameCount(frame_count),
+        ScratchDirectory(std::filesystem::temp_directory_path() / "sdq render benchmark"),
+        StartDirectory(std::filesystem::current_path())
+    {
+        std::error_code error;
+        std::filesystem::remove_all(ScratchDirectory, error);
+        std::filesystem::create_directories(ScratchDirectory, error);
+        if (std::filesystem::exists(StartDirectory / "Fonts", error))
+            std::filesystem::copy(StartDirectory / "Fonts", ScratchDirectory / "Fonts", std::filesystem::copy_options::recursive, error);
+        std::filesystem::current_path(ScratchDirectory, error);
+    }
+
+    ~RenderBenchmark()
+    {
+        std::error_code error;
+        std::filesystem::current_path(StartDirectory, error);
+        std::filesystem::remove_all(ScratchDirectory, error);
+    }
+
+    int Run()
+    {
+        std::printf("%-26s %8s %9s %9s %9s %9s %9s %9s %7s\n", "scenario", "frames", "avg ms", "p50 ms", "p95 ms", "max ms", "vertices", "indices", "draws");
+
+        this->RunScenario("new game", [](GameWindow& game_window) {
+            return StartGame(game_window, SudokuDifficulty_Normal);
+        });
+
+        this->RunScenario("pencilmarks, 81 tiles", [](GameWindow& game_window) {
+            // An empty board makes every tile a puzzle tile, so all 81 draw their pencilmark grid
+            std::array<std::array<int, 9>, 9> empty_board = {};
+            if (!game_window.SudokuContext.CreateSudoku(empty_board))
+                return false;
+
+            game_window.GameStart = true;
+            game_window.SetSudokuTilesForNewGame();
+            game_window.ShowPencilmarks = true;
+            for (auto& row_tile : game_window.SudokuGameTiles)
+                for (auto& tile : row_tile)
+                    tile.UpdateTileNumber(TileState_Pencilmark);
+            return true;
+        });
+
+        this->RunScenario("save modal, 100 slots", [](GameWindow& game_window) {
+            if (!StartGame(game_window, SudokuDifficulty_Easy))
+                return false;
+
+            // Same slot paths the save window builds
+            std::error_code error;
+            std::filesystem::create_directory("save files", error);
+            for (int idx = 1; idx <= SaveSlotFiles; ++idx) {
+                const std::string filepath = "save files\\save " + std::to_string(idx) + ".bin";
+                if (!game_window.SudokuContext.SaveCurrentProgress(filepath.c_str()))
+                    return false;
+            }
+            game_window.OpenLoadSaveFileWindow = true;
+            return true;
+        });
+
+        this->RunScenario("sudoku file list, 2000", [](GameWindow& game_window) {
+            std::error_code error;
+            std::filesystem::create_directory("sudoku boards", error);
+            for (int idx = 0; idx < SudokuFileCount; ++idx)
+                std::ofstream(std::filesystem::path("sudoku boards") / ("board " + std::to_string(idx) + ".txt")) << "0";
+
+            game_window.OpenLoadSudokuWindow = true;
+            return true;
+        }, [](GameWindow& game_window) {
+            // Waits until the background scan has handed every file to the window
+            return !game_window.SudokuFileScanner.IsScanning() && game_window.SudokuFileScanner.GetEntries().size() >= SudokuFileCount;
+        });
+
+        for (const auto& failure : Failures)
+            std::printf("FAILED: %s\n", failure.c_str());
+
+        return Failures.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+private:
+    static bool StartGame(GameWindow& game_window, SudokuDifficulty difficulty)
+    {
+        // Fixed seed, every run benchmarks the same board
+        if (!game_window.SudokuContext.CreateSudoku(difficulty, 1))
+            return false;
+
+        game_window.GameStart = true;
+        game_window.SetSudokuTilesForNewGame();
+        return true;
+    }
+
+    template<typename SetupFunc, typename ReadyFunc = bool(*)(GameWindow&)>
+    void RunScenario(const char* name, SetupFunc setup, ReadyFunc is_ready = [](GameWindow&) { return true; })
+    {
+        ImGuiContext* imgui_context = ImGui::CreateContext();
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = DisplaySize;
+        io.DeltaTime   = FrameDeltaTime;
+        io.IniFilename = nullptr;
+        CreateFonts(io);
+
+        {
+            GameWindow game_window;
+            if (!setup(game_window)) {
+                Failures.push_back(std::string(name) + ": setup failed");
+                ImGui::DestroyContext(imgui_context);
+                return;
+            }
+
+            int wait_frames = 0;
+            while (!is_ready(game_window) && wait_frames++ < ScanWaitFrames)
+                RenderFrame(game_window);
+            if (!is_ready(game_window))
+                Failures.push_back(std::string(name) + ": never became ready");
+
+            for (int frame = 0; frame < WarmupFrames; ++frame)
+                RenderFrame(game_window);
+
+            std::vector<FrameStats> frame_stats;
+            frame_stats.reserve(FrameCount);
+            for (int frame = 0; frame < FrameCount; ++frame)
+                frame_stats.push_back(RenderFrame(game_window));
+
+            PrintStats(name, frame_stats);
+        }
+
+        ImGui::DestroyContext(imgui_context);
+    }
+
+    static FrameStats RenderFrame(GameWindow& game_window)
+    {
+        const auto frame_start = std::chrono::steady_clock::now();
+        ImGui::NewFrame();
+        game_window.RenderWindow();
+        ImGui::Render();
+        const auto frame_end = std::chrono::steady_clock::now();
+
+        const ImDrawData* draw_data = ImGui::GetDrawData();
+        int command_count = 0;
+        for (int list_idx = 0; list_idx < draw_data->CmdListsCount; ++list_idx)
+            command_count += draw_data->CmdLists[list_idx]->CmdBuffer.Size;
+
+        return { std::chrono::duration<double, std::milli>(frame_end - frame_start).count(), draw_data->TotalVtxCount, draw_data->TotalIdxCount, command_count };
+    }
+
+    static void PrintStats(const char* name, std::vector<FrameStats>& frame_stats)
+    {
+        if (frame_stats.empty())
+            return;
+
+        double total_ms = 0.0;
+        for (const auto& stats : frame_stats)
+            total_ms += stats.FrameMs;
+
+        // Counts are from the last frame, they don't change once the scenario settled
+        const FrameStats last_frame = frame_stats.back();
+        std::sort(frame_stats.begin(), frame_stats.end(), [](const FrameStats& a, const FrameStats& b) { return a.FrameMs < b.FrameMs; });
+        std::printf("%-26s %8zu %9.3f %9.3f %9.3f %9.3f %9d %9d %7d\n", name, frame_stats.size(), total_ms / frame_stats.size(),
+                    frame_stats[frame_stats.size() / 2].FrameMs, frame_stats[(frame_stats.size() * 95) / 100].FrameMs, frame_stats.back().FrameMs,
+                    last_frame.VertexCount, last_frame.IndexCount, last_frame.CommandCount);
+    }
+};
+
+int main(int argc, char** argv)
+{
+    const int frame_count = argc > 1 ? std::max(1, std::atoi(argv[1])) : DefaultFrames;
+
+    RenderBenchmark benchmark(frame_count);
+    return benchmark.Run();
+}
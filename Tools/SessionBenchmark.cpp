@@ -0,0 +1,255 @@
+// Load benchmark of the session manager.
+// Opens many sessions, then has several threads play random moves, undos, redos and validations on random sessions
+// for a fixed time, and reports the throughput, the latency percentiles of every operation and the memory per session.
+// Ends with random moves played on a session and on an Instance side by side, compared after every move, undo and redo,
+// then a save of the session that is loaded back into an Instance and undone in both, to check that the two keep the
+// same digits and pencilmarks and stay save compatible.
+//
+// Build it with the sdq sources only, e.g.
+//     g++ -std=c++20 -O2 -fpermissive -ISudoku -ILibraries/include Tools/SessionBenchmark.cpp Sudoku/*.cpp -lboost_serialization -lpthread
+// Usage: SessionBenchmark [sessions] [threads] [seconds]
+// The save check writes its file in the temp directory, never in the working directory.
+
+#include "sdq_session.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr int    DefaultSessions = 10000;
+constexpr int    DefaultThreads  = 4;
+constexpr double DefaultSeconds  = 3.0;
+constexpr int    PuzzleCount     = 32;     // Distinct puzzles, shared round robin by the sessions
+constexpr int    SampleInterval  = 8;      // Every Nth operation of a thread is timed
+
+enum BenchOp_
+{
+    BenchOp_SetNumber  = 0,
+    BenchOp_Pencilmark = 1,
+    BenchOp_Undo       = 2,
+    BenchOp_Redo       = 3,
+    BenchOp_Validate   = 4,
+    BenchOp_COUNT
+};
+using BenchOp = int;
+
+constexpr std::array<const char*, BenchOp_COUNT> OpNames   = { "set number", "pencilmark", "undo", "redo", "validate" };
+constexpr std::array<int, BenchOp_COUNT>         OpWeights = { 50, 20, 15, 5, 10 };    // Out of 100
+
+struct ThreadStats
+{
+    uint64_t                                      Operations = 0;
+    std::array<std::vector<double>, BenchOp_COUNT> SampleUs;
+};
+
+double Percentile(const std::vector<double>& sorted_values, double percentile)
+{
+    if (sorted_values.empty())
+        return 0.0;
+
+    const size_t idx = static_cast<size_t>(percentile * static_cast<double>(sorted_values.size() - 1) + 0.5);
+    return sorted_values[std::min(idx, sorted_values.size() - 1)];
+}
+
+BenchOp PickOp(uint64_t roll)
+{
+    for (BenchOp op = 0; op < BenchOp_COUNT; ++op) {
+        if (roll < static_cast<uint64_t>(OpWeights[op]))
+            return op;
+        roll -= OpWeights[op];
+    }
+
+    return BenchOp_Validate;
+}
+
+void PlaySessions(sdq::session::SessionManager& manager, const std::vector<sdq::session::SessionId>& ids, uint64_t seed,
+                  const std::atomic<bool>& stop, ThreadStats& stats)
+{
+    sdq::Xoshiro256 rng(seed);
+    sdq::session::SessionState state;
+    while (!stop.load(std::memory_order_relaxed)) {
+        const auto    id    = ids[rng.NextBounded(ids.size())];
+        const BenchOp op    = PickOp(rng.NextBounded(100));
+        const int     row   = static_cast<int>(rng.NextBounded(9));
+        const int     col   = static_cast<int>(rng.NextBounded(9));
+        const int     digit = static_cast<int>(rng.NextBounded(9)) + 1;
+        const bool    timed = stats.Operations++ % SampleInterval == 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        switch (op) {
+        case BenchOp_SetNumber:  manager.SetNumber(id, row, col, digit);        break;
+        case BenchOp_Pencilmark: manager.TogglePencilmark(id, row, col, digit); break;
+        case BenchOp_Undo:       manager.Undo(id);                              break;
+        case BenchOp_Redo:       manager.Redo(id);                              break;
+        default:                 manager.Validate(id, state);                   break;
+        }
+        if (timed)
+            stats.SampleUs[op].push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+bool SameBoard(const sdq::Instance& instance, sdq::session::SessionManager& manager, sdq::session::SessionId id)
+{
+    sdq::save::SaveRecord instance_record, session_record;
+    instance.CreateSaveRecord(instance_record);
+    manager.GetSaveRecord(id, session_record);
+    return instance_record.PuzzleDigits == session_record.PuzzleDigits && instance_record.Pencilmarks == session_record.Pencilmarks;
+}
+
+// Plays the same random moves on a session and on an Instance opened from the same record, and compares the digits and
+// pencilmarks after every move, every undo and every redo. Then saves the session, loads it into a new Instance and
+// undoes everything in both, so the two stay save compatible
+bool CheckSaveCompatibility(sdq::session::SessionManager& manager, sdq::session::SessionId id)
+{
+    sdq::save::SaveRecord record;
+    sdq::Instance played;
+    if (manager.GetSaveRecord(id, record) != SessionResult_Ok || !played.LoadSaveRecord(record))
+        return false;
+
+    std::vector<int> puzzle_tiles;
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        if (sdq::save::IsBitmapSet(record.PuzzleTileBitmap, tile_idx))
+            puzzle_tiles.push_back(tile_idx);
+    }
+
+    sdq::Xoshiro256 rng(record.Header.Checksum);
+    int turns = 0;
+    while (turns < 60) {
+        const int tile_idx = puzzle_tiles[rng.NextBounded(puzzle_tiles.size())];
+        const int row = tile_idx / 9, col = tile_idx % 9;
+        const int number = static_cast<int>(rng.NextBounded(10));    // 0 clears the tile
+        if (number != 0 && rng.NextBounded(3) == 0) {
+            if (played.GetPuzzleBoard()->GetTile(row, col).Pencilmarks[number - 1])
+                played.AddPencilmark(row, col, number);
+            else
+                played.RemovePencilmark(row, col, number);
+            manager.TogglePencilmark(id, row, col, number);
+        }
+        else {
+            if (!played.SetTile(row, col, number))
+                continue;
+            manager.SetNumber(id, row, col, number);
+        }
+
+        ++turns;
+        if (!SameBoard(played, manager, id))
+            return false;
+    }
+
+    for (int turn = 0; turn < turns; ++turn) {
+        played.UndoTurn();
+        if (manager.Undo(id) != SessionResult_Ok || !SameBoard(played, manager, id))
+            return false;
+    }
+    for (int turn = 0; turn < turns; ++turn) {
+        played.RedoTurn();
+        if (manager.Redo(id) != SessionResult_Ok || !SameBoard(played, manager, id))
+            return false;
+    }
+
+    const std::string filepath = (std::filesystem::temp_directory_path() / "sdq session benchmark.sdq").string();
+    if (manager.SaveSession(id, filepath.c_str()) != SessionResult_Ok)
+        return false;
+
+    sdq::Instance instance;
+    const bool loaded = instance.LoadSudokuSave(filepath.c_str());
+    std::filesystem::remove(filepath);
+    if (!loaded || !SameBoard(instance, manager, id))
+        return false;
+
+    for (int turn = 0; turn < turns; ++turn) {
+        instance.UndoTurn();
+        if (manager.Undo(id) != SessionResult_Ok || !SameBoard(instance, manager, id))
+            return false;
+    }
+
+    sdq::save::SaveRecord session_record;
+    manager.GetSaveRecord(id, session_record);
+    return session_record.PuzzleDigits == record.PuzzleDigits && session_record.Pencilmarks == record.Pencilmarks;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const int    session_count = argc > 1 ? std::max(PuzzleCount, std::atoi(argv[1])) : DefaultSessions;
+    const int    thread_count  = argc > 2 ? std::max(1, std::atoi(argv[2])) : DefaultThreads;
+    const double seconds       = argc > 3 ? std::max(0.1, std::atof(argv[3])) : DefaultSeconds;
+
+    sdq::session::SessionManager manager;
+    std::vector<sdq::session::SessionId> ids;
+    ids.reserve(session_count);
+
+    // Generating is the Instance's cost, not the manager's, so only a few puzzles are generated and the rest are opened from their records
+    const auto generate_start = std::chrono::steady_clock::now();
+    std::vector<sdq::save::SaveRecord> records(PuzzleCount);
+    for (int idx = 0; idx < PuzzleCount; ++idx) {
+        ids.push_back(manager.CreateSession(SudokuDifficulty_Easy, static_cast<uint64_t>(idx + 1)));
+        if (ids.back() == sdq::session::InvalidSessionId || manager.GetSaveRecord(ids.back(), records[idx]) != SessionResult_Ok) {
+            std::printf("FAILED: couldn't create session %d\n", idx);
+            return EXIT_FAILURE;
+        }
+    }
+    const double generate_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - generate_start).count();
+
+    const auto open_start = std::chrono::steady_clock::now();
+    for (int idx = PuzzleCount; idx < session_count; ++idx)
+        ids.push_back(manager.OpenSession(records[idx % PuzzleCount]));
+    const double open_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - open_start).count();
+
+    std::printf("sessions %zu, %zu bytes per record, %.1f bytes per session with the slabs (an Instance is %zu bytes before its heap)\n",
+                manager.GetSessionCount(), sizeof(sdq::session::SessionRecord),
+                static_cast<double>(manager.GetSlabMemory()) / static_cast<double>(manager.GetSessionCount()), sizeof(sdq::Instance));
+    std::printf("generated %d sessions in %.2f ms, opened %d in %.2f ms (%.3f us each)\n", PuzzleCount, generate_ms, session_count - PuzzleCount,
+                open_ms, open_ms * 1000.0 / std::max(1, session_count - PuzzleCount));
+
+    std::atomic<bool> stop = false;
+    std::vector<ThreadStats> stats(thread_count);
+    std::vector<std::thread> threads;
+    for (int idx = 0; idx < thread_count; ++idx)
+        threads.emplace_back(PlaySessions, std::ref(manager), std::cref(ids), static_cast<uint64_t>(idx + 1), std::cref(stop), std::ref(stats[idx]));
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& thread : threads)
+        thread.join();
+
+    uint64_t operations = 0;
+    std::array<std::vector<double>, BenchOp_COUNT> samples;
+    for (const auto& thread_stats : stats) {
+        operations += thread_stats.Operations;
+        for (BenchOp op = 0; op < BenchOp_COUNT; ++op)
+            samples[op].insert(samples[op].end(), thread_stats.SampleUs[op].begin(), thread_stats.SampleUs[op].end());
+    }
+
+    std::printf("%d threads, %.1f s: %llu operations, %.0f per second\n", thread_count, seconds, static_cast<unsigned long long>(operations),
+                static_cast<double>(operations) / seconds);
+    std::printf("%-11s %9s %9s %9s %9s %9s\n", "operation", "samples", "p50 us", "p90 us", "p99 us", "max us");
+    for (BenchOp op = 0; op < BenchOp_COUNT; ++op) {
+        std::sort(samples[op].begin(), samples[op].end());
+        std::printf("%-11s %9zu %9.3f %9.3f %9.3f %9.3f\n", OpNames[op], samples[op].size(), Percentile(samples[op], 0.50),
+                    Percentile(samples[op], 0.90), Percentile(samples[op], 0.99), samples[op].empty() ? 0.0 : samples[op].back());
+    }
+
+    // A fresh session, so the random turns of the load phase don't get in the way of the check
+    const auto check_id = manager.OpenSession(records.front());
+    if (!CheckSaveCompatibility(manager, check_id)) {
+        std::printf("FAILED: a session and an Instance playing the same moves don't keep the same board and history\n");
+        return EXIT_FAILURE;
+    }
+
+    for (const auto id : ids)
+        manager.CloseSession(id);
+    manager.CloseSession(check_id);
+    std::printf("Save check passed, %zu sessions left after closing\n", manager.GetSessionCount());
+    return manager.GetSessionCount() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,151 @@
+// Headless startup benchmark, with the font atlas cache cold and warm.
+// Times what main.cpp does from launch to its first frame that doesn't need a window: the ImGui context and theme, the
+// fonts main.cpp adds, the atlas restored from "Fonts/font atlas.cache" or built and saved, the RGBA texture data the
+// OpenGL backend asks for on the first frame, the GameWindow, and the first frame itself. A cold launch deletes the
+// cache first, a warm one finds the cache the launch before it saved. Creating the window and the GL context and
+// uploading the texture don't depend on the cache, so the difference is the same as with them.
+//
+// Build it with the same sources as RenderBenchmark plus the atlas cache, e.g.
+//     g++ -std=c++20 -O2 -fpermissive -Iimgui -I"Window Helpers" -ISudoku -IFonts -ILibraries/include Tools/StartupBenchmark.cpp
+//         "Window Helpers/GameWindow.cpp" "Window Helpers/ImFunks.cpp" "Window Helpers/DirectoryScanner.cpp"
+//         "Window Helpers/FontAtlasCache.cpp" Sudoku/*.cpp imgui/imgui.cpp imgui/imgui_draw.cpp imgui/imgui_tables.cpp
+//         imgui/imgui_widgets.cpp -lboost_serialization -lpthread
+// Usage: StartupBenchmark [launches]
+// Needs the Fonts folder in the working directory. The launches run in a scratch folder under the temp directory.
+
+#include "GameWindow.h"
+#include "FontAtlasCache.h"
+#include "IconsFontAwesome5.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr ImVec2 DisplaySize     = ImVec2(785.0f, 507.0f);   // Same as the game window
+constexpr int    DefaultLaunches = 20;
+
+struct LaunchTimes
+{
+    double StartupMs;
+    double AtlasMs;
+};
+
+// The fonts of main.cpp, same files, sizes and settings, so the atlas cache key is the same too
+bool AddGameFonts(ImGuiIO& io, const std::string& dir)
+{
+    static const ImWchar icons_ranges[] = { ICON_MIN_FA, ICON_MAX_FA, 0 };
+    ImFontConfig icons_config;
+    icons_config.MergeMode   = true;
+    icons_config.PixelSnapH  = true;
+    icons_config.OversampleH = 2;
+    icons_config.OversampleV = 2;
+
+    for (const float font_size : { 15.0f, 18.0f, 22.0f }) {
+        if (io.Fonts->AddFontFromFileTTF((dir + "Quicksand-Medium.ttf").c_str(), font_size) == nullptr)
+            return false;
+        if (io.Fonts->AddFontFromFileTTF((dir + FONT_ICON_FILE_NAME_FAR).c_str(), font_size, &icons_config, icons_ranges) == nullptr)
+            return false;
+    }
+    return io.Fonts->AddFontDefault() != nullptr;
+}
+
+bool Launch(const std::string& font_dir, LaunchTimes& times)
+{
+    const auto startup_start = std::chrono::steady_clock::now();
+    ImGuiContext* imgui_context = ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize  = DisplaySize;
+    io.IniFilename  = nullptr;
+    io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+    ImGui::StyleColorsNewDark();
+
+    bool launched = AddGameFonts(io, font_dir);
+    if (launched) {
+        const std::string atlas_cache_filepath = font_dir + "font atlas.cache";
+        const auto atlas_start = std::chrono::steady_clock::now();
+        if (!FontAtlasCache::Load(io.Fonts, atlas_cache_filepath.c_str())) {
+            launched = io.Fonts->Build();
+            FontAtlasCache::Save(io.Fonts, atlas_cache_filepath.c_str());
+        }
+        times.AtlasMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - atlas_start).count();
+    }
+
+    if (launched) {
+        // What the OpenGL backend does before its first frame, minus the upload
+        unsigned char* pixels = nullptr;
+        int width = 0, height = 0;
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+        io.Fonts->SetTexID(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(1)));
+
+        GameWindow game_window;
+        ImGui::NewFrame();
+        game_window.RenderWindow();
+        ImGui::Render();
+        times.StartupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startup_start).count();
+    }
+
+    ImGui::DestroyContext(imgui_context);
+    return launched;
+}
+
+void PrintTimes(const char* name, std::vector<LaunchTimes>& launch_times)
+{
+    double startup_total = 0.0, atlas_total = 0.0;
+    for (const auto& times : launch_times) {
+        startup_total += times.StartupMs;
+        atlas_total   += times.AtlasMs;
+    }
+
+    std::sort(launch_times.begin(), launch_times.end(), [](const LaunchTimes& a, const LaunchTimes& b) { return a.StartupMs < b.StartupMs; });
+    std::printf("%-6s %9zu %11.2f %11.2f %11.2f %9.2f\n", name, launch_times.size(), startup_total / launch_times.size(),
+                launch_times[launch_times.size() / 2].StartupMs, launch_times.back().StartupMs, atlas_total / launch_times.size());
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const int launch_count = argc > 1 ? std::max(1, std::atoi(argv[1])) : DefaultLaunches;
+
+    const std::filesystem::path start_directory   = std::filesystem::current_path();
+    const std::filesystem::path scratch_directory = std::filesystem::temp_directory_path() / "sdq startup benchmark";
+    std::error_code error;
+    if (!std::filesystem::exists(start_directory / "Fonts" / "Quicksand-Medium.ttf", error)) {
+        std::printf("FAILED: the Fonts folder is not in the working directory\n");
+        return EXIT_FAILURE;
+    }
+    std::filesystem::remove_all(scratch_directory, error);
+    std::filesystem::create_directories(scratch_directory, error);
+    std::filesystem::copy(start_directory / "Fonts", scratch_directory / "Fonts", std::filesystem::copy_options::recursive, error);
+    std::filesystem::current_path(scratch_directory, error);
+
+    // Cold and warm launches take turns, so both see the same state of the machine
+    const std::string font_dir = (std::filesystem::path("Fonts") / "").string();
+    std::vector<LaunchTimes> cold_times, warm_times;
+    bool launched = true;
+    for (int launch = 0; launch < launch_count && launched; ++launch) {
+        std::filesystem::remove(font_dir + "font atlas.cache", error);
+        LaunchTimes cold, warm;
+        launched = Launch(font_dir, cold) && Launch(font_dir, warm);
+        cold_times.push_back(cold);
+        warm_times.push_back(warm);
+    }
+
+    std::filesystem::current_path(start_directory, error);
+    std::filesystem::remove_all(scratch_directory, error);
+    if (!launched) {
+        std::printf("FAILED: a launch could not load the fonts\n");
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%-6s %9s %11s %11s %11s %9s\n", "cache", "launches", "avg ms", "p50 ms", "max ms", "atlas ms");
+    PrintTimes("cold", cold_times);
+    PrintTimes("warm", warm_times);
+    return EXIT_SUCCESS;
+}
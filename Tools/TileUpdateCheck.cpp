@@ -0,0 +1,210 @@
+// Equivalence check of GameBoard::UpdateTileNumber.
+// Plays random sets, clears and pencilmark edits on random puzzles, including numbers that break the rules, and
+// after every move compares the incremental board against two references:
+//   - a board that takes the same moves through the full update SetTile used before, a complete occurrence rebuild
+//     and a pencilmark pass over the puzzle tiles, which has to match tile for tile, pencilmarks included
+//   - a board rebuilt from scratch out of the digits, whose occurrence masks have to match, and whose pencilmarks
+//     have to match on every empty tile whose pencilmarks only ever followed the rules. Tiles filled or edited by
+//     hand keep their own pencilmarks, and overwriting a number leaves the old one ruled out in the peers, as SetTile
+//     always did, so those tiles are left to the first comparison
+// Also reports the time per move of both updates.
+//
+// Build it with the sdq sources only, e.g.
+//     g++ -std=c++20 -O2 -fpermissive -ISudoku -ILibraries/include Tools/TileUpdateCheck.cpp Sudoku/*.cpp -lboost_serialization -lpthread
+// Usage: TileUpdateCheck [boards] [moves per board] [seed]
+// Without NDEBUG the incremental update also asserts its masks against a rebuild after every move, so time it with -DNDEBUG.
+
+#include "sdq_grids.h"
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+constexpr int      DefaultBoards   = 2000;
+constexpr int      DefaultMoves    = 500;
+constexpr uint64_t DefaultSeed     = 1;
+constexpr int      MinBlankTiles   = 30;
+constexpr int      MaxBlankTiles   = 64;
+
+using BoardDigits = std::array<std::array<int, 9>, 9>;
+
+struct Move
+{
+    int Row;
+    int Col;
+    int Number;        // 0 clears the tile
+    int Pencilmark;    // 1-9 flips that pencilmark instead of setting the number
+};
+
+// The update SetTile, undo and redo did before UpdateTileNumber
+void FullUpdate(sdq::GameBoard& board, int row, int col, int number)
+{
+    auto& tile = board.GetTile(row, col);
+    if (tile.TileNumber == number)
+        return;
+
+    tile.SetTileNumber(number);
+    board.UpdateBoardOccurences();
+    if (number != 0)
+        board.UpdateRemovePencilMarks(row, col);
+    else
+        board.UpdateReapplyPencilMarks(row, col);
+}
+
+void CreatePuzzle(sdq::Xoshiro256& rng, sdq::GameBoard& filled, BoardDigits& digits)
+{
+    sdq::grids::FillRandomBoard(filled, rng);
+    for (int row = 0; row < 9; ++row)
+        for (int col = 0; col < 9; ++col)
+            digits[row][col] = filled.GetTile(row, col).TileNumber;
+
+    std::array<int, 81> tiles;
+    for (int idx = 0; idx < 81; ++idx)
+        tiles[idx] = idx;
+    const int blank_tiles = MinBlankTiles + static_cast<int>(rng.NextBounded(MaxBlankTiles - MinBlankTiles + 1));
+    for (int idx = 0; idx < blank_tiles; ++idx) {
+        std::swap(tiles[idx], tiles[idx + rng.NextBounded(81 - idx)]);
+        digits[tiles[idx] / 9][tiles[idx] % 9] = 0;
+    }
+}
+
+void CreateBoard(const BoardDigits& digits, sdq::GameBoard& board)
+{
+    board.CreateSudokuBoard(digits);
+    board.ResetAllPencilMarks();
+}
+
+// Empty string if the boards match, else what differs first
+const char* CompareBoards(const sdq::GameBoard& incremental, const sdq::GameBoard& full, const std::bitset<81>& edited_tiles, int& tile_idx)
+{
+    tile_idx = -1;
+    if (!(incremental.BoardOccurences == full.BoardOccurences))
+        return "occurrence masks differ from the full update";
+
+    for (tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        const auto& tile      = incremental.GetTile(tile_idx / 9, tile_idx % 9);
+        const auto& full_tile = full.GetTile(tile_idx / 9, tile_idx % 9);
+        if (tile.TileNumber != full_tile.TileNumber)
+            return "digits differ from the full update";
+        if (tile.Pencilmarks != full_tile.Pencilmarks)
+            return "pencilmarks differ from the full update";
+    }
+
+    BoardDigits digits;
+    for (int row = 0; row < 9; ++row)
+        for (int col = 0; col < 9; ++col)
+            digits[row][col] = incremental.GetTile(row, col).TileNumber;
+
+    sdq::GameBoard rebuilt;
+    CreateBoard(digits, rebuilt);
+    tile_idx = -1;
+    if (!(incremental.BoardOccurences == rebuilt.BoardOccurences))
+        return "occurrence masks differ from a rebuilt board";
+
+    for (tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        const auto& tile = incremental.GetTile(tile_idx / 9, tile_idx % 9);
+        if (!tile.IsTileFilled() && !edited_tiles[tile_idx] && tile.Pencilmarks != rebuilt.GetTile(tile_idx / 9, tile_idx % 9).Pencilmarks)
+            return "pencilmarks differ from a rebuilt board";
+    }
+
+    return "";
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const int      board_count = argc > 1 ? std::max(1, std::atoi(argv[1])) : DefaultBoards;
+    const int      move_count  = argc > 2 ? std::max(1, std::atoi(argv[2])) : DefaultMoves;
+    const uint64_t seed        = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : DefaultSeed;
+
+    sdq::Xoshiro256 rng(seed);
+    sdq::GameBoard  filled, incremental, full;
+    BoardDigits     digits;
+    std::vector<Move> moves(move_count);
+    double incremental_ns = 0.0, full_ns = 0.0;
+    uint64_t sets = 0, clears = 0, pencilmark_edits = 0;
+
+    for (int board_idx = 0; board_idx < board_count; ++board_idx) {
+        CreatePuzzle(rng, filled, digits);
+        CreateBoard(digits, incremental);
+        CreateBoard(digits, full);
+
+        std::vector<int> puzzle_tiles;
+        for (int idx = 0; idx < 81; ++idx)
+            if (digits[idx / 9][idx % 9] == 0)
+                puzzle_tiles.push_back(idx);
+
+        // Mostly the solution digit, so the boards fill up, the rest any number or a clear
+        for (auto& move : moves) {
+            const int tile_idx = puzzle_tiles[rng.NextBounded(puzzle_tiles.size())];
+            move.Row = tile_idx / 9;
+            move.Col = tile_idx % 9;
+            const auto kind = rng.NextBounded(10);
+            move.Pencilmark = kind == 0 ? 1 + static_cast<int>(rng.NextBounded(9)) : 0;
+            move.Number     = kind < 6 ? filled.GetTile(move.Row, move.Col).TileNumber : (kind < 8 ? 0 : 1 + static_cast<int>(rng.NextBounded(9)));
+        }
+
+        // Timed on copies of the run, without the comparisons
+        sdq::GameBoard timed_incremental(incremental), timed_full(full);
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& move : moves)
+            if (move.Pencilmark == 0)
+                timed_incremental.UpdateTileNumber(move.Row, move.Col, move.Number);
+        incremental_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        for (const auto& move : moves)
+            if (move.Pencilmark == 0)
+                FullUpdate(timed_full, move.Row, move.Col, move.Number);
+        full_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        std::bitset<81> edited_tiles;
+        for (int move_idx = 0; move_idx < move_count; ++move_idx) {
+            const auto& move = moves[move_idx];
+            const int tile_idx = move.Row * 9 + move.Col;
+            if (move.Pencilmark != 0) {
+                incremental.GetTile(move.Row, move.Col).Pencilmarks.flip(move.Pencilmark - 1);
+                full.GetTile(move.Row, move.Col).Pencilmarks.flip(move.Pencilmark - 1);
+                edited_tiles.set(tile_idx);
+                ++pencilmark_edits;
+            }
+            else {
+                const int prev_num = incremental.GetTile(move.Row, move.Col).TileNumber;
+                if (move.Number != 0)
+                    edited_tiles.set(tile_idx);
+                if (prev_num != 0 && move.Number != 0 && prev_num != move.Number)
+                    for (const auto peer_idx : sdq::helpers::GetPeers(move.Row, move.Col))
+                        edited_tiles.set(peer_idx);
+                move.Number != 0 ? ++sets : ++clears;
+                incremental.UpdateTileNumber(move.Row, move.Col, move.Number);
+                FullUpdate(full, move.Row, move.Col, move.Number);
+            }
+
+            int failed_tile = -1;
+            const char* failure = CompareBoards(incremental, full, edited_tiles, failed_tile);
+            if (failure[0] != '\0') {
+                std::printf("FAILED on board %d, move %d (tile %c%d, number %d, pencilmark %d): %s", board_idx, move_idx, 'A' + move.Row,
+                            move.Col + 1, move.Number, move.Pencilmark, failure);
+                if (failed_tile >= 0)
+                    std::printf(" at tile %c%d", 'A' + failed_tile / 9, failed_tile % 9 + 1);
+                std::printf("\n");
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    const double updates = static_cast<double>(sets + clears);
+    std::printf("%d boards, %d moves each, seed %llu: %llu sets, %llu clears, %llu pencilmark edits\n", board_count, move_count,
+                static_cast<unsigned long long>(seed), static_cast<unsigned long long>(sets), static_cast<unsigned long long>(clears),
+                static_cast<unsigned long long>(pencilmark_edits));
+    std::printf("incremental update %8.1f ns per move\n", incremental_ns / updates);
+    std::printf("full update        %8.1f ns per move\n", full_ns / updates);
+    std::printf("\nEvery move matched the full update and a rebuilt board\n");
+    return EXIT_SUCCESS;
+}
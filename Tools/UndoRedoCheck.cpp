@@ -0,0 +1,554 @@
+// Randomized undo/redo check of the turn log.
+// Plays random moves on seeded puzzles: numbers, clears, pencilmark edits, clearing and resetting every pencilmark,
+// committed and rolled back transactions, random runs of undos and redos, now and then a save and a load of the game
+// into a new Instance, and a full undo back to the start and a full redo to the end. After every one of them the game
+// has to match a reference game that keeps its undo steps as plain lists of turns and applies them to a copy of the
+// board with the same rules, tile for tile, pencilmarks included, and:
+//   - every undo has to give back the digits of the earlier board and every redo the digits of the later one
+//   - undo and redo are offered exactly while there is an earlier or a later board, and an empty transaction keeps
+//     the redo history
+// A turn records the pencilmarks of its own tile only. The peers of an undone number follow the set and clear rules
+// again, so they only come back exactly if they never drifted from the rules, and the number of undos that gave back
+// the whole earlier board is reported rather than checked.
+// Then plays random turns and groups straight into a turn log with room for two chunks, so the oldest turns are
+// dropped over and over, and checks every undo and redo tile, the groups, and a save of the history against a list.
+//
+// Build it with the sdq sources only, e.g.
+//     g++ -std=c++20 -O2 -fpermissive -ISudoku -ILibraries/include Tools/UndoRedoCheck.cpp Sudoku/*.cpp -lboost_serialization -lpthread
+// Usage: UndoRedoCheck [puzzles] [moves per puzzle] [seed]
+// The reload writes its file in the temp directory, never in the working directory.
+
+#include "sdq.h"
+#include "sdq_save.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr int      DefaultPuzzles = 50;
+constexpr int      DefaultMoves   = 2000;
+constexpr uint64_t DefaultSeed    = 1;
+constexpr int      RingOperations = 20000;
+constexpr size_t   RingMemoryCap  = 2 * sdq::TurnLog::ChunkTurns * sizeof(uint32_t);
+
+using Turn = sdq::TurnLog::TurnTile;
+using Step = std::vector<Turn>;
+
+struct BoardState
+{
+    std::array<uint8_t, 81>  Digits;
+    std::array<uint16_t, 81> Pencilmarks;
+
+    bool operator == (const BoardState& other) const noexcept
+    {
+        return Digits == other.Digits && Pencilmarks == other.Pencilmarks;
+    }
+};
+
+BoardState GetBoardState(const sdq::GameBoard& board)
+{
+    BoardState state;
+    for (int tile_idx = 0; tile_idx < 81; ++tile_idx) {
+        const auto& tile = board.GetTile(tile_idx / 9, tile_idx % 9);
+        state.Digits[tile_idx]      = static_cast<uint8_t>(tile.TileNumber);
+        state.Pencilmarks[tile_idx] = static_cast<uint16_t>(tile.Pencilmarks.to_ulong());
+    }
+    return state;
+}
+
+bool SameTurn(const std::optional<Turn>& turn, const Turn& expected)
+{
+    return turn.has_value() && turn->Row == expected.Row && turn->Column == expected.Column && turn->PreviousNumber == expected.PreviousNumber &&
+           turn->NextNumber == expected.NextNumber && turn->PreviousPencilmark == expected.PreviousPencilmark &&
+           turn->NextPencilmark == expected.NextPencilmark && turn->Linked == expected.Linked;
+}
+
+// The moves of an Instance with its undo steps kept as plain lists of turns
+class ReferenceGame
+{
+private:
+    sdq::GameBoard    Board;
+    std::vector<Step> Steps;
+    Step              Group;
+    bool              GroupOpen = false;
+
+public:
+    size_t Position = 0;
+
+    explicit ReferenceGame(const sdq::GameBoard& board) : Board(board) {}
+
+    const sdq::GameBoard& GetBoard() const noexcept { return Board; }
+    size_t GetStepCount() const noexcept { return Steps.size(); }
+
+    void SetTile(int row, int col, int number)
+    {
+        auto& tile = Board.GetTile(row, col);
+        if (tile.TileNumber == number)
+            return;
+
+        this->AddTurn(Turn(row, col, tile.TileNumber, number, tile.Pencilmarks, tile.Pencilmarks));
+        Board.UpdateTileNumber(row, col, number);
+    }
+
+    void SetPencilmark(int row, int col, int number, bool ruled_out)
+    {
+        auto& tile = Board.GetTile(row, col);
+        const auto previous_pm = tile.Pencilmarks;
+        tile.Pencilmarks.set(number - 1, ruled_out);
+        this->AddTurn(Turn(row, col, tile.TileNumber, tile.TileNumber, previous_pm, tile.Pencilmarks));
+    }
+
+    void SetAllPencilmarks(bool reset)
+    {
+        std::vector<std::bitset<9>> previous_pms;
+        for (const auto* tile : Board.PuzzleTiles)
+            previous_pms.push_back(tile->Pencilmarks);
+
+        if (reset)
+            Board.ResetAllPencilMarks();
+        else
+            for (auto* tile : Board.PuzzleTiles)
+                tile->Pencilmarks.set();
+
+        this->BeginGroup();
+        for (size_t idx = 0; idx < Board.PuzzleTiles.size(); ++idx) {
+            const auto* tile = Board.PuzzleTiles[idx];
+            if (tile->Pencilmarks != previous_pms[idx])
+                this->AddTurn(Turn(tile->Row, tile->Column, tile->TileNumber, tile->TileNumber, previous_pms[idx], tile->Pencilmarks));
+        }
+        this->CommitGroup();
+    }
+
+    void BeginGroup()
+    {
+        GroupOpen = true;
+        Group.clear();
+    }
+
+    void CommitGroup()
+    {
+        GroupOpen = false;
+        if (!Group.empty()) {
+            Steps.push_back(Group);
+            ++Position;
+        }
+    }
+
+    void RollbackGroup()
+    {
+        GroupOpen = false;
+        for (auto turn = Group.rbegin(); turn != Group.rend(); ++turn)
+            this->UndoTurn(*turn);
+    }
+
+    void Undo()
+    {
+        if (Position == 0)
+            return;
+
+        const auto& step = Steps[--Position];
+        for (auto turn = step.rbegin(); turn != step.rend(); ++turn)
+            this->UndoTurn(*turn);
+    }
+
+    void Redo()
+    {
+        if (Position == Steps.size())
+            return;
+
+        for (const auto& turn : Steps[Position++]) {
+            auto& tile = Board.GetTile(turn.Row, turn.Column);
+            if (tile.TileNumber == turn.NextNumber)
+                tile.Pencilmarks = turn.NextPencilmark;
+            else
+                Board.UpdateTileNumber(turn.Row, turn.Column, turn.NextNumber);
+        }
+    }
+
+private:
+    // The first turn of a step drops the redo tail, even if its group is rolled back later
+    void AddTurn(const Turn& turn)
+    {
+        if (!GroupOpen || Group.empty())
+            Steps.resize(Position);
+
+        if (GroupOpen)
+            Group.push_back(turn);
+        else {
+            Steps.push_back({ turn });
+            ++Position;
+        }
+    }
+
+    void UndoTurn(const Turn& turn)
+    {
+        Board.UpdateTileNumber(turn.Row, turn.Column, turn.PreviousNumber);
+        Board.GetTile(turn.Row, turn.Column).Pencilmarks = turn.PreviousPencilmark;
+    }
+};
+
+class UndoRedoRun
+{
+private:
+    sdq::Instance&          Game;
+    sdq::Xoshiro256&        Rng;
+    ReferenceGame           Reference;
+    std::vector<BoardState> Boards;    // The board each undo step was left with, Boards[0] the start
+    std::vector<int>        PuzzleTiles;
+    const std::string&      ReloadPath;
+    std::string             FailureText;
+    const char*             Failure = nullptr;
+
+public:
+    uint64_t Moves       = 0;
+    uint64_t Undos       = 0;
+    uint64_t ExactUndos  = 0;
+    uint64_t Redos       = 0;
+    uint64_t Reloads     = 0;
+
+    UndoRedoRun(sdq::Instance& game, sdq::Xoshiro256& rng, const std::string& reload_path)
+        : Game(game), Rng(rng), Reference(*game.GetPuzzleBoard()), ReloadPath(reload_path)
+    {
+        for (const auto* tile : Game.GetPuzzleBoard()->PuzzleTiles)
+            PuzzleTiles.push_back(tile->Row * 9 + tile->Column);
+        Boards.push_back(GetBoardState(*Game.GetPuzzleBoard()));
+    }
+
+    const char* GetFailure() const noexcept { return Failure; }
+    size_t GetStepCount() const noexcept { return Reference.GetStepCount(); }
+    size_t GetPosition() const noexcept { return Reference.Position; }
+
+    void PlayMove()
+    {
+        const size_t position = Reference.Position;
+        const int tile_idx = PuzzleTiles[Rng.NextBounded(PuzzleTiles.size())];
+        const int row = tile_idx / 9, col = tile_idx % 9;
+        const int number = 1 + static_cast<int>(Rng.NextBounded(9));
+        switch (Rng.NextBounded(16))
+        {
+        case 0: case 1: case 2: case 3: case 4: case 5:
+            Game.SetTile(row, col, number);
+            Reference.SetTile(row, col, number);
+            break;
+        case 6: case 7:
+            Game.ResetTile(row, col);
+            Reference.SetTile(row, col, 0);
+            break;
+        case 8: case 9:
+            Game.RemovePencilmark(row, col, number);
+            Reference.SetPencilmark(row, col, number, true);
+            break;
+        case 10: case 11:
+            Game.AddPencilmark(row, col, number);
+            Reference.SetPencilmark(row, col, number, false);
+            break;
+        case 12:
+            Game.ClearAllPencilmarks();
+            Reference.SetAllPencilmarks(false);
+            break;
+        case 13:
+            Game.ResetAllPencilmarks();
+            Reference.SetAllPencilmarks(true);
+            break;
+        default:
+        {
+            // A few moves as one step, or rolled back to nothing. Sometimes none at all
+            const bool rollback = Rng.NextBounded(4) == 0;
+            Game.BeginTransaction();
+            Reference.BeginGroup();
+            for (int move = static_cast<int>(Rng.NextBounded(5)); move > 0; --move) {
+                const int group_tile   = PuzzleTiles[Rng.NextBounded(PuzzleTiles.size())];
+                const int group_number = static_cast<int>(Rng.NextBounded(10));
+                Game.SetTile(group_tile / 9, group_tile % 9, group_number);
+                Reference.SetTile(group_tile / 9, group_tile % 9, group_number);
+            }
+            rollback ? Game.RollbackTransaction() : Game.CommitTransaction();
+            rollback ? Reference.RollbackGroup() : Reference.CommitGroup();
+            break;
+        }
+        }
+        ++Moves;
+
+        // A rolled back transaction can drop the redo boards without adding one
+        Boards.resize(Reference.Position != position ? position + 1 : Reference.GetStepCount() + 1);
+        if (Reference.Position != position)
+            Boards.push_back(GetBoardState(Reference.GetBoard()));
+        this->Compare("a move");
+    }
+
+    void Undo()
+    {
+        const bool can_undo = Reference.Position > 0;
+        Game.UndoTurn();
+        Reference.Undo();
+        if (!this->Compare("an undo") || !can_undo)
+            return;
+
+        ++Undos;
+        const BoardState board = GetBoardState(*Game.GetPuzzleBoard());
+        if (board.Digits != Boards[Reference.Position].Digits)
+            Failure = "undo did not restore the digits of the earlier board";
+        ExactUndos += board == Boards[Reference.Position];
+    }
+
+    void Redo()
+    {
+        const bool can_redo = Reference.Position < Reference.GetStepCount();
+        Game.RedoTurn();
+        Reference.Redo();
+        if (!this->Compare("a redo") || !can_redo)
+            return;
+
+        ++Redos;
+        if (GetBoardState(*Game.GetPuzzleBoard()).Digits != Boards[Reference.Position].Digits)
+            Failure = "redo did not replay the digits of the later board";
+    }
+
+    // The saved history has to undo and redo the same as the live one
+    void Reload()
+    {
+        if (!Game.SaveCurrentProgress(ReloadPath.c_str())) {
+            Failure = "the game could not be saved";
+            return;
+        }
+
+        sdq::Instance loaded;
+        if (!loaded.LoadSudokuSave(ReloadPath.c_str())) {
+            Failure = "the saved game could not be loaded";
+            return;
+        }
+
+        Game = std::move(loaded);
+        ++Reloads;
+        this->Compare("a reload");
+    }
+
+    void RandomRun()
+    {
+        const int steps = 1 + static_cast<int>(Rng.NextBounded(8));
+        const bool undo = Rng.NextBounded(2) == 0;
+        for (int step = 0; step < steps && Failure == nullptr; ++step)
+            undo ? this->Undo() : this->Redo();
+    }
+
+    void UndoAll()
+    {
+        while (Reference.Position > 0 && Failure == nullptr)
+            this->Undo();
+        if (Failure == nullptr)
+            this->Undo();
+    }
+
+    void RedoAll()
+    {
+        while (Reference.Position < Reference.GetStepCount() && Failure == nullptr)
+            this->Redo();
+        if (Failure == nullptr)
+            this->Redo();
+    }
+
+private:
+    bool Compare(const char* action)
+    {
+        if (Failure != nullptr)
+            return false;
+
+        if (!(GetBoardState(*Game.GetPuzzleBoard()) == GetBoardState(Reference.GetBoard())))
+            FailureText = std::string(action) + " left a board different from the reference";
+        else if (Game.GetTurnLogs()->CanUndo() != (Reference.Position > 0))
+            FailureText = std::string(action) + " left undo " + (Reference.Position > 0 ? "unavailable" : "offered past the first board");
+        else if (Game.GetTurnLogs()->CanRedo() != (Reference.Position < Reference.GetStepCount()))
+            FailureText = std::string(action) + " left redo " + (Reference.Position < Reference.GetStepCount() ? "unavailable" : "offered past the last board");
+        else
+            return true;
+
+        Failure = FailureText.c_str();
+        return false;
+    }
+};
+
+// Random turns and groups straight into a log that drops its oldest turns, against the steps it should keep
+const char* CheckTurnLogRing(sdq::Xoshiro256& rng, uint64_t& dropped_turns)
+{
+    sdq::TurnLog      log(RingMemoryCap);
+    std::deque<Step>  steps;
+    size_t            position = 0, turn_count = 0;
+    const size_t      capacity = RingMemoryCap / sizeof(uint32_t);
+
+    const auto random_turn = [&rng](bool linked) {
+        const int row = static_cast<int>(rng.NextBounded(9)), col = static_cast<int>(rng.NextBounded(9));
+        const int number = static_cast<int>(rng.NextBounded(10));
+        const std::bitset<9> pencilmarks(rng.NextBounded(512));
+        if (rng.NextBounded(2) == 0)
+            return Turn(row, col, number, (number + 1 + static_cast<int>(rng.NextBounded(9))) % 10, pencilmarks, pencilmarks, linked);
+        return Turn(row, col, number, number, pencilmarks, pencilmarks ^ std::bitset<9>(1 + rng.NextBounded(511)), linked);
+    };
+
+    const auto drop_redo_tail = [&]() {
+        for (size_t step_idx = position; step_idx < steps.size(); ++step_idx)
+            turn_count -= steps[step_idx].size();
+        steps.resize(position);
+    };
+    // The full log gives the slot of its oldest turn to the next one, even if that splits the oldest step
+    const auto push_turn = [&](Step& step, const Turn& turn) {
+        if (turn_count == capacity) {
+            auto& oldest = steps.empty() ? step : steps.front();
+            oldest.erase(oldest.begin());
+            if (oldest.empty() && &oldest != &step) {
+                steps.pop_front();
+                --position;
+            }
+            --turn_count;
+            ++dropped_turns;
+        }
+        step.push_back(turn);
+        ++turn_count;
+        log.Add(turn.Row, turn.Column, turn.PreviousNumber, turn.NextNumber, turn.PreviousPencilmark, turn.NextPencilmark);
+    };
+
+    for (int op = 0; op < RingOperations; ++op) {
+        const auto action = rng.NextBounded(10);
+        if (action < 5) {
+            // A single turn, or a group of up to 5 that is sometimes rolled back
+            const bool group    = action >= 3;
+            const bool rollback = group && rng.NextBounded(4) == 0;
+            const int  turns    = group ? static_cast<int>(rng.NextBounded(6)) : 1;
+            Step step;
+            if (group)
+                log.BeginGroup();
+            for (int turn_idx = 0; turn_idx < turns; ++turn_idx) {
+                if (turn_idx == 0)
+                    drop_redo_tail();
+                push_turn(step, random_turn(turn_idx > 0));
+            }
+            if (rollback) {
+                if (log.GetGroupTurnCount() != step.size())
+                    return "the open group has the wrong number of turns";
+                for (size_t turn_idx = step.size(); turn_idx > 0; --turn_idx)
+                    log.Undo();
+                log.RollbackGroup();
+                turn_count -= step.size();
+                step.clear();
+            }
+            else if (group)
+                log.CommitGroup();
+            if (!step.empty()) {
+                steps.push_back(step);
+                ++position;
+            }
+        }
+        else if (action < 8) {
+            // Undo a step the way Instance does, turn by turn until the first one that is not linked
+            if (position > 0) {
+                const auto& step = steps[--position];
+                for (size_t turn_idx = step.size(); turn_idx > 0; --turn_idx) {
+                    if (!SameTurn(log.GetUndoTile(), step[turn_idx - 1]))
+                        return "an undo tile differs from the turn that was added";
+                    log.Undo();
+                }
+            }
+        }
+        else if (position < steps.size()) {
+            for (const auto& turn : steps[position]) {
+                if (!SameTurn(log.GetRedoTile(), turn))
+                    return "a redo tile differs from the turn that was added";
+                log.Redo();
+            }
+            if (log.GetRedoTile().has_value() && log.GetRedoTile()->Linked)
+                return "a redo step runs into the next one";
+            ++position;
+        }
+
+        if (log.CanUndo() != (position > 0) || log.CanRedo() != (position < steps.size()))
+            return "undo or redo is offered when it should not be, or not offered when it should";
+
+        // Now and then the saved history has to come back the same
+        if (rng.NextBounded(64) == 0) {
+            sdq::save::TurnHistory history;
+            log.ExportHistory(history);
+            sdq::TurnLog loaded(RingMemoryCap);
+            if (!loaded.ImportHistory(history) || history.Turns.size() != turn_count)
+                return "the saved history could not be loaded back";
+            sdq::save::TurnHistory loaded_history;
+            loaded.ExportHistory(loaded_history);
+            if (loaded_history.Turns != history.Turns || loaded_history.UndoPosition != history.UndoPosition)
+                return "the loaded history differs from the saved one";
+            log = loaded;
+        }
+    }
+
+    return nullptr;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const int      puzzle_count = argc > 1 ? std::max(1, std::atoi(argv[1])) : DefaultPuzzles;
+    const int      move_count   = argc > 2 ? std::max(1, std::atoi(argv[2])) : DefaultMoves;
+    const uint64_t seed         = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : DefaultSeed;
+
+    const std::string reload_path = (std::filesystem::temp_directory_path() / "sdq undo redo check.sdq").string();
+    sdq::Xoshiro256 rng(seed);
+    uint64_t moves = 0, undos = 0, exact_undos = 0, redos = 0, reloads = 0, steps = 0;
+
+    for (int puzzle_idx = 0; puzzle_idx < puzzle_count; ++puzzle_idx) {
+        sdq::Instance game;
+        if (!game.CreateSudoku(SudokuDifficulty_Easy, seed + puzzle_idx)) {
+            std::printf("FAILED: puzzle %d could not be created\n", puzzle_idx);
+            return EXIT_FAILURE;
+        }
+
+        UndoRedoRun run(game, rng, reload_path);
+        for (int move = 0; move < move_count && run.GetFailure() == nullptr; ++move) {
+            const auto action = rng.NextBounded(20);
+            if (action < 3)
+                run.RandomRun();
+            else if (action == 3)
+                run.Reload();
+            else
+                run.PlayMove();
+        }
+        if (run.GetFailure() == nullptr)
+            run.UndoAll();
+        if (run.GetFailure() == nullptr)
+            run.RedoAll();
+
+        if (run.GetFailure() != nullptr) {
+            std::printf("FAILED on puzzle %d (seed %llu) at step %zu of %zu: %s\n", puzzle_idx, static_cast<unsigned long long>(seed + puzzle_idx),
+                        run.GetPosition(), run.GetStepCount(), run.GetFailure());
+            std::filesystem::remove(reload_path);
+            return EXIT_FAILURE;
+        }
+
+        moves += run.Moves;
+        undos += run.Undos;
+        exact_undos += run.ExactUndos;
+        redos += run.Redos;
+        reloads += run.Reloads;
+        steps += run.GetStepCount();
+    }
+    std::filesystem::remove(reload_path);
+
+    uint64_t dropped_turns = 0;
+    const char* ring_failure = CheckTurnLogRing(rng, dropped_turns);
+    if (ring_failure != nullptr) {
+        std::printf("FAILED in the bounded turn log: %s\n", ring_failure);
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%d puzzles, seed %llu: %llu moves, %llu undo steps kept, %llu undos, %llu redos, %llu reloads\n", puzzle_count,
+                static_cast<unsigned long long>(seed), static_cast<unsigned long long>(moves), static_cast<unsigned long long>(steps),
+                static_cast<unsigned long long>(undos), static_cast<unsigned long long>(redos), static_cast<unsigned long long>(reloads));
+    std::printf("%llu undos (%.1f%%) gave back the whole earlier board, the rest its digits and the pencilmarks the turns recorded\n",
+                static_cast<unsigned long long>(exact_undos), undos > 0 ? 100.0 * exact_undos / undos : 100.0);
+    std::printf("bounded turn log: %d operations, %llu turns dropped\n", RingOperations, static_cast<unsigned long long>(dropped_turns));
+    std::printf("\nEvery undo and redo matched the reference game\n");
+    return EXIT_SUCCESS;
+}
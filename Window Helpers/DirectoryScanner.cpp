@@ -0,0 +1,359 @@
+#include "DirectoryScanner.h"
+#include <chrono>
+#include <filesystem>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+// Entries found by the full scan are handed to the UI thread in batches of this size
+constexpr size_t ScanBatchSize = 64;
+// How often the watcher checks if it should stop or rescan
+constexpr int WatchTimeoutMs = 100;
+}
+
+DirectoryScanner::DirectoryScanner() noexcept :
+	StopWorker(false),
+	RescanRequested(false),
+	Scanning(false)
+{
+}
+
+DirectoryScanner::~DirectoryScanner()
+{
+	Stop();
+}
+
+void DirectoryScanner::Start(const std::string& directory_name)
+{
+	Stop();
+
+	DirectoryName = directory_name;
+	StopWorker.store(false);
+	RescanRequested.store(false);
+	Scanning.store(true);
+	Worker = std::thread(&DirectoryScanner::WorkerLoop, this);
+}
+
+void DirectoryScanner::Stop()
+{
+	StopWorker.store(true);
+	if (Worker.joinable())
+		Worker.join();
+
+	std::lock_guard changes_guard(ChangesMutex);
+	PendingChanges.clear();
+	Scanning.store(false);
+}
+
+void DirectoryScanner::Rescan() noexcept
+{
+	RescanRequested.store(true);
+}
+
+bool DirectoryScanner::Poll()
+{
+	{
+		std::lock_guard changes_guard(ChangesMutex);
+		if (PendingChanges.empty())
+			return false;
+
+		// Both buffers keep their capacity, so steady state polling never allocates
+		std::swap(PendingChanges, AppliedChanges);
+	}
+
+	bool indices_invalidated = false;
+	for (auto& change : AppliedChanges) {
+		switch (change.Type)
+		{
+		case DirectoryChangeType_Reset:
+			Entries.clear();
+			EntryIndices.clear();
+			indices_invalidated = true;
+			break;
+		case DirectoryChangeType_Update:
+		{
+			const auto found = EntryIndices.find(change.Entry.Directory);
+			if (found != EntryIndices.end())
+				Entries[found->second].DateTime = change.Entry.DateTime;
+			else {
+				EntryIndices.emplace(change.Entry.Directory, Entries.size());
+				Entries.push_back(std::move(change.Entry));
+			}
+			break;
+		}
+		case DirectoryChangeType_Remove:
+		{
+			const auto found = EntryIndices.find(change.Entry.Directory);
+			if (found == EntryIndices.end())
+				break;
+
+			// Swap with the last entry so removing never shifts the whole list
+			const size_t removed_idx = found->second;
+			EntryIndices.erase(found);
+			if (removed_idx != Entries.size() - 1) {
+				Entries[removed_idx] = std::move(Entries.back());
+				EntryIndices[Entries[removed_idx].Directory] = removed_idx;
+			}
+			Entries.pop_back();
+			indices_invalidated = true;
+			break;
+		}
+		}
+	}
+	AppliedChanges.clear();
+
+	return indices_invalidated;
+}
+
+bool DirectoryScanner::IsScanning() const noexcept
+{
+	return Scanning.load(std::memory_order_relaxed);
+}
+
+const std::vector<DirectoryEntry>& DirectoryScanner::GetEntries() const noexcept
+{
+	return Entries;
+}
+
+void DirectoryScanner::WorkerLoop()
+{
+	while (!StopWorker.load()) {
+		RescanRequested.store(false);
+		PrepareDirectory();
+		WatchDirectory();
+	}
+}
+
+void DirectoryScanner::PrepareDirectory()
+{
+	std::error_code error;
+	if (!std::filesystem::exists(DirectoryName, error))
+		std::filesystem::create_directory(DirectoryName, error);
+	else if (!std::filesystem::is_directory(DirectoryName, error)) {
+		std::filesystem::remove(DirectoryName, error);
+		std::filesystem::create_directory(DirectoryName, error);
+	}
+}
+
+void DirectoryScanner::ScanDirectory()
+{
+	Scanning.store(true);
+
+	std::error_code error;
+	std::vector<DirectoryChange> batch;
+	batch.reserve(ScanBatchSize);
+	batch.push_back({ DirectoryChangeType_Reset, {} });
+
+	auto file_iterator = std::filesystem::directory_iterator(DirectoryName, error);
+	for (; !error && file_iterator != std::filesystem::directory_iterator(); file_iterator.increment(error)) {
+		if (StopWorker.load() || RescanRequested.load())
+			break;
+
+		DirectoryChange change = { DirectoryChangeType_Update, {} };
+		if (!CreateEntry(file_iterator->path().string(), change.Entry))
+			continue;
+
+		batch.push_back(std::move(change));
+		if (batch.size() >= ScanBatchSize)
+			PushChanges(batch);
+	}
+	PushChanges(batch);
+
+	Scanning.store(false);
+}
+
+void DirectoryScanner::WatchDirectory()
+{
+	auto should_leave = [this]() { return StopWorker.load() || RescanRequested.load(); };
+	auto wait_for_leave = [&]() {
+		while (!should_leave())
+			std::this_thread::sleep_for(std::chrono::milliseconds(WatchTimeoutMs));
+	};
+	// Without a watcher the list only changes on a rescan
+	auto scan_and_wait = [&]() {
+		ScanDirectory();
+		wait_for_leave();
+	};
+
+#if defined(_WIN32)
+	const std::wstring directory_wide = std::filesystem::path(DirectoryName).wstring();
+	HANDLE directory_handle = CreateFileW(directory_wide.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+	                                      nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (directory_handle == INVALID_HANDLE_VALUE) {
+		scan_and_wait();
+		return;
+	}
+
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	std::vector<DWORD> notify_buffer(8192);
+	std::vector<DirectoryChange> changes;
+	auto read_changes = [&]() {
+		ResetEvent(overlapped.hEvent);
+		return ReadDirectoryChangesW(directory_handle, notify_buffer.data(), static_cast<DWORD>(notify_buffer.size() * sizeof(DWORD)), FALSE,
+		                             FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE, nullptr, &overlapped, nullptr) != FALSE;
+	};
+
+	// The handle only buffers changes from the first read on, so that read is issued before the scan
+	bool reading = read_changes();
+	ScanDirectory();
+	if (!reading)
+		wait_for_leave();
+
+	while (reading && !should_leave()) {
+		DWORD bytes_returned = 0;
+		bool cancelled = false;
+		while (WaitForSingleObject(overlapped.hEvent, WatchTimeoutMs) == WAIT_TIMEOUT) {
+			if (should_leave()) {
+				CancelIoEx(directory_handle, &overlapped);
+				cancelled = true;
+				break;
+			}
+		}
+		const bool completed = GetOverlappedResult(directory_handle, &overlapped, &bytes_returned, TRUE);
+		if (cancelled)
+			break;
+
+		// A zero byte result means the notification buffer overflowed and events were lost
+		if (!completed || bytes_returned == 0) {
+			RescanRequested.store(true);
+			break;
+		}
+
+		const auto* notify_bytes = reinterpret_cast<const char*>(notify_buffer.data());
+		while (true) {
+			const auto* notify_info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(notify_bytes);
+			const std::wstring filename(notify_info->FileName, notify_info->FileNameLength / sizeof(WCHAR));
+			const std::string filepath = (std::filesystem::path(DirectoryName) / filename).string();
+
+			DirectoryChange change = { DirectoryChangeType_Remove, {} };
+			const bool removed = notify_info->Action == FILE_ACTION_REMOVED || notify_info->Action == FILE_ACTION_RENAMED_OLD_NAME;
+			if (!removed && CreateEntry(filepath, change.Entry))
+				change.Type = DirectoryChangeType_Update;
+			else
+				change.Entry.Directory = filepath;
+			changes.push_back(std::move(change));
+
+			if (notify_info->NextEntryOffset == 0)
+				break;
+			notify_bytes += notify_info->NextEntryOffset;
+		}
+		PushChanges(changes);
+
+		reading = read_changes();
+		if (!reading)
+			wait_for_leave();
+	}
+
+	CloseHandle(overlapped.hEvent);
+	CloseHandle(directory_handle);
+#elif defined(__linux__)
+	const int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd < 0) {
+		scan_and_wait();
+		return;
+	}
+
+	if (inotify_add_watch(inotify_fd, DirectoryName.c_str(), IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF) < 0) {
+		close(inotify_fd);
+		scan_and_wait();
+		return;
+	}
+
+	// Events of the scan's time are queued on the descriptor and read after it
+	ScanDirectory();
+
+	alignas(inotify_event) char event_buffer[16384];
+	std::vector<DirectoryChange> changes;
+
+	while (!should_leave()) {
+		pollfd poll_fd = { inotify_fd, POLLIN, 0 };
+		if (poll(&poll_fd, 1, WatchTimeoutMs) <= 0)
+			continue;
+
+		const ssize_t bytes_read = read(inotify_fd, event_buffer, sizeof(event_buffer));
+		if (bytes_read <= 0)
+			continue;
+
+		for (ssize_t offset = 0; offset < bytes_read;) {
+			const auto* event = reinterpret_cast<const inotify_event*>(event_buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			// Lost events or the directory itself is gone. Start over from a full scan
+			if (event->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_IGNORED)) {
+				RescanRequested.store(true);
+				break;
+			}
+
+			if (event->len == 0 || (event->mask & IN_ISDIR))
+				continue;
+
+			const std::string filepath = (std::filesystem::path(DirectoryName) / event->name).string();
+			DirectoryChange change = { DirectoryChangeType_Remove, {} };
+			const bool removed = event->mask & (IN_DELETE | IN_MOVED_FROM);
+			if (!removed && CreateEntry(filepath, change.Entry))
+				change.Type = DirectoryChangeType_Update;
+			else
+				change.Entry.Directory = filepath;
+			changes.push_back(std::move(change));
+		}
+		PushChanges(changes);
+	}
+
+	close(inotify_fd);
+#else
+	// No watcher on this platform
+	scan_and_wait();
+#endif
+}
+
+void DirectoryScanner::PushChanges(std::vector<DirectoryChange>& changes)
+{
+	if (changes.empty())
+		return;
+
+	std::lock_guard changes_guard(ChangesMutex);
+	for (auto& change : changes)
+		PendingChanges.push_back(std::move(change));
+	changes.clear();
+}
+
+bool DirectoryScanner::CreateEntry(const std::string& filepath, DirectoryEntry& entry) const
+{
+	std::error_code error;
+	const std::filesystem::directory_entry file_entry(filepath, error);
+	if (error || !file_entry.exists(error) || file_entry.is_directory(error))
+		return false;
+
+	const auto file_time = file_entry.last_write_time(error);
+	if (error)
+		return false;
+
+	entry.Directory = filepath;
+	ToLocalTime(FileTimeToTimeT(file_time), entry.DateTime);
+	return true;
+}
+
+std::time_t FileTimeToTimeT(const std::filesystem::file_time_type& file_time) noexcept
+{
+	const auto system_time = std::chrono::file_clock::to_sys(file_time);
+	return std::chrono::system_clock::to_time_t(std::chrono::time_point_cast<std::chrono::system_clock::duration>(system_time));
+}
+
+void ToLocalTime(std::time_t time, std::tm& local_time) noexcept
+{
+#if defined(_WIN32)
+	localtime_s(&local_time, &time);
+#else
+	localtime_r(&time, &local_time);
+#endif
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <ctime>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Lists the files of a directory on a background thread.
+// The worker streams what it finds into a back buffer and the UI thread swaps it out once per frame with Poll(),
+// so a directory with thousands of files never blocks a frame. After the first scan the worker keeps watching the
+// directory (ReadDirectoryChangesW on Windows, inotify on Linux) and only sends the files that changed.
+
+struct DirectoryEntry
+{
+	std::string Directory;
+	std::tm     DateTime;
+};
+
+enum DirectoryChangeType_
+{
+	DirectoryChangeType_Reset   = 0,    // Drop every entry, a full scan follows
+	DirectoryChangeType_Update  = 1,    // The entry was added or modified
+	DirectoryChangeType_Remove  = 2
+};
+using DirectoryChangeType = int;
+
+// Portable stand-ins for clock_cast and localtime_s, so the dates of the scanner and the save slots build with any compiler
+std::time_t FileTimeToTimeT(const std::filesystem::file_time_type& file_time) noexcept;
+void        ToLocalTime(std::time_t time, std::tm& local_time) noexcept;
+
+class DirectoryScanner
+{
+private:
+	struct DirectoryChange
+	{
+		DirectoryChangeType Type;
+		DirectoryEntry      Entry;
+	};
+
+	std::string                             DirectoryName;
+	std::vector<DirectoryEntry>             Entries;         // Only touched by the UI thread
+	std::unordered_map<std::string, size_t> EntryIndices;    // Directory -> index in Entries
+
+	std::mutex                   ChangesMutex;
+	std::vector<DirectoryChange> PendingChanges;             // Filled by the worker
+	std::vector<DirectoryChange> AppliedChanges;             // Swapped with PendingChanges by Poll()
+
+	std::thread       Worker;
+	std::atomic<bool> StopWorker;
+	std::atomic<bool> RescanRequested;
+	std::atomic<bool> Scanning;
+
+public:
+	DirectoryScanner() noexcept;
+	~DirectoryScanner();
+
+	DirectoryScanner(const DirectoryScanner&) = delete;
+	DirectoryScanner& operator = (const DirectoryScanner&) = delete;
+
+	// Starts scanning and watching the directory. Creates the directory if it does not exist
+	void Start(const std::string& directory_name);
+	void Stop();
+	// Throws away the current list and scans the whole directory again
+	void Rescan() noexcept;
+	// Applies the changes found by the worker since the last call
+	// Returns true if entries were removed or reordered, which invalidates indices into GetEntries()
+	bool Poll();
+	bool IsScanning() const noexcept;
+	const std::vector<DirectoryEntry>& GetEntries() const noexcept;
+
+private:
+	void WorkerLoop();
+	void PrepareDirectory();
+	void ScanDirectory();
+	// Arms the watcher, then runs the scan, so a file created while scanning is still reported
+	void WatchDirectory();
+	void PushChanges(std::vector<DirectoryChange>& changes);
+	bool CreateEntry(const std::string& filepath, DirectoryEntry& entry) const;
+};
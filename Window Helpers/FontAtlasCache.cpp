@@ -0,0 +1,295 @@
+#include "FontAtlasCache.h"
+#include "sdq_save.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+constexpr uint32_t CacheMagic   = 0x41465153; // "SQFA"
+constexpr uint16_t CacheVersion = 1;
+// Refuses textures larger than this, so a damaged size can't ask for a huge allocation
+constexpr int32_t  MaxTexSize   = 8192;
+
+struct CacheHeader
+{
+	uint32_t Magic;
+	uint16_t Version;
+	uint16_t GlyphSize;         // sizeof(ImFontGlyph), it changes with the ImWchar size
+	uint32_t Key;               // Hash of the fonts and settings the atlas was built from
+	uint32_t Checksum;          // FNV-1a of everything after the header
+	int32_t  TexWidth;
+	int32_t  TexHeight;
+	int32_t  FontCount;
+	int32_t  CustomRectCount;
+};
+
+struct CachedAtlas
+{
+	ImVec2  TexUvWhitePixel;
+	ImVec4  TexUvLines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1];
+	int32_t PackIdMouseCursors;
+	int32_t PackIdLines;
+};
+
+struct CachedFont
+{
+	float   FontSize;
+	float   Ascent;
+	float   Descent;
+	int32_t MetricsTotalSurface;
+	int32_t GlyphCount;
+	ImWchar FallbackChar;
+	ImWchar EllipsisChar;
+	ImWchar DotChar;
+};
+
+struct CachedRect
+{
+	uint16_t Width;
+	uint16_t Height;
+	uint16_t X;
+	uint16_t Y;
+	uint32_t GlyphID;
+	float    GlyphAdvanceX;
+	ImVec2   GlyphOffset;
+	int32_t  FontIdx;           // -1 if the rect isn't a glyph of a font
+};
+
+int FindFontIdx(const ImFontAtlas* atlas, const ImFont* font)
+{
+	for (int font_idx = 0; font_idx < atlas->Fonts.Size; ++font_idx)
+		if (atlas->Fonts[font_idx] == font)
+			return font_idx;
+
+	return -1;
+}
+
+// Everything the stb_truetype builder reads, i.e. what the baked texture and glyphs depend on
+uint32_t AtlasKey(const ImFontAtlas* atlas)
+{
+	uint32_t key = sdq::save::Checksum(&CacheVersion, sizeof(CacheVersion));
+	auto hash = [&key](const void* data, size_t size) { key = sdq::save::Checksum(data, size, key); };
+	auto hash_value = [&hash](const auto& value) { hash(&value, sizeof(value)); };
+
+	hash_value(IMGUI_VERSION_NUM);
+	hash_value(atlas->Flags);
+	hash_value(atlas->TexDesiredWidth);
+	hash_value(atlas->TexGlyphPadding);
+	for (const ImFontConfig& config : atlas->ConfigData) {
+		hash(config.FontData, static_cast<size_t>(config.FontDataSize));
+		hash_value(config.FontNo);
+		hash_value(config.SizePixels);
+		hash_value(config.OversampleH);
+		hash_value(config.OversampleV);
+		hash_value(config.PixelSnapH);
+		hash_value(config.GlyphExtraSpacing);
+		hash_value(config.GlyphOffset);
+		hash_value(config.GlyphMinAdvanceX);
+		hash_value(config.GlyphMaxAdvanceX);
+		hash_value(config.MergeMode);
+		hash_value(config.FontBuilderFlags);
+		hash_value(config.RasterizerMultiply);
+		hash_value(config.EllipsisChar);
+		hash_value(FindFontIdx(atlas, config.DstFont));
+
+		// The ranges are a zero terminated list of pairs
+		const ImWchar* ranges = config.GlyphRanges != nullptr ? config.GlyphRanges : const_cast<ImFontAtlas*>(atlas)->GetGlyphRangesDefault();
+		size_t range_count = 0;
+		while (ranges[range_count] != 0)
+			++range_count;
+		hash(ranges, (range_count + 1) * sizeof(ImWchar));
+	}
+
+	return key;
+}
+
+class CacheReader
+{
+private:
+	const std::vector<char>& Bytes;
+	size_t                   Offset;
+
+public:
+	CacheReader(const std::vector<char>& bytes, size_t offset) : Bytes(bytes), Offset(offset) {}
+
+	bool Read(void* data, size_t size)
+	{
+		if (size > Bytes.size() - Offset)
+			return false;
+
+		std::memcpy(data, Bytes.data() + Offset, size);
+		Offset += size;
+		return true;
+	}
+
+	template<typename T>
+	bool Read(T& value) { return Read(&value, sizeof(T)); }
+
+	bool IsAtEnd() const { return Offset == Bytes.size(); }
+};
+}
+
+bool FontAtlasCache::Load(ImFontAtlas* atlas, const char* filepath)
+{
+	if (atlas->Locked || atlas->ConfigData.empty())
+		return false;
+
+	std::ifstream ifile(filepath, std::ios::binary | std::ios::ate);
+	if (!ifile.good())
+		return false;
+
+	std::vector<char> bytes(static_cast<size_t>(ifile.tellg()));
+	ifile.seekg(0);
+	if (bytes.size() < sizeof(CacheHeader) || !ifile.read(bytes.data(), bytes.size()))
+		return false;
+
+	CacheHeader header;
+	std::memcpy(&header, bytes.data(), sizeof(CacheHeader));
+	if (header.Magic != CacheMagic || header.Version != CacheVersion || header.GlyphSize != sizeof(ImFontGlyph) || header.FontCount != atlas->Fonts.Size)
+		return false;
+	if (header.TexWidth <= 0 || header.TexHeight <= 0 || header.TexWidth > MaxTexSize || header.TexHeight > MaxTexSize || header.CustomRectCount < 0)
+		return false;
+	if (header.Checksum != sdq::save::Checksum(bytes.data() + sizeof(CacheHeader), bytes.size() - sizeof(CacheHeader)))
+		return false;
+	// Hashing the font files is the slow part of the checks, so it goes last
+	if (header.Key != AtlasKey(atlas))
+		return false;
+
+	// Everything is read before the atlas is touched, so a short file leaves it as it was
+	CacheReader reader(bytes, sizeof(CacheHeader));
+	CachedAtlas cached_atlas;
+	if (!reader.Read(cached_atlas))
+		return false;
+
+	std::vector<CachedFont> cached_fonts(header.FontCount);
+	std::vector<ImVector<ImFontGlyph>> font_glyphs(header.FontCount);
+	for (int font_idx = 0; font_idx < header.FontCount; ++font_idx) {
+		CachedFont& cached_font = cached_fonts[font_idx];
+		if (!reader.Read(cached_font) || cached_font.GlyphCount <= 0 || cached_font.GlyphCount >= 0xFFFF)
+			return false;
+
+		font_glyphs[font_idx].resize(cached_font.GlyphCount);
+		if (!reader.Read(font_glyphs[font_idx].Data, cached_font.GlyphCount * sizeof(ImFontGlyph)))
+			return false;
+	}
+
+	std::vector<CachedRect> cached_rects(header.CustomRectCount);
+	for (auto& cached_rect : cached_rects)
+		if (!reader.Read(cached_rect) || cached_rect.FontIdx < -1 || cached_rect.FontIdx >= header.FontCount)
+			return false;
+
+	const size_t pixel_count = static_cast<size_t>(header.TexWidth) * static_cast<size_t>(header.TexHeight);
+	std::vector<unsigned char> pixels(pixel_count);
+	if (!reader.Read(pixels.data(), pixel_count) || !reader.IsAtEnd())
+		return false;
+
+	// Same state ImFontAtlas::Build leaves behind
+	atlas->ClearTexData();
+	atlas->TexID              = (ImTextureID)NULL;
+	atlas->TexWidth           = header.TexWidth;
+	atlas->TexHeight          = header.TexHeight;
+	atlas->TexUvScale         = ImVec2(1.0f / header.TexWidth, 1.0f / header.TexHeight);
+	atlas->TexUvWhitePixel    = cached_atlas.TexUvWhitePixel;
+	atlas->PackIdMouseCursors = cached_atlas.PackIdMouseCursors;
+	atlas->PackIdLines        = cached_atlas.PackIdLines;
+	std::memcpy(atlas->TexUvLines, cached_atlas.TexUvLines, sizeof(atlas->TexUvLines));
+	atlas->TexPixelsAlpha8 = static_cast<unsigned char*>(IM_ALLOC(pixel_count));
+	std::memcpy(atlas->TexPixelsAlpha8, pixels.data(), pixel_count);
+
+	atlas->CustomRects.resize(header.CustomRectCount);
+	for (int rect_idx = 0; rect_idx < header.CustomRectCount; ++rect_idx) {
+		const CachedRect& cached_rect = cached_rects[rect_idx];
+		ImFontAtlasCustomRect& rect   = atlas->CustomRects[rect_idx];
+		rect.Width         = cached_rect.Width;
+		rect.Height        = cached_rect.Height;
+		rect.X             = cached_rect.X;
+		rect.Y             = cached_rect.Y;
+		rect.GlyphID       = cached_rect.GlyphID;
+		rect.GlyphAdvanceX = cached_rect.GlyphAdvanceX;
+		rect.GlyphOffset   = cached_rect.GlyphOffset;
+		rect.Font          = cached_rect.FontIdx >= 0 ? atlas->Fonts[cached_rect.FontIdx] : nullptr;
+	}
+
+	for (int font_idx = 0; font_idx < header.FontCount; ++font_idx) {
+		ImFont* font = atlas->Fonts[font_idx];
+		const CachedFont& cached_font = cached_fonts[font_idx];
+		font->ClearOutputData();
+		font->ContainerAtlas  = atlas;
+		font->ConfigData      = nullptr;
+		font->ConfigDataCount = 0;
+		for (const ImFontConfig& config : atlas->ConfigData) {
+			if (config.DstFont != font)
+				continue;
+			if (font->ConfigData == nullptr)
+				font->ConfigData = &config;
+			++font->ConfigDataCount;
+		}
+		font->FontSize            = cached_font.FontSize;
+		font->Ascent              = cached_font.Ascent;
+		font->Descent             = cached_font.Descent;
+		font->MetricsTotalSurface = cached_font.MetricsTotalSurface;
+		font->FallbackChar        = cached_font.FallbackChar;
+		font->EllipsisChar        = cached_font.EllipsisChar;
+		font->DotChar             = cached_font.DotChar;
+		font->Glyphs.swap(font_glyphs[font_idx]);
+		font->BuildLookupTable();
+	}
+
+	atlas->TexReady = true;
+	return true;
+}
+
+bool FontAtlasCache::Save(const ImFontAtlas* atlas, const char* filepath)
+{
+	if (!atlas->TexReady || atlas->TexPixelsAlpha8 == nullptr)
+		return false;
+
+	// The header goes in front once the checksum of the rest is known
+	std::vector<char> bytes(sizeof(CacheHeader));
+	auto append = [&bytes](const void* data, size_t size) {
+		const char* begin = static_cast<const char*>(data);
+		bytes.insert(bytes.end(), begin, begin + size);
+	};
+
+	CachedAtlas cached_atlas;
+	cached_atlas.TexUvWhitePixel    = atlas->TexUvWhitePixel;
+	cached_atlas.PackIdMouseCursors = atlas->PackIdMouseCursors;
+	cached_atlas.PackIdLines        = atlas->PackIdLines;
+	std::memcpy(cached_atlas.TexUvLines, atlas->TexUvLines, sizeof(cached_atlas.TexUvLines));
+	append(&cached_atlas, sizeof(CachedAtlas));
+
+	for (const ImFont* font : atlas->Fonts) {
+		CachedFont cached_font;
+		cached_font.FontSize            = font->FontSize;
+		cached_font.Ascent              = font->Ascent;
+		cached_font.Descent             = font->Descent;
+		cached_font.MetricsTotalSurface = font->MetricsTotalSurface;
+		cached_font.GlyphCount          = font->Glyphs.Size;
+		cached_font.FallbackChar        = font->FallbackChar;
+		cached_font.EllipsisChar        = font->EllipsisChar;
+		cached_font.DotChar             = font->DotChar;
+		append(&cached_font, sizeof(CachedFont));
+		append(font->Glyphs.Data, font->Glyphs.Size * sizeof(ImFontGlyph));
+	}
+
+	for (const ImFontAtlasCustomRect& rect : atlas->CustomRects) {
+		const CachedRect cached_rect = { rect.Width, rect.Height, rect.X, rect.Y, rect.GlyphID, rect.GlyphAdvanceX, rect.GlyphOffset, rect.Font != nullptr ? FindFontIdx(atlas, rect.Font) : -1 };
+		append(&cached_rect, sizeof(CachedRect));
+	}
+	append(atlas->TexPixelsAlpha8, static_cast<size_t>(atlas->TexWidth) * static_cast<size_t>(atlas->TexHeight));
+
+	CacheHeader header;
+	header.Magic           = CacheMagic;
+	header.Version         = CacheVersion;
+	header.GlyphSize       = sizeof(ImFontGlyph);
+	header.Key             = AtlasKey(atlas);
+	header.Checksum        = sdq::save::Checksum(bytes.data() + sizeof(CacheHeader), bytes.size() - sizeof(CacheHeader));
+	header.TexWidth        = atlas->TexWidth;
+	header.TexHeight       = atlas->TexHeight;
+	header.FontCount       = atlas->Fonts.Size;
+	header.CustomRectCount = atlas->CustomRects.Size;
+	std::memcpy(bytes.data(), &header, sizeof(CacheHeader));
+
+	return sdq::save::WriteFileAtomically(filepath, bytes.data(), bytes.size());
+}
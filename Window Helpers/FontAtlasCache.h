@@ -0,0 +1,18 @@
+#pragma once
+
+#include "imgui.h"
+
+// Baked font atlas cache.
+// Building the atlas rasterizes every font size with stb_truetype, which is most of the startup time. The cache stores
+// the baked alpha texture, the glyph tables of every font and the custom rects, keyed by a hash of the font files,
+// sizes, glyph ranges and build settings that were added to the atlas. A launch with the same fonts restores the atlas
+// from the file and never rasterizes. Any change to the fonts changes the key, and the atlas is built and saved again.
+
+namespace FontAtlasCache
+{
+	// Restores the atlas if the cache was saved from the exact fonts now added to it. Call after the AddFont* calls
+	// and before the backend uploads the texture. Returns false if there is no cache or it doesn't match
+	bool Load(ImFontAtlas* atlas, const char* filepath);
+	// Saves a built atlas for the next launch
+	bool Save(const ImFontAtlas* atlas, const char* filepath);
+}
@@ -1,6 +1,11 @@
 #include "GameWindow.h"
 #include "IconsFontAwesome5.h"
 #include "imgui_internal.h"
+#include "sdq_metrics.h"
+#include "sdq_trace.h"
+#include <cassert>
+#include <cmath>
+#include <cstdio>
 #include <fstream>
 
 //------------------------------------------------------------------
@@ -15,7 +20,30 @@ static void CenterText(std::string_view str);
 template<size_t S>
 static void SimpleComboWrapper(const char* label, const std::array<const char*, S>& choices, int& current_choice);
 
-static int PencilmarkButton(const char* label, const ImVec2& sz, const std::bitset<9>& pencilmark);
+// Tile and pencilmark cell of the board under a point. All -1 if the point is outside the grid or on a line
+struct BoardHit
+{
+    int Row;
+    int Col;
+    int Cell;
+};
+static BoardHit HitTestBoard(const ImVec2& grid_min, const ImVec2& point);
+static void BoardLabel(ImDrawList* draw_list, ImFont* font, const ImVec2& min, const ImVec2& max, char label, ImU32 bg_col, ImU32 text_col);
+
+// Longest the main loop sleeps without input. Keeps the directory and autosave state from going stale on screen
+static constexpr double MaxIdleTimeout      = 1.0;
+// The sudoku file list is redrawn this often while it is open, so watcher updates show up without any input
+static constexpr double FileListIdleTimeout = 0.25;
+
+// Grades of every sudoku file opened so far, so opening one again doesn't run the grader
+static constexpr const char* GradeCacheFilepath = "grade cache.bin";
+
+// Sudoku board layout. The row and column labels are half a tile wide and a thin line separates every tile
+static constexpr float BoardHeaderSize  = 24.25f;
+static constexpr float BoardLineSize    = 1.00f;
+static constexpr float BoardBoxLineSize = 2.00f;
+static constexpr float BoardTilePitch   = SudokuTile::TileSize + BoardLineSize;
+static constexpr float BoardGridSize    = (BoardTilePitch * 9.0f) - BoardLineSize;
 
 //-----------------------------------------------------------------------------------------------------------------------------------------------
 // GameWindow CLASS
@@ -36,11 +64,21 @@ GameWindow::GameWindow() :
     ShowLoadingScreen(false),
     StartLoadingScreen(false),
     ShowPencilmarks(false),
+    ShowPerformanceOverlay(false),
+    PopupTileIdx(-1),
+    FocusedTileIdx(0),
+    NewGameRunning(false),
     NewGameResult(std::nullopt),
+    SaveWriteRunning(false),
     CurrentlyOpenFile("None"),
     GameDifficulty(SudokuDifficulty_Normal),
+    AutosaveJournal("autosave"),
     NewGameLoading("Sudoku Creation Loading Screen", "Spinner 1")
 {
+    SudokuContext.SetJournal(&AutosaveJournal);
+    SudokuContext.SetGradeCache(&PuzzleGradeCache);
+    Jobs.Submit(JobPriority_Low, [this]() { PuzzleGradeCache.Load(GradeCacheFilepath); });
+
     // Initialize the sudoku tiles
     for (size_t row = 0; row < 9; ++row) {
         for (size_t col = 0; col < 9; ++col) {
@@ -58,8 +96,13 @@ GameWindow::GameWindow() :
 
 void GameWindow::RenderWindow()
 {
+    Jobs.RunCompletions();
+    if (const auto game = PublishedGame.Take())
+        this->AdoptGame(*game);
+
     ImGui::PushStyleVar(ImGuiStyleVar_ScrollbarSize, 9.0f);
     this->MainMenuBar();
+    this->PerformanceOverlay();
 
     if (!Initialized) {
         return;
@@ -109,84 +152,134 @@ void GameWindow::RenderSudokuBoard()
         return;
     }
 
-    constexpr ImVec2 button_size         = ImVec2(48.50f, 48.50f);
-    constexpr ImVec2 column_number_size  = ImVec2(48.50f, 24.25f);
-    constexpr ImVec2 row_number_size     = ImVec2(24.25f, 48.50f);
-    constexpr ImVec2 table_size          = ImVec2(475.0f, 425.0f);
-    static const ImVec4 table_number_col = ImVec4(0.19f, 0.19f, 0.20f, 1.00f);
-    ImGui::PushStyleVar(ImGuiStyleVar_CellPadding, ImVec2(0.5f, 0.5f));
-    if(ImGui::BeginTable("SudokuTable", 10, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit, table_size)) {
-        ImGui::TableNextColumn();
-        ImGui::BeginDisabled();
-        ImGui::PushStyleColor(ImGuiCol_Button, table_number_col);
-        ImGui::PushStyleVar(ImGuiStyleVar_DisabledAlpha, 0.70f);
-        ImGui::Button("##BlankCell", ImVec2(24.25f, 24.25f));
-        for (size_t col = 0; col < 9; ++col) {
-            char col_label[16];
-            sprintf_s(col_label, 16, "%zu##TCN", col + 1);
-            ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[1]);
-            ImGui::TableNextColumn();
-            ImGui::Button(col_label, column_number_size);
-            ImGui::PopFont();
+    // The board is one item drawn straight into the window's draw list. The tile under the mouse comes from the
+    // board geometry, so a frame has a single hit test instead of 81 buttons with their own ids and labels
+    ImGuiWindow* window     = ImGui::GetCurrentWindow();
+    ImDrawList*  draw_list  = window->DrawList;
+    ImFont**     fonts      = ImGui::GetIO().Fonts->Fonts.Data;
+    const ImVec2 board_pos  = window->DC.CursorPos;
+    const ImVec2 grid_min   = board_pos + ImVec2(BoardHeaderSize + BoardLineSize, BoardHeaderSize + BoardLineSize);
+    const ImVec2 grid_max   = grid_min + ImVec2(BoardGridSize, BoardGridSize);
+    const ImRect board_bb   = ImRect(board_pos, grid_max);
+    const float  rounding   = ImGui::GetStyle().FrameRounding;
+    ImGui::ItemSize(board_bb);
+    NumberGlyphs.Cache(fonts[2]);
+    PencilmarkGlyphs.Cache(fonts[3]);
+
+    {   // Row and column labels
+        const ImU32 label_bg_col   = ImGui::GetColorU32(ImVec4(0.19f, 0.19f, 0.20f, 0.70f));
+        const ImU32 label_text_col = ImGui::GetColorU32(ImGuiCol_Text, 0.70f);
+        draw_list->AddRectFilled(board_pos, board_pos + ImVec2(BoardHeaderSize, BoardHeaderSize), label_bg_col, rounding);
+        for (int idx = 0; idx < 9; ++idx) {
+            const ImVec2 column_min = ImVec2(grid_min.x + (idx * BoardTilePitch), board_pos.y);
+            const ImVec2 row_min    = ImVec2(board_pos.x, grid_min.y + (idx * BoardTilePitch));
+            BoardLabel(draw_list, fonts[1], column_min, column_min + ImVec2(SudokuTile::TileSize, BoardHeaderSize), static_cast<char>('1' + idx), label_bg_col, label_text_col);
+            BoardLabel(draw_list, fonts[1], row_min, row_min + ImVec2(BoardHeaderSize, SudokuTile::TileSize), static_cast<char>('A' + idx), label_bg_col, label_text_col);
         }
-        ImGui::PopStyleVar();
-        ImGui::PopStyleColor();
-        ImGui::EndDisabled();
+    }
 
-        ImGui::PushStyleVar(ImGuiStyleVar_FrameBorderSize, 0.0f);
-        ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(0, 0));
-        ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
-        ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[2]);
-        ImGui::BeginDisabled(!GameStart || GamePaused);
-        for (size_t row = 0; row < 9; ++row) {
-            ImGui::TableNextRow();
-            ImGui::TableNextColumn();
-            ImGui::BeginDisabled(); {
-                char row_label[16];
-                sprintf_s(row_label, 16, "%c##TRN", 'A' + row);
-                ImGui::PushStyleColor(ImGuiCol_Button, table_number_col);
-                ImGui::PushStyleVar(ImGuiStyleVar_DisabledAlpha, 0.70f);
-                ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[1]);
-                ImGui::Button(row_label, row_number_size);
-                ImGui::PopStyleVar();
-                ImGui::PopStyleColor();
-                ImGui::PopFont();
-            } ImGui::EndDisabled();
-
-            for (size_t col = 0; col < 9; ++col) {
-                ImGui::TableNextColumn();
-                if (GamePaused ? ImGui::Button("##EmptyButton", SudokuTile::ButtonSize) : SudokuGameTiles[row][col].RenderButton(SudokuContext, row, col, ShowError)) {
-                    SudokuGameTiles[row][col].UpdateTileNumber(ShowPencilmarks && !SudokuContext.GetPuzzleBoard()->GetTile(row, col).IsTileFilled() ? TileState_Pencilmark : TileState_Normal);
-                    CheckGameState = true;
-                }
+    // The tiles cover the grid background except for the gaps between them, which become the thin lines
+    draw_list->AddRectFilled(grid_min, grid_max, ImGui::GetColorU32(ImGuiCol_TableBorderLight));
+    draw_list->AddRect(grid_min - ImVec2(BoardLineSize, BoardLineSize) * 0.5f, grid_max + ImVec2(BoardLineSize, BoardLineSize) * 0.5f,
+                       ImGui::GetColorU32(ImGuiCol_TableBorderStrong), 0.0f, ImDrawFlags_None, BoardLineSize);
+
+    ImGui::BeginDisabled(!GameStart || GamePaused);
+    ImGuiContext& g = *GImGui;
+    const ImGuiID board_id = window->GetID("##SudokuBoard");
+    bool hovered = false, held = false, pressed = false;
+    if (ImGui::ItemAdd(board_bb, board_id))
+        pressed = ImGui::ButtonBehavior(board_bb, board_id, &hovered, &held);
+
+    // The board is a single nav item, so it moves a focused tile itself. An arrow key that stays on the board cancels
+    // the nav request that would move to the next item, one that would leave the board lets it through
+    const bool board_focused = GameStart && !GamePaused && ImGui::IsItemFocused();
+    const bool nav_pressed   = pressed && g.ActiveIdSource == ImGuiInputSource_Nav;
+    if (board_focused && g.NavMoveSubmitted && (g.NavMoveFlags & ImGuiNavMoveFlags_Tabbing) == 0) {
+        int row = FocusedTileIdx / 9, col = FocusedTileIdx % 9;
+        switch (g.NavMoveDir)
+        {
+        case ImGuiDir_Left:  --col; break;
+        case ImGuiDir_Right: ++col; break;
+        case ImGuiDir_Up:    --row; break;
+        case ImGuiDir_Down:  ++row; break;
+        default: break;
+        }
+        if (row >= 0 && row < 9 && col >= 0 && col < 9) {
+            // Shows the nav highlight and hides the mouse hover, as a nav move that went through would
+            ImGui::NavMoveRequestCancel();
+            g.NavDisableHighlight  = false;
+            g.NavDisableMouseHover = true;
+            FocusedTileIdx = (row * 9) + col;
+        }
+    }
+
+    // Like with a button, a press only counts on the tile it started on. While the keyboard drives the board the
+    // mouse cursor doesn't hover
+    const BoardHit no_hit     = { -1, -1, -1 };
+    const BoardHit mouse_hit  = hovered && !g.NavDisableMouseHover ? HitTestBoard(grid_min, ImGui::GetMousePos()) : no_hit;
+    const BoardHit click_hit  = held || pressed ? HitTestBoard(grid_min, ImGui::GetIO().MouseClickedPos[ImGuiMouseButton_Left]) : no_hit;
+    const bool     click_tile = mouse_hit.Row != -1 && mouse_hit.Row == click_hit.Row && mouse_hit.Col == click_hit.Col;
+
+    const ImU32 paused_col = ImGui::GetColorU32(ImGuiCol_Button);
+    for (int row = 0; row < 9; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            const ImVec2 tile_min = grid_min + ImVec2(col * BoardTilePitch, row * BoardTilePitch);
+            if (GamePaused) {
+                draw_list->AddRectFilled(tile_min, tile_min + ImVec2(SudokuTile::TileSize, SudokuTile::TileSize), paused_col, rounding);
+                continue;
             }
+
+            const int hovered_cell = mouse_hit.Row == row && mouse_hit.Col == col ? mouse_hit.Cell : -1;
+            SudokuGameTiles[row][col].DrawTile(draw_list, tile_min, hovered_cell, held && click_tile, ShowError, NumberGlyphs, PencilmarkGlyphs);
         }
-        ImGui::EndDisabled();
+    }
 
-        ImGui::EndTable();
-        ImGui::PopFont();
-        ImGui::PopStyleVar(4);
+    if (pressed && !nav_pressed && click_tile) {
+        SudokuTile& tile = SudokuGameTiles[mouse_hit.Row][mouse_hit.Col];
+        FocusedTileIdx = (mouse_hit.Row * 9) + mouse_hit.Col;
+        if (tile.IsInteractive()) {
+            tile.OpenPopup(tile.IsShowingPencilmarks() ? mouse_hit.Cell + 1 : 0, ImGui::GetMousePos() + ImVec2(15.0f, 0.0f));
+            PopupTileIdx = FocusedTileIdx;
+        }
+    }
 
-        
-        {   // Render a somewhat thick line for the table
-            constexpr ImVec2 row_split1_pos    = ImVec2(9.50f   + 26.0f, 175.0f  + 25.0f);
-            constexpr ImVec2 row_split1_sz     = ImVec2(457.0f  + 26.0f, 177.0f  + 25.0f);
-            constexpr ImVec2 row_split2_pos    = ImVec2(9.50f   + 26.0f, 322.0f  + 25.0f);
-            constexpr ImVec2 row_split2_sz     = ImVec2(457.0f  + 26.0f, 324.0f  + 25.0f);
-            constexpr ImVec2 column_split1_pos = ImVec2(157.75f + 26.0f, 28.50f  + 25.0f);
-            constexpr ImVec2 column_split1_sz  = ImVec2(159.75f + 26.0f, 470.50f + 25.0f);
-            constexpr ImVec2 column_split2_pos = ImVec2(307.75f + 26.0f, 28.50f  + 25.0f);
-            constexpr ImVec2 column_split2_sz  = ImVec2(309.75f + 26.0f, 470.50f + 25.0f);
-            static const ImU32 col = ImGui::ColorConvertFloat4ToU32(ImVec4(0, 0, 0, 1.0f));
+    // Space activates the item like a click, Enter is the nav input key that a button ignores. The keyboard always
+    // opens the number input, next to the tile
+    const ImVec2 focused_tile_min = grid_min + ImVec2((FocusedTileIdx % 9) * BoardTilePitch, (FocusedTileIdx / 9) * BoardTilePitch);
+    if (board_focused && (nav_pressed || ImGui::IsKeyPressed(ImGuiKey_Enter, false) || ImGui::IsKeyPressed(ImGuiKey_KeypadEnter, false))) {
+        SudokuTile& tile = SudokuGameTiles[FocusedTileIdx / 9][FocusedTileIdx % 9];
+        if (tile.IsInteractive()) {
+            tile.OpenPopup(0, focused_tile_min + ImVec2(SudokuTile::TileSize + 5.0f, 0.0f));
+            PopupTileIdx = FocusedTileIdx;
+        }
+    }
+    ImGui::EndDisabled();
 
-            ImDrawList* drawlist = ImGui::GetWindowDrawList();
-            drawlist->AddRectFilled(column_split1_pos, column_split1_sz, col);
-            drawlist->AddRectFilled(column_split2_pos, column_split2_sz, col);
-            drawlist->AddRectFilled(row_split1_pos, row_split1_sz, col);
-            drawlist->AddRectFilled(row_split2_pos, row_split2_sz, col);
+    {   // Render a somewhat thick line between the boxes
+        static const ImU32 col = ImGui::ColorConvertFloat4ToU32(ImVec4(0, 0, 0, 1.0f));
+        for (int box = 1; box < 3; ++box) {
+            const float split = (box * 3 * BoardTilePitch) - (BoardLineSize * 0.5f);
+            const float half  = BoardBoxLineSize * 0.5f;
+            draw_list->AddRectFilled(ImVec2(grid_min.x + split - half, grid_min.y), ImVec2(grid_min.x + split + half, grid_max.y), col);
+            draw_list->AddRectFilled(ImVec2(grid_min.x, grid_min.y + split - half), ImVec2(grid_max.x, grid_min.y + split + half), col);
         }
     }
 
+    // Only drawn while the board has nav focus and the keyboard or gamepad was used last
+    if (board_focused)
+        ImGui::RenderNavHighlight(ImRect(focused_tile_min, focused_tile_min + ImVec2(SudokuTile::TileSize, SudokuTile::TileSize)), board_id);
+
+    if (!GamePaused && PopupTileIdx != -1) {
+        const uint16_t row = static_cast<uint16_t>(PopupTileIdx / 9);
+        const uint16_t col = static_cast<uint16_t>(PopupTileIdx % 9);
+        ImGui::PushFont(fonts[2]);
+        if (SudokuGameTiles[row][col].RenderPopup(SudokuContext, row, col)) {
+            SudokuGameTiles[row][col].UpdateTileNumber(ShowPencilmarks && !SudokuContext.GetPuzzleBoard()->GetTile(row, col).IsTileFilled() ? TileState_Pencilmark : TileState_Normal);
+            CheckGameState = true;
+        }
+        ImGui::PopFont();
+    }
+
     ImGui::EndChild();
 }
 
@@ -224,14 +317,14 @@ void GameWindow::GameEndWindow()
     ImGui::Separator();
     CenterText("Time taken to finish the puzzle:");
     char finish_time[64];
-    sprintf_s(finish_time, 64, "%zu hours : %zu minutes : %0.2f seconds", TimeElapsed.Hours, TimeElapsed.Minutes, TimeElapsed.Seconds);
+    std::snprintf(finish_time, sizeof(finish_time), "%zu hours : %zu minutes : %0.2f seconds", TimeElapsed.Hours, TimeElapsed.Minutes, TimeElapsed.Seconds);
     CenterText(finish_time);
     CenterText(finish_time_note);
 
     ImGui::Separator();
     CenterText("Total time taken to look at the solution:");
     char solution_look_time[64];
-    sprintf_s(solution_look_time, 64, "%zu hours : %zu minutes : %0.2f seconds", ShowSolutionTotalTime.Hours, ShowSolutionTotalTime.Minutes, ShowSolutionTotalTime.Seconds);
+    std::snprintf(solution_look_time, sizeof(solution_look_time), "%zu hours : %zu minutes : %0.2f seconds", ShowSolutionTotalTime.Hours, ShowSolutionTotalTime.Minutes, ShowSolutionTotalTime.Seconds);
     CenterText(solution_look_time);
     CenterText(solution_time_note);
 
@@ -251,6 +344,33 @@ void GameWindow::MainMenuBar()
     }
 
     if (ImGui::BeginMenu("Game")) {
+        if (ImGui::MenuItem("Recover Last Session", nullptr, false, AutosaveJournal.HasRecovery() && !NewGameRunning)) {
+            // Not through SubmitNewGame, a failed recovery has no error popup to show
+            NewGameRunning = true;
+            Jobs.Submit(JobPriority_High, [this]() { return this->RecoverLastSession(); }, [this](bool) { NewGameRunning = false; });
+        }
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+            ImGui::BeginTooltip();
+            ImGui::PushTextWrapPos(350.0f);
+            ImGui::TextUnformatted("Restores the unfinished puzzle from the autosave, including every move made before the game was closed or crashed.");
+            ImGui::PopTextWrapPos();
+            ImGui::EndTooltip();
+        }
+        if (ImGui::MenuItem("Save Generation Trace")) {
+            constexpr const char* folder_name = "traces";
+            if (!std::filesystem::exists(folder_name))
+                std::filesystem::create_directory(folder_name);
+            sdq::trace::DumpChromeTrace("traces\\generation trace.json");
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::BeginTooltip();
+            ImGui::PushTextWrapPos(350.0f);
+            ImGui::TextUnformatted("Writes the timeline of the recent puzzle generations to \"traces\" folder. Open it with chrome://tracing.");
+            ImGui::PopTextWrapPos();
+            ImGui::EndTooltip();
+        }
+        ImGui::MenuItem("Performance Overlay", nullptr, &ShowPerformanceOverlay);
+        ImGui::Separator();
         ImGui::MenuItem("Exit", "Alt + F4", &WindowClose);
         ImGui::EndMenu();
     }
@@ -263,6 +383,67 @@ void GameWindow::MainMenuBar()
     ImGui::EndMainMenuBar();
 }
 
+void GameWindow::PerformanceOverlay()
+{
+    if (!ShowPerformanceOverlay)
+        return;
+
+    constexpr ImVec2 plot_size = ImVec2(260.0f, 45.0f);
+    const ImGuiViewport* viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - 10.0f, viewport->WorkPos.y + 10.0f), ImGuiCond_Appearing, ImVec2(1.0f, 0.0f));
+    ImGui::SetNextWindowBgAlpha(0.90f);
+    if (!ImGui::Begin("Performance##Overlay", &ShowPerformanceOverlay, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoSavedSettings)) {
+        ImGui::End();
+        return;
+    }
+
+    // Frame times. With idle rendering on, only the frames that were actually drawn are in here
+    static std::array<sdq::metrics::FrameTime, sdq::metrics::FrameHistorySize> frame_times;
+    static std::array<float, sdq::metrics::FrameHistorySize> frame_totals;
+    const size_t frame_count = sdq::metrics::GetFrameTimes(frame_times);
+    float build_sum = 0.0f, render_sum = 0.0f, frame_max = 0.0f;
+    for (size_t idx = 0; idx < frame_count; ++idx) {
+        build_sum  += frame_times[idx].BuildMs;
+        render_sum += frame_times[idx].RenderMs;
+        frame_totals[idx] = frame_times[idx].BuildMs + frame_times[idx].RenderMs;
+        frame_max = std::max(frame_max, frame_totals[idx]);
+    }
+
+    const float frame_divisor = frame_count > 0 ? static_cast<float>(frame_count) : 1.0f;
+    ImGui::Text("Frame: %.2f ms avg, %.2f ms max", (build_sum + render_sum) / frame_divisor, frame_max);
+    ImGui::PlotLines("##FrameTimes", frame_totals.data(), static_cast<int>(frame_count), 0, nullptr, 0.0f, FLT_MAX, plot_size);
+    ImGui::Text("ImGui build %.2f ms | Render %.2f ms", build_sum / frame_divisor, render_sum / frame_divisor);
+
+    // Latency of the last few game operations
+    ImGui::Separator();
+    static std::array<float, sdq::metrics::LatencyHistorySize> latencies;
+    for (MetricOperation operation = 0; operation < MetricOperation_COUNT; ++operation) {
+        const size_t latency_count = sdq::metrics::GetLatencies(operation, latencies);
+        if (latency_count == 0) {
+            ImGui::TextDisabled("%s: no samples", sdq::metrics::GetOperationName(operation));
+            continue;
+        }
+
+        float latency_sum = 0.0f, latency_max = 0.0f;
+        for (size_t idx = 0; idx < latency_count; ++idx) {
+            latency_sum += latencies[idx];
+            latency_max  = std::max(latency_max, latencies[idx]);
+        }
+        ImGui::Text("%s: last %.1f ms, avg %.1f ms, max %.1f ms", sdq::metrics::GetOperationName(operation),
+                    latencies[latency_count - 1], latency_sum / latency_count, latency_max);
+        ImGui::PushID(operation);
+        ImGui::PlotHistogram("##Latencies", latencies.data(), static_cast<int>(latency_count), 0, nullptr, 0.0f, FLT_MAX, plot_size);
+        ImGui::PopID();
+    }
+
+    // Engine counters since the game was started
+    ImGui::Separator();
+    for (MetricCounter counter = 0; counter < MetricCounter_COUNT; ++counter)
+        ImGui::Text("%s: %llu", sdq::metrics::GetCounterName(counter), static_cast<unsigned long long>(sdq::metrics::GetCounter(counter)));
+
+    ImGui::End();
+}
+
 void GameWindow::LoadSudokuFileWindow()
 {
     if (!OpenLoadSudokuWindow)
@@ -272,29 +453,9 @@ void GameWindow::LoadSudokuFileWindow()
     static bool init_modal_once = true;
     static ImGuiTextFilter file_filter;
     static int selected_fidx = -1;
-    static std::vector<SaveFile> saved_puzzles;
+    const auto& saved_puzzles = SudokuFileScanner.GetEntries();
     constexpr const char* directory_name = "sudoku boards";
 
-    auto refresh_file_list = [&]() {
-        if (!std::filesystem::exists(directory_name))
-            std::filesystem::create_directory(directory_name);
-        else if (!std::filesystem::is_directory(directory_name)) {
-            std::filesystem::remove(directory_name);
-            std::filesystem::create_directory(directory_name);
-        }
-
-        saved_puzzles.clear();
-        for (auto& path : std::filesystem::directory_iterator(directory_name)) {
-            if (path.is_directory())
-                continue;
-
-            saved_puzzles.push_back(path);
-            const auto& file_time = path.last_write_time();
-            std::time_t converted_time = std::chrono::system_clock::to_time_t(std::chrono::clock_cast<std::chrono::system_clock>(file_time));
-            saved_puzzles.back().DateTime = *localtime(&converted_time);
-        }
-    };
-
     if (init_modal_once) {
         init_modal_once = false;
 
@@ -305,11 +466,12 @@ void GameWindow::LoadSudokuFileWindow()
         ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
         ImGui::SetNextWindowSize(modal_size, ImGuiCond_Appearing);
 
-        // Initialize other objects that could be expensive doing in a loop
-        refresh_file_list();
+        // The files are listed by a background worker, the table fills up while it scans
+        SudokuFileScanner.Start(directory_name);
     }
 
     if (!ImGui::BeginPopupModal("Load Sudoku File##GameStart", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove)) {
+        SudokuFileScanner.Stop();
         file_filter.Clear();
         selected_fidx     = -1;
         init_modal_once  = true;
@@ -318,6 +480,9 @@ void GameWindow::LoadSudokuFileWindow()
         return;
     }
 
+    if (SudokuFileScanner.Poll())
+        selected_fidx = -1;
+
     ImGui::AlignTextToFramePadding();
     ImGui::Text("Find File:");
     ImGui::SameLine(0.0f, 2.50f);
@@ -363,8 +528,7 @@ void GameWindow::LoadSudokuFileWindow()
 
     ImGui::BeginDisabled(selected_fidx < 0);
     if (ImGui::Button("Open File", ImVec2(75.0f, 0))) {
-        using NewGameFromSave = bool (GameWindow::*)(const std::string&);
-        NewGameFuture = std::async(std::launch::async, static_cast<NewGameFromSave>(&GameWindow::CreateNewGame), this, saved_puzzles[selected_fidx].Directory);
+        this->SubmitNewGame([this, filepath = saved_puzzles[selected_fidx].Directory]() { return this->CreateNewGame(filepath); });
         StartNewGameLoadingScreen();
     }
     ImGui::EndDisabled();
@@ -421,7 +585,7 @@ void GameWindow::LoadSudokuFileWindow()
 
     ImGui::SameLine();
     if (ImGui::Button("Refresh##FOW", ImVec2(75.0f, 0))) {
-        refresh_file_list();
+        SudokuFileScanner.Rescan();
         reset_scroll_pos = true;
     }
 
@@ -429,6 +593,11 @@ void GameWindow::LoadSudokuFileWindow()
     if (ImGui::Button("Cancel", ImVec2(75.0f, 0)))
         ImGui::CloseCurrentPopup();
 
+    if (SudokuFileScanner.IsScanning()) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("Scanning...");
+    }
+
     ImGui::EndPopup();
 }
 
@@ -443,14 +612,16 @@ void GameWindow::LoadSaveFileWindow()
     static int  selected_fidx          = -1;
     static size_t selected_difficulty = 0;
     static ImGuiTextFilter file_filter;
-    static std::vector<SaveFile> save_slots(100);
+    static std::vector<SaveFile> save_slots(sdq::save::ManifestSlotCount);
+    static sdq::save::SaveManifest save_manifest;
     static std::string window_label;
     constexpr const char* directory_name = "save files";
+    constexpr const char* manifest_name  = "save files\\slots.manifest";
 
     static bool init_saveslots = true;
     if (init_saveslots) {
         init_saveslots = false;
-        for (int idx = 0; idx < 100; ++idx) {
+        for (size_t idx = 0; idx < save_slots.size(); ++idx) {
             save_slots[idx].Directory.clear();
             save_slots[idx].Directory += directory_name;
             save_slots[idx].Directory += "\\";
@@ -460,7 +631,20 @@ void GameWindow::LoadSaveFileWindow()
         }
     }
 
-    auto refresh_list = [&]() {
+    auto set_slot_from_manifest = [&](size_t idx) {
+        const auto& slot_info = save_manifest.Slots[idx];
+        save_slots[idx].Exists         = slot_info.Exists != 0;
+        save_slots[idx].Difficulty     = slot_info.Exists ? static_cast<SudokuDifficulty>(slot_info.Difficulty) : static_cast<SudokuDifficulty>(SudokuDifficulty_Random);
+        save_slots[idx].Progress       = slot_info.Progress;
+        save_slots[idx].ElapsedSeconds = slot_info.ElapsedSeconds;
+        if (slot_info.Exists) {
+            ToLocalTime(static_cast<std::time_t>(slot_info.Timestamp), save_slots[idx].DateTime);
+        }
+    };
+
+    // Scans every save slot in the directory and writes a fresh manifest.
+    // Only needed when the manifest is missing or broken, or when the user asks for a refresh
+    auto rebuild_manifest = [&]() {
         if (!std::filesystem::exists(directory_name))
             std::filesystem::create_directory(directory_name);
         else if (!std::filesystem::is_directory(directory_name)) {
@@ -468,18 +652,51 @@ void GameWindow::LoadSaveFileWindow()
             std::filesystem::create_directory(directory_name);
         }
 
-        for (auto& save_slot : save_slots) {
-            save_slot.Exists = std::filesystem::exists(save_slot.Directory);
-            if (!save_slot.Exists) {
-                save_slot.Difficulty = 0;
+        sdq::save::SaveRecord save_record;
+        for (size_t idx = 0; idx < save_slots.size(); ++idx) {
+            auto& slot_info = save_manifest.Slots[idx];
+            slot_info = {};
+            if (!std::filesystem::exists(save_slots[idx].Directory))
                 continue;
+
+            slot_info.Exists = 1;
+            switch (sdq::save::ReadSaveRecord(save_slots[idx].Directory.data(), save_record))
+            {
+            case SaveReadResult_Ok:
+                slot_info.Difficulty     = save_record.Header.Difficulty;
+                slot_info.Progress       = static_cast<uint8_t>(sdq::save::GetRecordProgress(save_record));
+                slot_info.ElapsedSeconds = save_record.ElapsedSeconds;
+                slot_info.Timestamp      = save_record.Header.Timestamp;
+                break;
+            default:
+            {
+                slot_info.Difficulty = static_cast<uint8_t>(sdq::Instance::LoadDifficultyFromSaveFile(save_slots[idx].Directory.data()));
+                const auto& file_time = std::filesystem::directory_entry(save_slots[idx].Directory).last_write_time();
+                slot_info.Timestamp = static_cast<int64_t>(FileTimeToTimeT(file_time));
+                break;
             }
+            }
+        }
+
+        sdq::save::WriteSaveManifest(manifest_name, save_manifest);
+        for (size_t idx = 0; idx < save_slots.size(); ++idx)
+            set_slot_from_manifest(idx);
+    };
 
-            save_slot.Difficulty = sdq::Instance::LoadDifficultyFromSaveFile(save_slot.Directory.data());
-            const auto& file_time = std::filesystem::directory_entry(save_slot.Directory).last_write_time();
-            std::time_t converted_time = std::chrono::system_clock::to_time_t(std::chrono::clock_cast<std::chrono::system_clock>(file_time));
-            localtime_s(&save_slot.DateTime, &converted_time);
+    auto refresh_list = [&]() {
+        if (sdq::save::ReadSaveManifest(manifest_name, save_manifest) != SaveReadResult_Ok) {
+            rebuild_manifest();
+            return;
         }
+
+        for (size_t idx = 0; idx < save_slots.size(); ++idx)
+            set_slot_from_manifest(idx);
+    };
+
+    auto update_manifest_slot = [&](size_t idx, const sdq::save::SaveSlotInfo& slot_info) {
+        save_manifest.Slots[idx] = slot_info;
+        sdq::save::WriteSaveManifest(manifest_name, save_manifest);
+        set_slot_from_manifest(idx);
     };
 
     if (init_modal_once) {
@@ -502,6 +719,17 @@ void GameWindow::LoadSaveFileWindow()
         show_only_filled_slots = LoadAFile;
     }
 
+    // Save writes finish on a worker. The slot list catches up here, even if the window was closed in between
+    for (const auto& save_write : FinishedSaveWrites) {
+        if (!save_write.Success)
+            continue;
+
+        update_manifest_slot(save_write.SlotIdx, save_write.SlotInfo);
+        if (selected_fidx == save_write.SlotIdx)
+            selected_fidx = -1;
+    }
+    FinishedSaveWrites.clear();
+
     if (!ImGui::BeginPopupModal(window_label.data(), nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove)) {
         init_modal_once = true;
         OpenLoadSaveFileWindow = false;
@@ -568,6 +796,10 @@ void GameWindow::LoadSaveFileWindow()
             ImGui::SameLine();
             if (ImGui::Selectable(filename.data(), selected, ImGuiSelectableFlags_SpanAllColumns))
                 selected_fidx = selected ? -1 : idx;
+            if (!empty_slot && ImGui::IsItemHovered()) {
+                const uint32_t elapsed = save_slots[idx].ElapsedSeconds;
+                ImGui::SetTooltip("Progress: %d%%\nTime: %.2u:%.2u:%.2u", save_slots[idx].Progress, elapsed / 3600, (elapsed / 60) % 60, elapsed % 60);
+            }
             if (empty_slot) {
                 ImGui::SameLine(100.0f);
                 ImGui::TextUnformatted("[empty]");
@@ -598,11 +830,10 @@ void GameWindow::LoadSaveFileWindow()
     }
     ImGui::PopStyleVar();
 
-    ImGui::BeginDisabled(selected_fidx < 0);
+    ImGui::BeginDisabled(selected_fidx < 0 || SaveWriteRunning);
     if (ImGui::Button(LoadAFile ? "Open File##LSF" : "Save File##LSF", ImVec2(75.0f, 0))) {
         if (LoadAFile) {
-            using NewGameFromSave = bool (GameWindow::*)(const std::string&);
-            NewGameFuture = std::async(std::launch::async, static_cast<NewGameFromSave>(&GameWindow::LoadSaveFile), this, save_slots[selected_fidx].Directory);
+            this->SubmitNewGame([this, filepath = save_slots[selected_fidx].Directory]() { return this->LoadSaveFile(filepath); });
             StartNewGameLoadingScreen();
         }
         else {
@@ -611,9 +842,8 @@ void GameWindow::LoadSaveFileWindow()
                 ImGui::SetNextWindowSize(ImVec2(360.0f, 96.0f), ImGuiCond_Appearing);
                 ImGui::SetNextWindowPos(ImGui::GetMainViewport()->GetCenter(), ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
             }
-            else if (this->SaveProgress(save_slots[selected_fidx].Directory)) {
-                refresh_list();
-                selected_fidx = -1;
+            else {
+                this->SaveProgress(selected_fidx, save_slots[selected_fidx].Directory);
             }
         }
     }
@@ -625,10 +855,7 @@ void GameWindow::LoadSaveFileWindow()
 
         ImGui::SetCursorPosX((ImGui::GetWindowSize().x - 100.0f) * 0.50f);
         if (ImGui::Button("Yes", ImVec2(50.0f, 0.0f))) {
-            if (this->SaveProgress(save_slots[selected_fidx].Directory)) {
-                refresh_list();
-                selected_fidx = -1;
-            }
+            this->SaveProgress(selected_fidx, save_slots[selected_fidx].Directory);
             ImGui::CloseCurrentPopup();
         }
 
@@ -683,7 +910,7 @@ void GameWindow::LoadSaveFileWindow()
         ImGui::SetCursorPosX((ImGui::GetWindowSize().x - 100.0f) * 0.50f);
         if (ImGui::Button("Yes", ImVec2(50.0f, 0.0f))) {
             std::filesystem::remove(save_slots[selected_fidx].Directory);
-            refresh_list();
+            update_manifest_slot(selected_fidx, {});
             selected_fidx = -1;
             ImGui::CloseCurrentPopup();
         }
@@ -717,7 +944,7 @@ void GameWindow::LoadSaveFileWindow()
 
     ImGui::SameLine();
     if (ImGui::Button("Refresh", ImVec2(75.0f, 0))) {
-        refresh_list();
+        rebuild_manifest();
         reset_scroll_pos = true;
     }
 
@@ -762,13 +989,12 @@ void GameWindow::PencilmarkOptions()
     
     if (ImGui::BeginPopupModal("Are You Sure##ResetPencilmark", nullptr, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize)) {
         CenterText("This action will reset and replace current pencilmarks.");
-        CenterText("This action cannot be undone. Proceed?");
+        CenterText("It can be reverted with Undo. Proceed?");
     
         constexpr ImVec2 button_size(50.0f, 0.0f);
         ImGui::SetCursorPosX((ImGui::GetWindowSize().x - button_size.x * 2.0f) * 0.50f);
         if (ImGui::Button("Yes##pmcconfirm", button_size)) {
             SudokuContext.ResetAllPencilmarks();
-            SudokuContext.ResetTurnLogs();
             ImGui::CloseCurrentPopup();
         }
     
@@ -788,13 +1014,12 @@ void GameWindow::PencilmarkOptions()
     //
     //if (ImGui::BeginPopupModal("Are You Sure##ClearPencilmark", nullptr, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize)) {
     //    CenterText("This action will remove current pencilmarks.");
-    //    CenterText("This action cannot be undone. Proceed?");
+    //    CenterText("It can be reverted with Undo. Proceed?");
     //
     //    constexpr ImVec2 button_size(50.0f, 0.0f);
     //    ImGui::SetCursorPosX((ImGui::GetWindowSize().x - button_size.x * 2.0f) * 0.50f);
     //    if (ImGui::Button("Yes##pmcconfirm", button_size)) {
     //        SudokuContext.ClearAllPencilmarks();
-    //        SudokuContext.ResetTurnLogs();
     //        ImGui::CloseCurrentPopup();
     //    }
     //
@@ -809,11 +1034,21 @@ void GameWindow::PencilmarkOptions()
 
 void GameWindow::UndoRedoOptions()
 {
+    auto update_all_tiles = [this]() {
+        for (auto& row_tile : SudokuGameTiles)
+            for (auto& tile : row_tile)
+                tile.UpdateTileNumber(ShowPencilmarks ? TileState_Pencilmark : TileState_Normal);
+    };
+
     ImGui::BeginDisabled(!SudokuContext.GetTurnLogs()->CanUndo());
     if (ImGui::Button("Undo", ImVec2(ImGui::GetContentRegionAvail().x / 2.0f, 0.0f))) {
-        if (const auto* undo_tile = SudokuContext.GetTurnLogs()->GetUndoTile()) {
+        if (const auto undo_tile = SudokuContext.GetTurnLogs()->GetUndoTile()) {
             SudokuContext.UndoTurn();
-            SudokuGameTiles[undo_tile->Row][undo_tile->Column].UpdateTileNumber(ShowPencilmarks ? TileState_Pencilmark : TileState_Normal);
+            // A linked turn means a whole group was undone, which can touch any tile
+            if (undo_tile->Linked)
+                update_all_tiles();
+            else
+                SudokuGameTiles[undo_tile->Row][undo_tile->Column].UpdateTileNumber(ShowPencilmarks ? TileState_Pencilmark : TileState_Normal);
             RecheckTiles();
         }
     }
@@ -821,9 +1056,13 @@ void GameWindow::UndoRedoOptions()
     ImGui::SameLine();
     ImGui::BeginDisabled(!SudokuContext.GetTurnLogs()->CanRedo());
     if (ImGui::Button("Redo", ImVec2(ImGui::GetContentRegionAvail().x, 0))) {
-        if (const auto* redo_tile = SudokuContext.GetTurnLogs()->GetRedoTile()) {
+        if (const auto redo_tile = SudokuContext.GetTurnLogs()->GetRedoTile()) {
             SudokuContext.RedoTurn();
-            SudokuGameTiles[redo_tile->Row][redo_tile->Column].UpdateTileNumber(ShowPencilmarks ? TileState_Pencilmark : TileState_Normal);
+            // The last redone turn being linked means a whole group was redone
+            if (SudokuContext.GetTurnLogs()->GetUndoTile()->Linked)
+                update_all_tiles();
+            else
+                SudokuGameTiles[redo_tile->Row][redo_tile->Column].UpdateTileNumber(ShowPencilmarks ? TileState_Pencilmark : TileState_Normal);
             RecheckTiles();
         }
     }
@@ -1002,7 +1241,7 @@ void GameWindow::NewGameOption()
                 case 4: difficulty_tooltip = "Generates a really sadistic puzzle. Best for the chad of chads.";  break;
                 case 5: difficulty_tooltip = "Loads a sudoku puzzle from file.";                                 break;
                 case 6: difficulty_tooltip = "Loads a saved puzzle progress.";                                   break;
-                default: assert(false, "Invalid difficulty choice!");  break;
+                default: assert(false && "Invalid difficulty choice!");  break;
                 }
 
                 ImGui::BeginTooltip();
@@ -1026,8 +1265,7 @@ void GameWindow::NewGameOption()
             LoadAFile = true;
         }
         else {
-            using NewGameFromDifficulty = bool(GameWindow::*)(int);
-            NewGameFuture = std::async(std::launch::async, static_cast<NewGameFromDifficulty>(&GameWindow::CreateNewGame), this, GameDifficulty);
+            this->SubmitNewGame([this, difficulty = GameDifficulty]() { return this->CreateNewGame(difficulty); });
             NewGameLoading.StartNewGameLoadingScreen(ImVec2(120.0f, 110.0f));
             StartLoadingScreen = true;
         }
@@ -1094,49 +1332,71 @@ bool GameWindow::IsWindowClosed()
     return WindowClose;
 }
 
+void GameWindow::SetWakeUpCallback(sdq::jobs::Task wake_up)
+{
+    Jobs.SetCompletionNotifier(std::move(wake_up));
+}
+
+double GameWindow::GetIdleTimeout() const
+{
+    // The loading spinner and text input caret animate every frame
+    if (StartLoadingScreen || ShowLoadingScreen || NewGameRunning || ImGui::GetIO().WantTextInput)
+        return 0.0;
+
+    if (OpenLoadSudokuWindow && SudokuFileScanner.IsScanning())
+        return 0.0;
+
+    double idle_timeout = OpenLoadSudokuWindow ? FileListIdleTimeout : MaxIdleTimeout;
+
+    // Wake up on the next second boundary of the running timers. Their time comes from the frame delta,
+    // so sleeping longer never loses time, it only delays when the new second is drawn
+    auto until_next_second = [](const TimeObj& time) { return 1.0 - std::fmod(static_cast<double>(time.Seconds), 1.0); };
+    if (GameStart && !GamePaused)
+        idle_timeout = std::min(idle_timeout, until_next_second(TimeElapsed));
+    if (ShowSolution)
+        idle_timeout = std::min(idle_timeout, until_next_second(ShowSolutionTotalTime));
+
+    return idle_timeout;
+}
+
+// CreateNewGame, LoadSaveFile and RecoverLastSession run on a worker. They only build a PreparedGame and publish it,
+// the game on screen is never touched until RenderWindow adopts it
+
 bool GameWindow::CreateNewGame(SudokuDifficulty difficulty)
 {
-    std::lock_guard func_guard(NewGameMutex);
-    if (ShowPencilmarks) {
-        for (auto& row_tile : SudokuGameTiles)
-            for (auto& tile : row_tile)
-                tile.UpdateTileNumber(TileState_Normal);
-    }
-    this->StopOngoingGame();
-    if (!SudokuContext.CreateSudoku(difficulty))
+    sdq::metrics::ScopedLatency latency(MetricOperation_CreateNewGame);
+    auto game = std::make_unique<PreparedGame>();
+    game->Context.SetJobSystem(&Jobs);
+    game->Context.SetGridFactory(&PuzzleGrids);
+    if (!game->Context.CreateSudoku(difficulty))
         return false;
 
-    GameStart = true;
-    SudokuFileSaved = false;
-    CurrentlyOpenFile = "None";
-    this->SetShowSolution();
-    this->SetSudokuTilesForNewGame();
-
+    game->OpenFile     = "None";
+    game->FileSaved    = false;
+    game->FromSaveFile = false;
+    PublishedGame.Publish(std::move(game));
     return true;
 }
 
 bool GameWindow::CreateNewGame(const std::string& filepath)
 {
-    std::lock_guard func_guard(NewGameMutex);
+    sdq::metrics::ScopedLatency latency(MetricOperation_CreateNewGame);
     const auto& input_sudoku_board = sdq::utils::OpenSudokuFile(filepath.c_str());
     if (!input_sudoku_board.has_value())
         return false;
 
-    if (ShowPencilmarks) {
-        for (auto& row_tile : SudokuGameTiles)
-            for (auto& tile : row_tile)
-                tile.UpdateTileNumber(TileState_Normal);
-    }
-    if (!SudokuContext.CreateSudoku(input_sudoku_board.value()))
+    auto game = std::make_unique<PreparedGame>();
+    game->Context.SetGradeCache(&PuzzleGradeCache);
+    if (!game->Context.CreateSudoku(input_sudoku_board.value()))
         return false;
 
-    this->StopOngoingGame();
-    GameStart = true;
-    SudokuFileSaved = true;
-    CurrentlyOpenFile = std::string_view(filepath.begin() + 14, filepath.end());
-    this->SetShowSolution();
-    this->SetSudokuTilesForNewGame();
+    // Does nothing if the board was graded before
+    PuzzleGradeCache.Save(GradeCacheFilepath);
 
+    game->OpenFile     = std::string_view(filepath.begin() + 14, filepath.end());
+    game->FileSaved    = true;
+    game->FromSaveFile = false;
+    PublishedGame.Publish(std::move(game));
     return true;
 }
 
@@ -1155,6 +1415,8 @@ void GameWindow::SetSudokuTilesForNewGame()
 {
     const auto& puzzle_board = SudokuContext.GetPuzzleBoard();
     const auto& solution_board = SudokuContext.GetSolutionBoard();
+    // SetTilePuzzleNumber clears the error state of every tile
+    ShownConflictTiles.reset();
 
     for (size_t row = 0; row < 9; ++row) {
         for (size_t col = 0; col < 9; ++col) {
@@ -1169,6 +1431,7 @@ void GameWindow::SetSudokuTileFromSaveFile()
 {
     const auto& puzzle_board   = SudokuContext.GetPuzzleBoard();
     const auto& solution_board = SudokuContext.GetSolutionBoard();
+    ShownConflictTiles.reset();
 
     for (size_t row = 0; row < 9; ++row) {
         for (size_t col = 0; col < 9; ++col) {
@@ -1190,22 +1453,56 @@ void GameWindow::SetShowSolution()
 
 void GameWindow::RecheckTiles()
 {
-    for (size_t row = 0; row < 9; row++)
-        for (size_t col = 0; col < 9; ++col)
-            SudokuGameTiles[row][col].RecheckError(SudokuContext, row, col);
+    // Only the tiles whose conflict state changed since the last sync need to be touched
+    const auto& conflict_tiles = SudokuContext.GetConflictTiles();
+    const auto  changed_tiles  = conflict_tiles ^ ShownConflictTiles;
+    if (changed_tiles.none())
+        return;
+
+    ShownConflictTiles = conflict_tiles;
+    for (size_t tile_idx = 0; tile_idx < 81; ++tile_idx)
+        if (changed_tiles[tile_idx])
+            SudokuGameTiles[tile_idx / 9][tile_idx % 9].RecheckError(SudokuContext, tile_idx / 9, tile_idx % 9);
 }
 
-bool GameWindow::SaveProgress(const std::string& filepath)
+void GameWindow::SaveProgress(int slot_idx, const std::string& filepath)
 {
-    return SudokuContext.SaveCurrentProgress(filepath.data());
+    // The record is taken on this thread, only the file write runs on a worker
+    sdq::save::SaveRecord  save_record;
+    sdq::save::TurnHistory turn_history;
+    SudokuContext.SetElapsedSeconds(TimeElapsed.TotalSeconds());
+    SudokuContext.CreateSaveRecord(save_record);
+    SudokuContext.GetTurnLogs()->ExportHistory(turn_history);
+
+    SaveWriteRunning = true;
+    Jobs.Submit(JobPriority_Normal, [slot_idx, filepath, save_record, turn_history]() {
+        sdq::metrics::ScopedLatency latency(MetricOperation_SaveProgress);
+        SaveSlotWrite save_write = { slot_idx, false, {} };
+        if (!sdq::save::WriteSaveRecord(filepath.data(), save_record, &turn_history))
+            return save_write;
+
+        save_write.Success                 = true;
+        save_write.SlotInfo.Exists         = 1;
+        save_write.SlotInfo.Difficulty     = save_record.Header.Difficulty;
+        save_write.SlotInfo.Progress       = static_cast<uint8_t>(sdq::save::GetRecordProgress(save_record));
+        save_write.SlotInfo.ElapsedSeconds = save_record.ElapsedSeconds;
+        save_write.SlotInfo.Timestamp      = save_record.Header.Timestamp;
+        return save_write;
+    }, [this](SaveSlotWrite save_write) {
+        SaveWriteRunning = false;
+        FinishedSaveWrites.push_back(save_write);
+    });
 }
 
 void GameWindow::Update()
 {
     ImGuiIO io = ImGui::GetIO();
 
-    if (GameStart && !GamePaused)
+    if (GameStart && !GamePaused) {
         TimeElapsed += io.DeltaTime;
+        // The journal takes the play time from the context with every move
+        SudokuContext.SetElapsedSeconds(TimeElapsed.TotalSeconds());
+    }
 
     if (ShowSolution)
         ShowSolutionTotalTime += io.DeltaTime;
@@ -1214,6 +1511,7 @@ void GameWindow::Update()
         if (SudokuContext.CheckPuzzleState()) {
             OpenGameEndWindow = true;
             StopOngoingGame();
+            AutosaveJournal.EndSession();
         }
         else {
             RecheckTiles();
@@ -1224,23 +1522,71 @@ void GameWindow::Update()
 
 bool GameWindow::LoadSaveFile(const std::string& filepath)
 {
-    std::lock_guard func_guard(NewGameMutex);
+    sdq::metrics::ScopedLatency latency(MetricOperation_LoadSaveFile);
+    auto game = std::make_unique<PreparedGame>();
+    if (!game->Context.LoadSudokuSave(filepath.data()))
+        return false;
+
+    game->OpenFile     = std::string_view(filepath.begin() + 11, filepath.end());
+    game->FileSaved    = false;
+    game->FromSaveFile = true;
+    PublishedGame.Publish(std::move(game));
+    return true;
+}
+
+bool GameWindow::RecoverLastSession()
+{
+    sdq::metrics::ScopedLatency latency(MetricOperation_LoadSaveFile);
+    sdq::save::SaveRecord save_record;
+    if (!sdq::save::Journal::Recover("autosave", save_record))
+        return false;
+
+    auto game = std::make_unique<PreparedGame>();
+    if (!game->Context.LoadSaveRecord(save_record))
+        return false;
+
+    game->OpenFile     = "Autosave";
+    game->FileSaved    = false;
+    game->FromSaveFile = true;
+    PublishedGame.Publish(std::move(game));
+    return true;
+}
+
+void GameWindow::AdoptGame(PreparedGame& game)
+{
     if (ShowPencilmarks) {
         for (auto& row_tile : SudokuGameTiles)
             for (auto& tile : row_tile)
                 tile.UpdateTileNumber(TileState_Normal);
     }
-    if(!SudokuContext.LoadSudokuSave(filepath.data()))
-        return false;
-    
     this->StopOngoingGame();
+
+    // Assigned rather than swapped, so the tiles keep pointing into the same boards
+    SudokuContext = std::move(game.Context);
+    SudokuContext.SetJournal(&AutosaveJournal);
+    SudokuContext.SetGradeCache(&PuzzleGradeCache);
+
     GameStart         = true;
-    SudokuFileSaved   = false;
-    CurrentlyOpenFile = std::string_view(filepath.begin() + 11, filepath.end());
+    SudokuFileSaved   = game.FileSaved;
+    CurrentlyOpenFile = std::move(game.OpenFile);
+    TimeElapsed.SetTotalSeconds(SudokuContext.GetElapsedSeconds());
     this->SetShowSolution();
-    this->SetSudokuTileFromSaveFile();
-    this->RecheckTiles();
-    return true;
+    if (game.FromSaveFile) {
+        this->SetSudokuTileFromSaveFile();
+        this->RecheckTiles();
+    }
+    else {
+        this->SetSudokuTilesForNewGame();
+    }
+    this->StartAutosaveSession();
+}
+
+void GameWindow::StartAutosaveSession()
+{
+    sdq::save::SaveRecord save_record;
+    SudokuContext.SetElapsedSeconds(TimeElapsed.TotalSeconds());
+    SudokuContext.CreateSaveRecord(save_record);
+    AutosaveJournal.BeginSession(save_record);
 }
 
 void GameWindow::StartNewGameLoadingScreen()
@@ -1249,17 +1595,50 @@ void GameWindow::StartNewGameLoadingScreen()
     NewGameResult = std::nullopt;
 }
 
+void GameWindow::SubmitNewGame(std::function<bool()> new_game)
+{
+    NewGameRunning = true;
+    Jobs.Submit(JobPriority_High, std::move(new_game), [this](bool success) {
+        NewGameRunning = false;
+        NewGameResult  = success;
+    });
+}
+
 void GameWindow::CheckNewGameProgress()
 {
-    if (NewGameFuture.valid()) {
-        ShowLoadingScreen = NewGameFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
-        if (!ShowLoadingScreen)
-            NewGameResult = NewGameFuture.get();
-    }
+    // The result itself is set by the job's completion at the start of the frame
+    ShowLoadingScreen = NewGameRunning;
 }
 
 
 
+//-----------------------------------------------------------------------------------------------------------------------------------------------
+// DigitGlyphs CLASS
+//-----------------------------------------------------------------------------------------------------------------------------------------------
+
+void DigitGlyphs::Cache(const ImFont* font)
+{
+    if (font == Font && font->Glyphs.Data == GlyphData)
+        return;
+
+    Font      = font;
+    GlyphData = font->Glyphs.Data;
+    Height    = font->FontSize;
+    for (int digit = 1; digit <= 9; ++digit) {
+        const ImFontGlyph* glyph = font->FindGlyph(static_cast<ImWchar>('0' + digit));
+        Quads[digit] = { ImVec2(glyph->X0, glyph->Y0), ImVec2(glyph->X1, glyph->Y1), ImVec2(glyph->U0, glyph->V0), ImVec2(glyph->U1, glyph->V1), glyph->AdvanceX };
+    }
+}
+
+void DigitGlyphs::AddDigit(ImDrawList* draw_list, int digit, const ImVec2& min, const ImVec2& max, const ImVec2& align, ImU32 col) const
+{
+    // Font glyphs share the atlas texture the window's draw list already has bound
+    const Quad&  quad = Quads[digit];
+    const ImVec2 pos  = ImFloor(ImVec2(min.x + ImMax(0.0f, (max.x - min.x - quad.AdvanceX) * align.x), min.y + ImMax(0.0f, (max.y - min.y - Height) * align.y)));
+    draw_list->PrimReserve(6, 4);
+    draw_list->PrimRectUV(pos + quad.Min, pos + quad.Max, quad.UvMin, quad.UvMax, col);
+}
+
 //-----------------------------------------------------------------------------------------------------------------------------------------------
 // SudokuTile CLASS
 //-----------------------------------------------------------------------------------------------------------------------------------------------
@@ -1271,6 +1650,8 @@ SudokuTile::SudokuTile() :
     ShowAsSolution(false),
     ShowAsPencilmark(false),
     Pencilmark(nullptr),
+    InputTileNumber(0),
+    PopupPencilmark(0),
     SolutionNumber(0),
     TileNumber(0), 
     TileID(0)
@@ -1292,13 +1673,10 @@ bool SudokuTile::InitializeTile(const sdq::BoardTile& puzzle_tile, const sdq::Bo
     Pencilmark     = &puzzle_tile.Pencilmarks;
     ErrorTile      = false;
     PuzzleTile     = false;
-    // A series of early out statements in case the sprintf_s fails
-    bool success = *TileNumber != 0 ? sprintf_s(ButtonLabel, CharBufferSize, "%d##B%d", *TileNumber, TileID) > 0 : sprintf_s(ButtonLabel, CharBufferSize, " ##B%d", TileID) > 0;
-    if (!success)
-        return false;
-    if (sprintf_s(ContextPopUpLabel, CharBufferSize, "##CPU%d", TileID) < 0)
+    // A series of early out statements in case the snprintf fails
+    if (std::snprintf(ContextPopUpLabel, CharBufferSize, "##CPU%d", TileID) < 0)
         return false;
-    if (sprintf_s(InputIntLabel, CharBufferSize, "##II%d", TileID) < 0)
+    if (std::snprintf(InputIntLabel, CharBufferSize, "##II%d", TileID) < 0)
         return false;
 
     Initialized = true;
@@ -1319,19 +1697,16 @@ void SudokuTile::UpdateTileNumber(TileState tile_state)
         ShowAsSolution   = false;
         ShowAsPencilmark = false;
         InputTileNumber  = *TileNumber;
-        *TileNumber != 0 ? sprintf_s(ButtonLabel, CharBufferSize, "%d##B%d", *TileNumber, TileID) : sprintf_s(ButtonLabel, CharBufferSize, " ##B%d", TileID);
         break;
     case TileState_Solution:
         ShowAsSolution = true;
-        sprintf_s(ButtonLabel, CharBufferSize, "%d##B%d", *SolutionNumber, TileID);
         break;
     case TileState_Pencilmark:    
         ShowAsPencilmark = true;
         ShowAsSolution = false;
-        sprintf_s(ButtonLabel, "##B%d", TileID);
         break;
     default:
-        assert(false, "Invalid TileState used!");
+        assert(false && "Invalid TileState used!");
     }
 }
 
@@ -1340,43 +1715,87 @@ void SudokuTile::SetTilePuzzleNumber(uint16_t t_number, uint16_t solution_number
     ErrorTile       = false;
     PuzzleTile      = is_puzzle;
     InputTileNumber = *TileNumber;
-    *TileNumber != 0 ? sprintf_s(ButtonLabel, CharBufferSize, "%d##B%d", *TileNumber, TileID) : sprintf_s(ButtonLabel, CharBufferSize, " ##B%d", TileID);
 }
 
-bool SudokuTile::RenderButton(sdq::Instance& sudoku_context, uint16_t row, uint16_t col, bool error_override)
+bool SudokuTile::IsInteractive() const
+{
+    return PuzzleTile && !ShowAsSolution;
+}
+
+bool SudokuTile::IsShowingPencilmarks() const
+{
+    return *TileNumber == 0 && !ShowAsSolution && PuzzleTile && ShowAsPencilmark;
+}
+
+void SudokuTile::DrawTile(ImDrawList* draw_list, const ImVec2& tile_min, int hovered_cell, bool held, bool error_override,
+                          const DigitGlyphs& number_glyphs, const DigitGlyphs& pencilmark_glyphs) const
 {
-    bool value_changed = false;
     constexpr ImU32 error_button_col        = 2600468659;
     constexpr ImU32 error_buttonhovered_col = 2721396170;
     constexpr ImU32 error_buttonactive_col  = 2267161319;
     const bool error_tile                   = (ErrorTile && error_override) || (ShowAsSolution && *TileNumber != *SolutionNumber);
-    const bool show_as_pencilmark           = *TileNumber == 0 && !ShowAsSolution && PuzzleTile && ShowAsPencilmark;
-    ImGui::PushStyleVar(ImGuiStyleVar_DisabledAlpha, ShowAsSolution ? 0.90f : 0.80f);
-    ImGui::PushStyleColor(ImGuiCol_Button       , error_tile ? error_button_col        : ImGui::GetColorU32(ImGuiCol_Button));
-    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, error_tile ? error_buttonhovered_col : ImGui::GetColorU32(ImGuiCol_ButtonHovered));
-    ImGui::PushStyleColor(ImGuiCol_ButtonActive , error_tile ? error_buttonactive_col  : ImGui::GetColorU32(ImGuiCol_ButtonActive));
-    ImGui::BeginDisabled(!PuzzleTile || ShowAsSolution);
-
-    static int pencilmark_num = 0;
-    static int pressed_pm_num = 0;
-    ImGui::PushFont(show_as_pencilmark ? ImGui::GetIO().Fonts->Fonts[3] : ImGui::GetIO().Fonts->Fonts[2]);
-    if (show_as_pencilmark ? pressed_pm_num = PencilmarkButton(ButtonLabel, ButtonSize, *Pencilmark) : ImGui::Button(ButtonLabel, ButtonSize)) {
-        pencilmark_num = pressed_pm_num;
-        ImVec2 mouse_pos = ImGui::GetMousePos();
-        ImGui::OpenPopup(ContextPopUpLabel);
-        ImGui::SetNextWindowPos(ImVec2(mouse_pos.x + 15.0f, mouse_pos.y), ImGuiCond_Always);
-    }
-    ImGui::PopFont();
-    ImGui::PopStyleColor(3);
+    const bool interactive                  = IsInteractive();
+    // The alpha a disabled button gets. Like BeginDisabled, it isn't applied a second time while the whole board is disabled
+    const bool  board_disabled              = (GImGui->CurrentItemFlags & ImGuiItemFlags_Disabled) != 0;
+    const float alpha                       = interactive || board_disabled ? 1.0f : ShowAsSolution ? 0.90f : 0.80f;
+    const float rounding                    = ImGui::GetStyle().FrameRounding;
+    const ImVec2 tile_max                   = tile_min + ImVec2(TileSize, TileSize);
+    if (!interactive)
+        hovered_cell = -1;
+
+    auto tile_col = [&](ImGuiCol idx, ImU32 error_col) {
+        if (!error_tile)
+            return ImGui::GetColorU32(idx, alpha);
+
+        ImVec4 col = ImGui::ColorConvertU32ToFloat4(error_col);
+        col.w *= alpha;
+        return ImGui::GetColorU32(col);
+    };
+    const ImU32 button_col = tile_col(ImGuiCol_Button, error_button_col);
+    const ImU32 hover_col  = held ? tile_col(ImGuiCol_ButtonActive, error_buttonactive_col) : tile_col(ImGuiCol_ButtonHovered, error_buttonhovered_col);
+    const ImU32 text_col   = ImGui::GetColorU32(ImGuiCol_Text, alpha);
+
+    if (!IsShowingPencilmarks()) {
+        draw_list->AddRectFilled(tile_min, tile_max, hovered_cell != -1 ? hover_col : button_col, rounding);
+        const int number = ShowAsSolution ? *SolutionNumber : *TileNumber;
+        if (number != 0)
+            number_glyphs.AddDigit(draw_list, number, tile_min, tile_max, ImVec2(0.50f, 0.50f), text_col);
+        return;
+    }
+
+    // Only the hovered cell differs from the tile, so it is drawn on top instead of drawing all nine cells
+    const float cell_size = TileSize / 3.0f;
+    draw_list->AddRectFilled(tile_min, tile_max, button_col, rounding);
+    for (int cell = 0; cell < 9; ++cell) {
+        const ImVec2 cell_min = tile_min + ImVec2(cell_size * (cell % 3), cell_size * (cell / 3));
+        const ImVec2 cell_max = cell_min + ImVec2(cell_size, cell_size);
+        if (cell == hovered_cell)
+            draw_list->AddRectFilled(cell_min, cell_max, hover_col, rounding);
+        if (!(*Pencilmark)[cell])
+            pencilmark_glyphs.AddDigit(draw_list, cell + 1, cell_min, cell_max, ImVec2(0.65f, 0.50f), text_col);
+    }
+}
+
+void SudokuTile::OpenPopup(int pencilmark_num, const ImVec2& popup_pos)
+{
+    PopupPencilmark = pencilmark_num;
+    ImGui::OpenPopup(ContextPopUpLabel);
+    ImGui::SetNextWindowPos(popup_pos, ImGuiCond_Always);
+}
+
+bool SudokuTile::RenderPopup(sdq::Instance& sudoku_context, uint16_t row, uint16_t col)
+{
+    bool value_changed = false;
     if (ImGui::BeginPopup(ContextPopUpLabel)) {
-        if (!ShowAsPencilmark) {
+        if (PopupPencilmark == 0) {
             ImGui::PushItemWidth(25.0f);
             ImGui::SetKeyboardFocusHere();
             ImGui::InputInt(InputIntLabel, &InputTileNumber, 0, 0);
             if (ImGui::IsKeyPressed(526, false)) {
                 ImGui::CloseCurrentPopup();
             }
-            else if (ImGui::IsItemDeactivatedAfterEdit() || ImGui::IsKeyPressed(525, false)) {
+            // The Enter that opened the popup from the keyboard is still pressed on its first frame
+            else if (ImGui::IsItemDeactivatedAfterEdit() || (ImGui::IsKeyPressed(525, false) && !ImGui::IsWindowAppearing())) {
                 if (InputTileNumber < 0) 
                     InputTileNumber = 0;
                 else if (InputTileNumber > 9) 
@@ -1393,24 +1812,24 @@ bool SudokuTile::RenderButton(sdq::Instance& sudoku_context, uint16_t row, uint1
             ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(2.50f, 2.50f));
             ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(2.50f, 2.50f));
             static char pencilmark_text[32];
-            sprintf_s(pencilmark_text, "Tile %c%d PencilMark #%d", 'A' + row, col + 1, pencilmark_num);
+            std::snprintf(pencilmark_text, sizeof(pencilmark_text), "Tile %c%d PencilMark #%d", 'A' + row, col + 1, PopupPencilmark);
             ImGui::TextUnformatted(pencilmark_text);
-            const bool pencilmark_removed = (*this->Pencilmark)[pencilmark_num - 1];
+            const bool pencilmark_removed = (*this->Pencilmark)[PopupPencilmark - 1];
             ImGui::BeginDisabled(pencilmark_removed);
             if (ImGui::Button("Remove Pencilmark", ImVec2(125.0f, 0))) {
-                sudoku_context.RemovePencilmark(row, col, pencilmark_num);
+                sudoku_context.RemovePencilmark(row, col, PopupPencilmark);
                 ImGui::CloseCurrentPopup();
             }
             ImGui::EndDisabled();
             ImGui::BeginDisabled(!pencilmark_removed);
             if (ImGui::Button("Add Pencilmark", ImVec2(125.0f, 0))) {
-                sudoku_context.AddPencilmark(row, col, pencilmark_num);
+                sudoku_context.AddPencilmark(row, col, PopupPencilmark);
                 ImGui::CloseCurrentPopup();
             }
             ImGui::EndDisabled();
             ImGui::BeginDisabled(pencilmark_removed);
             if (ImGui::Button("Finalize Pencilmark", ImVec2(125.0f, 0))) {
-                if (sudoku_context.SetTile(row, col, pencilmark_num))
+                if (sudoku_context.SetTile(row, col, PopupPencilmark))
                     value_changed = true;
                 ImGui::CloseCurrentPopup();
             }
@@ -1420,8 +1839,6 @@ bool SudokuTile::RenderButton(sdq::Instance& sudoku_context, uint16_t row, uint1
         }
         ImGui::EndPopup();
     }
-    ImGui::EndDisabled();
-    ImGui::PopStyleVar();
 
     return value_changed;
 }
@@ -1574,60 +1991,31 @@ static void SimpleComboWrapper(const char* label, const std::array<const char*,
     }
 }
 
-static int PencilmarkButton(const char* label, const ImVec2& sz, const std::bitset<9>& pencilmark)
+static BoardHit HitTestBoard(const ImVec2& grid_min, const ImVec2& point)
 {
-    using namespace ImGui;
-    ImGuiWindow* window = GetCurrentWindow();
-    if (window->SkipItems)
-        return false;
-
-    ImGuiContext& g = *GImGui;
-    const ImGuiStyle& style = g.Style;
-    const ImGuiID id = window->GetID(label);
-    const ImVec2 label_size = CalcTextSize(label, NULL, true);
-    ImGuiButtonFlags flags = ImGuiButtonFlags_None;
-
-    ImVec2 pos = window->DC.CursorPos;
-    if ((flags & ImGuiButtonFlags_AlignTextBaseLine) && style.FramePadding.y < window->DC.CurrLineTextBaseOffset) // Try to vertically align buttons that are smaller/have no padding so that text baseline matches (bit hacky, since it shouldn't be a flag)
-        pos.y += window->DC.CurrLineTextBaseOffset - style.FramePadding.y;
-    ImVec2 size = CalcItemSize(sz, label_size.x + style.FramePadding.x * 2.0f, label_size.y + style.FramePadding.y * 2.0f);
-
-    const ImRect bb(pos, pos + size);
-    ItemSize(size, style.FramePadding.y);
-    if (!ItemAdd(bb, id))
-        return false;
+    const ImVec2 grid_pos = point - grid_min;
+    if (grid_pos.x < 0.0f || grid_pos.y < 0.0f || grid_pos.x >= BoardGridSize || grid_pos.y >= BoardGridSize)
+        return { -1, -1, -1 };
+
+    const int   row   = static_cast<int>(grid_pos.y / BoardTilePitch);
+    const int   col   = static_cast<int>(grid_pos.x / BoardTilePitch);
+    const float x     = grid_pos.x - (col * BoardTilePitch);
+    const float y     = grid_pos.y - (row * BoardTilePitch);
+    if (x >= SudokuTile::TileSize || y >= SudokuTile::TileSize)
+        return { -1, -1, -1 };
+
+    const float cell_size = SudokuTile::TileSize / 3.0f;
+    const int   cell_row  = ImMin(static_cast<int>(y / cell_size), 2);
+    const int   cell_col  = ImMin(static_cast<int>(x / cell_size), 2);
+    return { row, col, (cell_row * 3) + cell_col };
+}
 
-    if (g.LastItemData.InFlags & ImGuiItemFlags_ButtonRepeat)
-        flags |= ImGuiButtonFlags_Repeat;
-
-    bool hovered, held;
-    bool pressed = ButtonBehavior(bb, id, &hovered, &held, flags);
-
-    // Render
-    const ImU32 col = GetColorU32((held && hovered) ? ImGuiCol_ButtonActive : hovered ? ImGuiCol_ButtonHovered : ImGuiCol_Button);
-    RenderNavHighlight(bb, id);
-    //RenderFrame(bb.Min, bb.Max, GetColorU32(ImGuiCol_Button), true, style.FrameRounding);
-
-    int return_pencilmark = 0;
-    const ImVec2 mini_square_size = sz / 3.0f;
-    for (size_t idx = 0; idx < 9; ++idx) {
-        const ImVec2 min_square_pos = ImVec2(pos.x + (mini_square_size.x * (idx % 3)), pos.y + (mini_square_size.y * (idx / 3)));
-        const ImVec2 max_square_pos = ImVec2(min_square_pos.x + mini_square_size.x, min_square_pos.y + mini_square_size.y);
-
-        const ImVec2 current_mouse_pos = GetMousePos();
-        const bool is_hovered = current_mouse_pos.x >= min_square_pos.x && current_mouse_pos.x < max_square_pos.x && 
-                                current_mouse_pos.y >= min_square_pos.y && current_mouse_pos.y < max_square_pos.y;
-        char pencilmark_label[36];
-        pencilmark[idx] ? sprintf_s(pencilmark_label, " ##%s", label) : sprintf_s(pencilmark_label, "%zu##%s", idx + 1, label);
-        const ImVec2 text_size = CalcTextSize(pencilmark_label, nullptr, true);
-        RenderFrame(min_square_pos, max_square_pos, is_hovered ? col : GetColorU32(ImGuiCol_Button), false, style.FrameRounding);
-        RenderTextClipped(min_square_pos + style.FramePadding, max_square_pos - style.FramePadding, pencilmark_label, nullptr, &text_size, ImVec2(0.65f, 0.50f));
-        if (pressed && is_hovered)
-            return_pencilmark = idx + 1;
-    }
-
-    IMGUI_TEST_ENGINE_ITEM_INFO(id, label, g.LastItemData.StatusFlags);
-    return return_pencilmark;
+static void BoardLabel(ImDrawList* draw_list, ImFont* font, const ImVec2& min, const ImVec2& max, char label, ImU32 bg_col, ImU32 text_col)
+{
+    const char   text[2]   = { label, '\0' };
+    const ImVec2 text_size = font->CalcTextSizeA(font->FontSize, FLT_MAX, 0.0f, text, text + 1);
+    draw_list->AddRectFilled(min, max, bg_col, ImGui::GetStyle().FrameRounding);
+    draw_list->AddText(font, font->FontSize, ImFloor(min + ((max - min - text_size) * 0.5f)), text_col, text, text + 1);
 }
 
 
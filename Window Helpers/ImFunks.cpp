@@ -439,7 +439,7 @@ bool Button(const char* label, const ImVec2& sz, const ImVec2& pos)
 namespace ImGui
 {
 
-void ImGui::StyleColorsNewDark(ImGuiStyle* dst)
+void StyleColorsNewDark(ImGuiStyle* dst)
 {
 	ImGuiStyle* style = dst ? dst : &ImGui::GetStyle();
 	ImVec4* colors = style->Colors;
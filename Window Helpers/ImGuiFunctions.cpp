@@ -1,4 +1,5 @@
 #include "ImGuiFunctions.h"
+#include "imgui_internal.h"
 
 //-----------------------------------------------------------------------------------------------------
 // ImGui FUNCTIONS
@@ -30,6 +31,12 @@ void ImGuide::ImGuiNewFrame()
 	ImGui::NewFrame();
 }
 
+bool ImGuide::HasPendingInput() const
+{
+	// The GLFW callbacks queue every key, mouse and focus event, and ImGui::NewFrame empties the queue
+	return ImGui::GetCurrentContext()->InputEventsQueue.Size > 0;
+}
+
 void ImGuide::SetTheme(ImGuiThemes theme)
 {
 	switch (theme)
@@ -32,6 +32,8 @@ public:
 	void SetTheme(ImGuiThemes theme);
 	bool ImGuiFonts();
 	void ImGuiNewFrame();
+	// True if the backend queued input that the next ImGuiNewFrame hasn't processed yet
+	bool HasPendingInput() const;
 	void Shutdown();
 
 };
@@ -2,10 +2,15 @@
 #include "IconsFontAwesome5.h"
 #include <filesystem>
 #include "ImGuiFunctions.h"
+#include "FontAtlasCache.h"
+#include "sdq_metrics.h"
+#include <chrono>
 #include <Windows.h>
 
 int main()
 {
+    const auto startup_start = std::chrono::steady_clock::now();
+
     OGLSet window_helper;
     if (!window_helper.InitGLFW("Sudoku Game", 507, 785))
         return -1;
@@ -53,6 +58,19 @@ int main()
             throw std::exception(iconfont_exception);
         if(io.Fonts->AddFontDefault() == nullptr)
             throw std::exception("Internal failure!");
+
+        // Rasterizing every font size is most of the startup, so the baked atlas of the last launch is reused
+        // as long as the fonts didn't change
+        const std::string atlas_cache_filepath = dir + "font atlas.cache";
+        const auto atlas_start = std::chrono::steady_clock::now();
+        const bool atlas_cached = FontAtlasCache::Load(io.Fonts, atlas_cache_filepath.c_str());
+        if (!atlas_cached) {
+            if (!io.Fonts->Build())
+                throw std::exception("Internal failure!");
+            FontAtlasCache::Save(io.Fonts, atlas_cache_filepath.c_str());
+        }
+        sdq::metrics::RecordLatency(atlas_cached ? MetricOperation_FontAtlasLoad : MetricOperation_FontAtlasBake,
+                                    std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - atlas_start).count());
     }
     catch (const std::exception& e) {
         std::cout << e.what() << "\n";
@@ -69,18 +87,40 @@ int main()
     bool show_demo = true;
 
     GameWindow gamewindow_helper;
+    // A finished background job posts an empty event, so the idle wait below returns and the result shows up right away
+    gamewindow_helper.SetWakeUpCallback([]() { glfwPostEmptyEvent(); });
 
     FreeConsole();
 
+    // ImGui needs a couple of frames after an input before hover and popup states settle
+    constexpr int settle_frames = 3;
+    int active_frames = settle_frames;
+    bool first_frame = true;
     while (!window_helper.IsWindowClosed() && !gamewindow_helper.IsWindowClosed()) {
-        glfwPollEvents();
+        // Sleep until there is input or the game window needs a new frame, instead of redrawing at the refresh rate
+        const double idle_timeout = gamewindow_helper.GetIdleTimeout();
+        if (active_frames > 0 || idle_timeout <= 0.0)
+            glfwPollEvents();
+        else
+            glfwWaitEventsTimeout(idle_timeout);
+        // Only input needs the settle frames. A timer tick or a finished job draws its one frame and sleeps again
+        active_frames = imgui_helper.HasPendingInput() ? settle_frames : (active_frames > 0 ? active_frames - 1 : 0);
+        const auto build_start = std::chrono::steady_clock::now();
         imgui_helper.ImGuiNewFrame();
 
         //ImGui::ShowDemoWindow();
 
         gamewindow_helper.RenderWindow();
 
+        const auto render_start = std::chrono::steady_clock::now();
         ImGuiOGL_Render(main_window_object);
+        const auto render_end = std::chrono::steady_clock::now();
+        sdq::metrics::RecordFrameTime(std::chrono::duration<float, std::milli>(render_start - build_start).count(),
+                                      std::chrono::duration<float, std::milli>(render_end - render_start).count());
+        if (first_frame) {
+            sdq::metrics::RecordLatency(MetricOperation_Startup, std::chrono::duration<float, std::milli>(render_end - startup_start).count());
+            first_frame = false;
+        }
     }
 
     imgui_helper.Shutdown();